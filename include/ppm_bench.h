@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief PPM action benchmark definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM action benchmark module.
+ *
+ * The benchmark repeats an application provided action (e.g. a ppmbtl_doImageAction() call) for
+ * each of a set of policies and reports the success rate and the mean and 95th percentile action
+ * time per policy. A policy combines the bitrate adaptation of the link monitor, a response
+ * timeout scale and a number of attempts per run.
+ *
+ * Combined with the fault model of the RMT PPM layer (CONFIG_PPM_BOOTLOADER_FAULT_INJECTION),
+ * every policy is run against the same reproducible sequence of dropped, corrupted, jittered,
+ * late and lost responses, which allows to tune the policies for marginal fixtures.
+ * @{
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ppm_err.h"
+#include "ppm_link.h"
+#include "rmt_ppm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** benchmarked action callback type definition
+ *
+ * @param[in]  user_ctx  user context as passed to ppmbench_run().
+ * @returns  result of the action.
+ */
+typedef ppm_err_t (*ppm_bench_action_cb_t)(void * user_ctx);
+
+/** ppm benchmark policy structure */
+typedef struct ppm_bench_policy_s {
+    const char * name;                  /**< policy name used in the report */
+    const ppm_link_policy_t * link_policy; /**< bitrate policy, NULL for a fixed bitrate */
+    uint16_t timeout_percent;           /**< response timeouts relative to the chip defaults [%] */
+    uint8_t attempts;                   /**< number of attempts of a failing action per run */
+} ppm_bench_policy_t;                   /**< ppm benchmark policy type */
+
+/** ppm benchmark result structure */
+typedef struct ppm_bench_result_s {
+    uint32_t runs;                      /**< number of runs */
+    uint32_t successes;                 /**< number of runs ending with a successful action */
+    uint32_t attempts;                  /**< number of actions performed */
+    uint32_t mean_us;                   /**< mean run time including retries [us] */
+    uint32_t p95_us;                    /**< 95th percentile run time including retries [us] */
+    uint32_t max_us;                    /**< longest run time including retries [us] */
+    ppm_link_stats_t link;              /**< link statistics of all runs */
+    rmt_ppm_fault_stats_t faults;       /**< faults injected in all runs */
+} ppm_bench_result_t;                   /**< ppm benchmark result type */
+
+/** get the number of arena bytes ppmbench_run() allocates
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  runs  number of runs per policy.
+ * @returns  number of arena bytes.
+ */
+size_t ppmbench_getArenaSize(uint32_t runs);
+
+/** run an action repeatedly for a set of policies
+ *
+ * Every policy starts from the same fault model seed. The link policy, response timeout scale and
+ * fault model are cleared once done.
+ *
+ * @param[in]  faults  fault model to apply, NULL for the bus as is.
+ * @param[in]  policies  policies to benchmark.
+ * @param[in]  policy_count  number of policies.
+ * @param[in]  runs  number of runs per policy.
+ * @param[in]  action  action to benchmark.
+ * @param[in]  user_ctx  user context passed to the action.
+ * @param[out]  results  result per policy (policy_count entries).
+ * @returns  error code representing the result of the benchmark (not of the actions).
+ */
+ppm_err_t ppmbench_run(const rmt_ppm_fault_model_t * faults,
+                       const ppm_bench_policy_t * policies,
+                       size_t policy_count,
+                       uint32_t runs,
+                       ppm_bench_action_cb_t action,
+                       void * user_ctx,
+                       ppm_bench_result_t * results);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -28,19 +28,70 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "esp_err.h"
 
 #include "intelhex.h"
+#include "mlx_chip.h"
 
 #include "ppm_err.h"
+#include "ppm_image.h"
 #include "ppm_types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** ppm ram loader description structure */
+typedef struct ppm_ram_loader_s {
+    const uint8_t * code;               /**< ram loader binary */
+    size_t length;                      /**< length of the ram loader binary (in bytes, multiple of the page size) */
+    uint16_t offset;                    /**< ram offset to load the loader at (in bytes, page aligned) */
+    uint8_t page_size;                  /**< page size of the ram programming session (in words) */
+    uint16_t start_time;                /**< time needed by the loader to start after the upload (ms) */
+    uint32_t bitrate;                   /**< bitrate to use towards the loader, up to RMT_PPM_MAX_BITRATE (0 keeps the action bitrate) */
+    uint16_t page_ack_timeout;          /**< flash page acknowledge timeout of the loader (ms, 0 keeps the rom loader timing) */
+} ppm_ram_loader_t;                     /**< ppm ram loader description type */
+
+/** ppm programming mode handle type (see ppmbtl_open()) */
+typedef struct ppm_handle_s * ppm_handle_t;
+
+/** image selection callback type definition
+ *
+ * Called once the connected chip has been unlocked to select the content to perform the action with.
+ *
+ * @param[in]  project_id  project ID of the connected chip.
+ * @param[in]  chip_info  information about the connected chip.
+ * @param[in]  user_ctx  user context as passed to ppmbtl_doSelectAction().
+ * @returns  intel hex container to perform the action with, NULL to abort the action.
+ */
+typedef ihexContainer_t * (*ppm_image_select_cb_t)(uint16_t project_id, const mlx_chip_t * chip_info, void * user_ctx);
+
+/** assign the arena all PPM bootloader buffers are allocated from
+ *
+ * Only available when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled, in which case it shall be called
+ * before ppmbtl_init(). The arena shall be 8-byte aligned, DMA capable internal RAM and remain valid
+ * for as long as the module is in use.
+ *
+ * @param[in]  arena  start of the arena.
+ * @param[in]  size  size of the arena in bytes (see ppmbtl_getArenaSize()).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmbtl_setArena(void *arena, size_t size);
+
+/** get the arena size needed by the PPM bootloader module
+ *
+ * Covers init, an action, an image preparation and the encoder/decoder self test, also when run
+ * from different tasks. Add ppmworker_getArenaSize(), rmt_ppm_get_broadcast_arena_size(),
+ * ppmimage_getLibraryArenaSize() and ppmbench_getArenaSize() for the features which are used.
+ *
+ * @param[in]  max_memory_length  largest memory (in bytes) of all chips which will be handled.
+ * @returns  number of arena bytes needed for init and any subsequent action.
+ */
+size_t ppmbtl_getArenaSize(size_t max_memory_length);
+
 /** initialize the PPM bootloader module */
 void ppmbtl_init(void);
 
@@ -81,7 +132,172 @@ ppm_err_t ppmbtl_doAction(bool manpow,
                           ppm_action_t action,
                           ihexContainer_t * ihex);
 
+/** perform a full programming/verification action with content selected for the detected chip
+ *
+ * Unlike calling ppmbtl_readChipInfo() followed by ppmbtl_doAction(), the chip is only power cycled,
+ * calibrated and unlocked once. In broadcast mode the content is selected for the chip on the
+ * primary bus, all connected chips shall be of the same type.
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used during bootloader operations.
+ * @param[in]  memory  memory type to perform action on.
+ * @param[in]  action  action type to perform.
+ * @param[in]  select_cb  callback selecting the intel hex container after unlock.
+ * @param[in]  user_ctx  user context passed to the callback.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_doSelectAction(bool manpow,
+                                bool broadcast,
+                                uint32_t bitrate,
+                                ppm_memory_t memory,
+                                ppm_action_t action,
+                                ppm_image_select_cb_t select_cb,
+                                void * user_ctx);
+
+/** perform a full programming/verification action with a prepared image
+ *
+ * The memory to perform the action on is taken from the image. Verification only compares the
+ * chip calculated crc with the precomputed image crc.
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used during bootloader operations.
+ * @param[in]  action  action type to perform.
+ * @param[in]  image  prepared image to perform action with (see ppmimage_load()).
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_doImageAction(bool manpow,
+                               bool broadcast,
+                               uint32_t bitrate,
+                               ppm_action_t action,
+                               const ppm_image_t * image);
+
+/** perform a full programming/verification action with the library image matching the chip
+ *
+ * The image is selected by the project ID returned by the unlock session, so a single action handles
+ * all chip types present in the library without a separate detection cycle. In broadcast mode the
+ * image is selected by the project ID of the chip on the primary bus, all connected chips shall be
+ * of the same type.
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used during bootloader operations.
+ * @param[in]  memory  memory type to perform action on (flash or flash cs).
+ * @param[in]  action  action type to perform.
+ * @param[in]  library  image library to select the image from (see ppmimage_loadLibrary()).
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_doLibraryAction(bool manpow,
+                                 bool broadcast,
+                                 uint32_t bitrate,
+                                 ppm_memory_t memory,
+                                 ppm_action_t action,
+                                 const ppm_library_t * library);
+
+/** perform a full programming/verification action through a ram loader
+ *
+ * The ram loader is uploaded with a ram programming session after entering programming mode. Once
+ * it is started, the memory action is performed by the loader instead of the rom ppm loader, which
+ * allows a higher bitrate and shorter page timings on chips which support it. The loader bitrate is
+ * applied with a calibration frame at that bitrate once the loader has started.
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used towards the rom ppm loader.
+ * @param[in]  loader  ram loader to upload and hand the action to.
+ * @param[in]  memory  memory type to perform action on (flash or flash cs).
+ * @param[in]  action  action type to perform.
+ * @param[in]  ihex  intel hex container to perform action with.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_doRamLoaderAction(bool manpow,
+                                   bool broadcast,
+                                   uint32_t bitrate,
+                                   const ppm_ram_loader_t * loader,
+                                   ppm_memory_t memory,
+                                   ppm_action_t action,
+                                   ihexContainer_t * ihex);
+
+/** enter programming mode and keep it open for several operations
+ *
+ * Power cycles the chip if needed, sends the enter ppm pattern, calibrates and unlocks the chip. The
+ * chip stays in programming mode until ppmbtl_close() is called, so any number of operations can be
+ * performed on the handle while paying the enter ppm cost only once. Only one handle can be open at
+ * a time, the single action functions (e.g. ppmbtl_doAction()) and ppmbtl_readChipInfo() fail with
+ * PPM_FAIL_BUSY meanwhile.
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used during bootloader operations.
+ * @param[out]  handle  programming mode handle.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_open(bool manpow, bool broadcast, uint32_t bitrate, ppm_handle_t * handle);
+
+/** reset the chip, leaving programming mode, and power it off
+ *
+ * The chip is only powered off when the handle was opened without manual power cycling. The handle
+ * is closed even when the chip reset fails.
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_close(ppm_handle_t handle);
+
+/** get the project ID of the chip unlocked by ppmbtl_open()
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @param[out]  project_id  project ID of the connected chip.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_getProjectId(ppm_handle_t handle, uint16_t * project_id);
+
+/** program a memory of the chip with the content of an intel hex container
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @param[in]  memory  memory type to program.
+ * @param[in]  ihex  intel hex container to program.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_program(ppm_handle_t handle, ppm_memory_t memory, ihexContainer_t * ihex);
+
+/** verify a memory of the chip against the content of an intel hex container
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @param[in]  memory  memory type to verify.
+ * @param[in]  ihex  intel hex container to verify against.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_verify(ppm_handle_t handle, ppm_memory_t memory, ihexContainer_t * ihex);
+
+/** program or verify a memory of the chip with a prepared image
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @param[in]  action  action type to perform.
+ * @param[in]  image  prepared image to perform the action with (see ppmimage_load()).
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmbtl_imageOperation(ppm_handle_t handle, ppm_action_t action, const ppm_image_t * image);
+
+/** read the crc of a memory range calculated by the chip
+ *
+ * Flash crcs are always calculated from the start of the flash, the offset shall be 0. Flash cs and
+ * nvram crcs are 16-bit values.
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @param[in]  memory  memory type to calculate the crc of.
+ * @param[in]  offset  offset of the range from the start of the memory (in bytes).
+ * @param[in]  length  length of the range (in bytes).
+ * @param[out]  crc  crc calculated by the chip, only written when PPM_OK is returned.
+ * @returns  error code representing the result of the action, PPM_FAIL_SESSION when the crc
+ *           session was not acknowledged or could not be transmitted.
+ */
+ppm_err_t ppmbtl_readCrc(ppm_handle_t handle, ppm_memory_t memory, uint16_t offset, size_t length, uint32_t * crc);
+
 /** library callout to en/disable the chip power
+ *
+ * Not used once per nest power callouts are configured (see ppmpower_configure()).
  *
  * @param[in]  enable  whether to enable the chip power.
  */
@@ -45,6 +45,12 @@ typedef enum ppm_err_e {
     PPM_FAIL_MISSING_DATA = -23,               /**< */
     PPM_FAIL_PROGRAMMING_FAILED = -24,         /**< */
     PPM_FAIL_VERIFY_FAILED = -25,              /**< */
+    PPM_FAIL_INV_IMAGE = -26,                  /**< prepared image is invalid or does not match the chip */
+    PPM_FAIL_RAM_LOADER = -27,                 /**< uploading or starting the ram loader failed */
+    PPM_FAIL_NO_IMAGE = -28,                   /**< no image for the connected chip in the library */
+    PPM_FAIL_INV_HANDLE = -29,                 /**< programming mode handle is not open */
+    PPM_FAIL_BUSY = -30,                       /**< a programming mode handle is open */
+    PPM_FAIL_SESSION = -31,                    /**< session not acknowledged or transmission failed */
 } ppm_err_t;                                   /**< PPM bootloader error code type */
 
 /** convert a PPM bootloader error code in a human readable message
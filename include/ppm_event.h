@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief PPM binary event trace definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM binary event trace module.
+ *
+ * The session engine and the RMT PPM layer report their progress as binary events (event id,
+ * timestamp and two arguments) instead of formatted log messages. With
+ * CONFIG_PPM_BOOTLOADER_EVENT_TRACE enabled, events are written into a fixed size ring without any
+ * lock (from task and ISR context alike), the oldest events being overwritten. Without it the
+ * events compile to nothing.
+ *
+ * The ring is printed on the console with ppmevent_dump() as hex encoded entries, or read with
+ * ppmevent_read() to be stored as a binary file. tools/ppm_event_decode.py decodes either into
+ * readable events. Stop the trace before reading it for a consistent snapshot.
+ * @{
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** PPM event ids (the values are part of the trace format, see tools/ppm_event_decode.py) */
+typedef enum {
+    PPM_EVENT_SESSION_START = 0x01,     /**< session started (session id, page count) */
+    PPM_EVENT_SESSION_END = 0x02,       /**< session ended (session id, esp_err_t result) */
+    PPM_EVENT_PAGE_TX = 0x03,           /**< page frame transmitted (sequence number, page checksum) */
+    PPM_EVENT_EEPROM_CRC = 0x04,        /**< eeprom crc rejected (calculated crc, chip crc) */
+    PPM_EVENT_TX_START = 0x10,          /**< transmission started (frame type, words or pattern time) */
+    PPM_EVENT_TX_DONE = 0x11,           /**< transmission done (frame type, esp_err_t result) */
+    PPM_EVENT_RX_FRAME = 0x20,          /**< frame received (frame type | repairs << 8, data bytes) */
+    PPM_EVENT_RX_PULSE_ERROR = 0x21,    /**< frame dropped for an invalid frame type pulse (pulse ticks, 0) */
+    PPM_EVENT_RX_TIMING_ERROR = 0x22,   /**< symbol outside the timing windows (symbol ticks, decoded bytes) */
+    PPM_EVENT_RX_OVERFLOW = 0x23,       /**< frame dropped on a full RX queue (frame type, data bytes) */
+    PPM_EVENT_RX_ECHO = 0x24,           /**< own transmission suppressed (frame type, 0) */
+    PPM_EVENT_ACK = 0x30,               /**< acknowledge accepted (frame type, first word) */
+    PPM_EVENT_ACK_STALE = 0x31,         /**< response discarded while waiting (frame type, first word) */
+    PPM_EVENT_ACK_TIMEOUT = 0x32,       /**< no acknowledge in time (frame type, expected first word) */
+} ppm_event_id_t;
+
+/** PPM event trace ring entry */
+typedef struct {
+    uint32_t time;                /**< event time [us] */
+    uint16_t event;               /**< event id (ppm_event_id_t) */
+    uint16_t sequence;            /**< event sequence number (wraps), gaps mark overwritten events */
+    uint32_t arg0;                /**< first event argument */
+    uint32_t arg1;                /**< second event argument */
+} ppm_event_entry_t;
+
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+/** Record an event */
+#define PPM_EVENT(event, arg0, arg1) ppmevent_record((event), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+/** Record an event (event trace disabled) */
+#define PPM_EVENT(event, arg0, arg1) do { (void)(arg0); (void)(arg1); } while (0)
+#endif
+
+/** Start recording events, the ring is cleared.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmevent_start(void);
+
+/** Stop recording events, the ring content is kept.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmevent_stop(void);
+
+/** Read the recorded events, oldest first, removing them from the ring.
+ *
+ * @param[out]  entries      buffer receiving the entries.
+ * @param[in]   max_entries  size of the entries buffer.
+ * @return  number of entries read.
+ */
+size_t ppmevent_read(ppm_event_entry_t * entries, size_t max_entries);
+
+/** Get the number of events overwritten before being read since the start.
+ *
+ * @return  number of lost events.
+ */
+uint32_t ppmevent_getLost(void);
+
+/** Print the recorded events on the console for tools/ppm_event_decode.py, removing them from the ring.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmevent_dump(void);
+
+/** Record an event (ISR safe, use PPM_EVENT()).
+ *
+ * @param[in]  event  event id (ppm_event_id_t).
+ * @param[in]  arg0   first event argument.
+ * @param[in]  arg1   second event argument.
+ */
+void ppmevent_record(uint16_t event, uint32_t arg0, uint32_t arg1);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,275 @@
+/**
+ * @file
+ * @brief PPM prepared image definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM prepared image module.
+ *
+ * A prepared image holds the content of one memory of one chip type split in pages, together with
+ * the precomputed memory crc and page checksums. The page payloads can be stored compressed, in
+ * which case each page is decompressed just before it is transmitted.
+ *
+ * Prepared images are stored as a single little endian blob:
+ * - ppm_image_header_t
+ * - ppm_image_page_t for every page
+ * - page payloads
+ *
+ * A blob can be loaded zero-copy from any 4-byte aligned memory (e.g. a memory mapped partition).
+ *
+ * Several images (e.g. firmware variants only differing in a few pages) can be combined in an image
+ * library in which identical pages are stored only once. A library blob consists of:
+ * - ppm_library_header_t
+ * - ppm_library_image_t for every image
+ * - uint16_t project index slot for every index slot (image index + 1, 0 for an empty slot)
+ * - uint16_t unique page reference for every page of every image (padded to 4 bytes)
+ * - ppm_image_page_t for every unique page
+ * - unique page payloads
+ *
+ * Selecting an image from a loaded library only sets up a view, no data is copied. The project index
+ * is an open addressing hash table keyed by project ID and memory, which allows to select the image
+ * for a detected chip in constant time.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "intelhex.h"
+
+#include "ppm_err.h"
+#include "ppm_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Prepared image blob magic ("PPMI") */
+#define PPM_IMAGE_MAGIC 0x494D5050u
+
+/** Prepared image blob format version */
+#define PPM_IMAGE_VERSION 1u
+
+/** Image library blob magic ("PPML") */
+#define PPM_LIBRARY_MAGIC 0x4C4D5050u
+
+/** Image library blob format version */
+#define PPM_LIBRARY_VERSION 1u
+
+/** ppm image page payload encoding enum */
+typedef enum ppm_image_encoding_e {
+    PPM_IMG_ENC_RAW = 0,                /**< page payloads are stored as is */
+    PPM_IMG_ENC_RLE = 1,                /**< page payloads are stored run length encoded (16-bit words) */
+} ppm_image_encoding_t;                 /**< ppm image page payload encoding type */
+
+/** ppm prepared image blob header structure */
+typedef struct ppm_image_header_s {
+    uint32_t magic;                     /**< blob magic (PPM_IMAGE_MAGIC) */
+    uint16_t version;                   /**< blob format version (PPM_IMAGE_VERSION) */
+    uint16_t project_id;                /**< project ID of the chip the image is prepared for */
+    uint8_t memory;                     /**< memory the image is prepared for (ppm_memory_t) */
+    uint8_t encoding;                   /**< page payload encoding (ppm_image_encoding_t) */
+    uint8_t page_size;                  /**< page size (in words) */
+    uint8_t reserved;                   /**< reserved for future use (0) */
+    uint16_t page_count;                /**< number of pages in the image */
+    uint16_t reserved2;                 /**< reserved for future use (0) */
+    uint32_t crc;                       /**< precomputed memory crc as used by the ppm sessions */
+    uint32_t data_length;               /**< length of the memory content (in bytes) */
+    uint32_t payload_length;            /**< length of all page payloads (in bytes) */
+} ppm_image_header_t;                   /**< ppm prepared image blob header type */
+
+/** ppm prepared image page table entry structure */
+typedef struct ppm_image_page_s {
+    uint32_t offset;                    /**< offset of the page payload from the start of the payloads */
+    uint16_t length;                    /**< length of the stored page payload (in bytes) */
+    uint8_t checksum;                   /**< precomputed page checksum */
+    uint8_t reserved;                   /**< reserved for future use (0) */
+} ppm_image_page_t;                     /**< ppm prepared image page table entry type */
+
+/** ppm image library blob header structure */
+typedef struct ppm_library_header_s {
+    uint32_t magic;                     /**< blob magic (PPM_LIBRARY_MAGIC) */
+    uint16_t version;                   /**< blob format version (PPM_LIBRARY_VERSION) */
+    uint8_t encoding;                   /**< page payload encoding of all pages (ppm_image_encoding_t) */
+    uint8_t reserved;                   /**< reserved for future use (0) */
+    uint16_t image_count;               /**< number of images in the library */
+    uint16_t index_size;                /**< number of project index slots (power of 2, 0 without index) */
+    uint32_t page_count;                /**< number of unique pages */
+    uint32_t ref_count;                 /**< number of page references (sum of all image page counts) */
+    uint32_t payload_length;            /**< length of all unique page payloads (in bytes) */
+} ppm_library_header_t;                 /**< ppm image library blob header type */
+
+/** ppm image library image table entry structure */
+typedef struct ppm_library_image_s {
+    ppm_image_header_t header;          /**< image header */
+    uint32_t first_ref;                 /**< index of the first page reference of the image */
+} ppm_library_image_t;                  /**< ppm image library image table entry type */
+
+/** ppm prepared image structure (view on a blob) */
+typedef struct ppm_image_s {
+    const ppm_image_header_t * header;  /**< blob header */
+    const ppm_image_page_t * pages;     /**< page table */
+    const uint16_t * refs;              /**< page table index per image page (NULL for a stand-alone image) */
+    const uint8_t * payload;            /**< page payloads */
+} ppm_image_t;                          /**< ppm prepared image type */
+
+/** ppm image library structure (view on a blob) */
+typedef struct ppm_library_s {
+    const ppm_library_header_t * header; /**< blob header */
+    const ppm_library_image_t * images; /**< image table */
+    const uint16_t * index;             /**< project index slots (NULL without index) */
+    const uint16_t * refs;              /**< unique page references */
+    const ppm_image_page_t * pages;     /**< unique page table */
+    const uint8_t * payload;            /**< unique page payloads */
+} ppm_library_t;                        /**< ppm image library type */
+
+/** ppm image library build entry structure */
+typedef struct ppm_library_entry_s {
+    uint16_t project_id;                /**< project ID of the chip type to prepare the image for */
+    ppm_memory_t memory;                /**< memory to prepare the image for (flash or flash cs) */
+    ihexContainer_t * ihex;             /**< intel hex container holding the memory content */
+} ppm_library_entry_t;                  /**< ppm image library build entry type */
+
+/** prepare an image of a memory for a chip type from an intel hex container
+ *
+ * The blob is written to a caller provided buffer. Call with a NULL buffer to query the required
+ * blob length first.
+ *
+ * @param[in]  project_id  project ID of the chip type to prepare the image for.
+ * @param[in]  memory  memory to prepare the image for (flash or flash cs).
+ * @param[in]  encoding  page payload encoding to use.
+ * @param[in]  ihex  intel hex container holding the memory content.
+ * @param[out]  blob  buffer receiving the blob (4-byte aligned), NULL to query the length.
+ * @param[in]  blob_size  size of the blob buffer (in bytes).
+ * @param[out]  blob_length  length of the prepared blob (in bytes).
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_prepare(uint16_t project_id,
+                           ppm_memory_t memory,
+                           ppm_image_encoding_t encoding,
+                           ihexContainer_t * ihex,
+                           uint8_t * blob,
+                           size_t blob_size,
+                           size_t * blob_length);
+
+/** get the number of arena bytes ppmimage_prepare() allocates
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  max_memory_length  largest memory (in bytes) images are prepared for.
+ * @returns  number of arena bytes.
+ */
+size_t ppmimage_getArenaSize(size_t max_memory_length);
+
+/** load a prepared image from a blob without copying it
+ *
+ * @param[in]  blob  prepared image blob (4-byte aligned, shall remain valid while the image is used).
+ * @param[in]  blob_length  length of the blob (in bytes).
+ * @param[out]  image  image view on the blob.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_load(const uint8_t * blob, size_t blob_length, ppm_image_t * image);
+
+/** build an image library deduplicating identical pages of all images
+ *
+ * Pages are identified by a content hash, hash matches are confirmed by comparing the actual
+ * content. A project index is added for selecting images by project ID and memory, when several
+ * entries share both, the first one is found by ppmimage_findLibraryImage(). The blob is written
+ * to a caller provided buffer. Call with a NULL buffer to query the required blob length first.
+ *
+ * @param[in]  entries  images to put in the library (image index is the entry index).
+ * @param[in]  entry_count  number of entries.
+ * @param[in]  encoding  page payload encoding to use.
+ * @param[out]  blob  buffer receiving the blob (4-byte aligned), NULL to query the length.
+ * @param[in]  blob_size  size of the blob buffer (in bytes).
+ * @param[out]  blob_length  length of the library blob (in bytes).
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_buildLibrary(const ppm_library_entry_t * entries,
+                                size_t entry_count,
+                                ppm_image_encoding_t encoding,
+                                uint8_t * blob,
+                                size_t blob_size,
+                                size_t * blob_length);
+
+/** get the number of arena bytes ppmimage_buildLibrary() allocates
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  entry_count  number of library entries.
+ * @param[in]  max_memory_length  largest memory (in bytes) of the entries.
+ * @param[in]  min_page_length  smallest page (in bytes) of the entries.
+ * @returns  number of arena bytes.
+ */
+size_t ppmimage_getLibraryArenaSize(size_t entry_count, size_t max_memory_length, size_t min_page_length);
+
+/** load an image library from a blob without copying it
+ *
+ * @param[in]  blob  image library blob (4-byte aligned, shall remain valid while the library is used).
+ * @param[in]  blob_length  length of the blob (in bytes).
+ * @param[out]  library  library view on the blob.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_loadLibrary(const uint8_t * blob, size_t blob_length, ppm_library_t * library);
+
+/** select an image of a loaded image library
+ *
+ * @param[in]  library  loaded image library.
+ * @param[in]  index  index of the image in the library.
+ * @param[out]  image  image view on the library.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_getLibraryImage(const ppm_library_t * library, uint16_t index, ppm_image_t * image);
+
+/** find the image for a chip type and memory in a loaded image library
+ *
+ * @param[in]  library  loaded image library.
+ * @param[in]  project_id  project ID of the chip type.
+ * @param[in]  memory  memory type (flash or flash cs).
+ * @param[out]  image  image view on the library.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmimage_findLibraryImage(const ppm_library_t * library,
+                                    uint16_t project_id,
+                                    ppm_memory_t memory,
+                                    ppm_image_t * image);
+
+/** get the data of a single page of a prepared image
+ *
+ * @param[in]  image  prepared image.
+ * @param[in]  page_index  index of the page to get.
+ * @param[out]  page_words  buffer receiving the page data (page_size words).
+ * @param[out]  page_checksum  precomputed checksum of the page (optional).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmimage_getPage(const ppm_image_t * image,
+                           uint16_t page_index,
+                           uint16_t * page_words,
+                           uint8_t * page_checksum);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief PPM link quality monitor definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM link quality monitor module.
+ *
+ * The monitor combines the receive errors of the RMT PPM layer with the acknowledge errors of the
+ * session layer into a single set of link counters. While broadcasting, the errors of all buses add
+ * up in these counters, as all buses are driven with one bitrate. With a bitrate policy set, the
+ * errors of every action are evaluated once the action is done: an error burst on any bus lowers
+ * the bitrate used for the next actions, while a run of clean pages probes a higher bitrate again,
+ * up to the bitrate requested by the application. The bitrate can only change when programming
+ * mode is entered, as the chip takes its timing from the calibration frame.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ppm_session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** PPM link bitrate policy default configuration */
+#define PPM_LINK_POLICY_DEFAULT { \
+            .min_bitrate = 50000u, \
+            .max_bitrate = 0u, \
+            .downshift_percent = 25u, \
+            .upshift_percent = 10u, \
+            .error_burst = 2u, \
+            .clean_pages = 1024u, \
+}
+
+/** ppm link bitrate policy structure */
+typedef struct ppm_link_policy_s {
+    uint32_t min_bitrate;               /**< lowest bitrate the policy may select [bps] */
+    uint32_t max_bitrate;               /**< highest bitrate the policy may select [bps] (0 for the requested bitrate) */
+    uint8_t downshift_percent;          /**< bitrate reduction after an error burst [%] */
+    uint8_t upshift_percent;            /**< bitrate increase when probing up [%] */
+    uint16_t error_burst;               /**< number of link errors within one action triggering a downshift */
+    uint32_t clean_pages;               /**< number of consecutive clean pages before probing up */
+} ppm_link_policy_t;                    /**< ppm link bitrate policy type */
+
+/** ppm link statistics structure */
+typedef struct ppm_link_stats_s {
+    uint32_t frames_received;           /**< number of frames received */
+    uint32_t decode_errors;             /**< number of frames dropped for an invalid frame type pulse */
+    uint32_t timing_errors;             /**< number of frames with a symbol outside the timing windows */
+    uint32_t rx_overflows;              /**< number of frames dropped because the RX queue was full */
+    uint32_t ack_missing;               /**< number of page and session acknowledges not received */
+    uint32_t checksum_mismatches;       /**< number of page and session acknowledges with unexpected content */
+    uint32_t pages;                     /**< number of page frames transmitted */
+    uint32_t bitrate;                   /**< bitrate currently selected by the policy [bps] (0 without policy) */
+    uint32_t downshifts;                /**< number of bitrate downshifts */
+    uint32_t upshifts;                  /**< number of bitrate upshifts */
+} ppm_link_stats_t;                     /**< ppm link statistics type */
+
+/** ppm link wire efficiency report structure (one action) */
+typedef struct ppm_link_report_s {
+    uint32_t action_time;               /**< action time, including entering programming mode (us) */
+    uint64_t payload_bits;              /**< page data bits transmitted in the action */
+    uint32_t payload_bitrate;           /**< effective payload bitrate of the action [bps] */
+    size_t count;                       /**< number of session types used in the action */
+    ppm_session_wire_t sessions[PPM_SESSION_WIRE_TYPES]; /**< wire statistics per session type used */
+} ppm_link_report_t;                    /**< ppm link wire efficiency report type */
+
+/** set the bitrate policy
+ *
+ * @param[in]  policy  bitrate policy to apply, NULL to always use the requested bitrate.
+ */
+void ppmlink_setPolicy(const ppm_link_policy_t * policy);
+
+/** select the bitrate to enter programming mode with
+ *
+ * @param[in]  requested  bitrate requested by the application [bps].
+ * @returns  bitrate to use [bps].
+ */
+uint32_t ppmlink_selectBitrate(uint32_t requested);
+
+/** mark the start of an action, errors are evaluated per action */
+void ppmlink_beginAction(void);
+
+/** mark the end of an action, apply the bitrate policy to its errors and build its wire report */
+void ppmlink_endAction(void);
+
+/** get the wire efficiency report of the last action
+ *
+ * @param[out]  report  wire statistics of the sessions of the last completed action.
+ */
+void ppmlink_getActionReport(ppm_link_report_t * report);
+
+/** get the link statistics
+ *
+ * @param[out]  stats  statistics collected since init or the last reset.
+ */
+void ppmlink_getStats(ppm_link_stats_t * stats);
+
+/** reset the link statistics, the selected bitrate is kept */
+void ppmlink_resetStats(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @brief PPM DUT power sequencing definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM DUT power sequencing module.
+ *
+ * Before entering programming mode a powered chip is switched off and left to settle. Without a
+ * power configuration this uses the ppmbtl_chipPower() and ppmbtl_chipPowered() callouts and waits
+ * the full settle time in every action.
+ *
+ * On a fixture with several nests (one DUT each, bus routed to one nest at a time) the application
+ * configures per nest power callouts instead. The module remembers when every nest was switched off
+ * and only waits for what is left of its settle time. Staging the next nest before an action runs
+ * on the current one switches it off right away, so its settle time overlaps with the current
+ * action and disappears from the cycle time. ppmpower_runNests() sequences an action over a list
+ * of nests this way.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "ppm_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest number of nests of a fixture */
+#define PPM_POWER_MAX_NESTS 8u
+
+/** Default time a chip is left unpowered before entering programming mode [ms] */
+#define PPM_POWER_SETTLE_MS_DEFAULT 100u
+
+/** nest power callout type definition
+ *
+ * @param[in]  nest  nest to switch (0..nest_count-1).
+ * @param[in]  enable  whether to enable the nest power.
+ * @param[in]  user_ctx  user context as configured.
+ */
+typedef void (*ppm_power_set_cb_t)(uint8_t nest, bool enable, void * user_ctx);
+
+/** nest bus selection callout type definition
+ *
+ * @param[in]  nest  nest to route the ppm bus to (0..nest_count-1).
+ * @param[in]  user_ctx  user context as configured.
+ */
+typedef void (*ppm_power_select_cb_t)(uint8_t nest, void * user_ctx);
+
+/** nest action callback type definition (see ppmpower_runNests())
+ *
+ * @param[in]  nest  nest the action is performed on, the bus is routed to it.
+ * @param[in]  user_ctx  user context as passed to ppmpower_runNests().
+ * @returns  result of the action.
+ */
+typedef ppm_err_t (*ppm_power_action_cb_t)(uint8_t nest, void * user_ctx);
+
+/** ppm power configuration structure */
+typedef struct ppm_power_config_s {
+    uint8_t nest_count;                 /**< number of nests (1..PPM_POWER_MAX_NESTS) */
+    uint16_t settle_ms;                 /**< time a chip is left unpowered before entering programming mode [ms] */
+    ppm_power_set_cb_t set_power;       /**< nest power callout */
+    ppm_power_select_cb_t select_bus;   /**< nest bus selection callout, NULL for a bus shared by all nests */
+    void * user_ctx;                    /**< user context passed to the callouts */
+} ppm_power_config_t;                   /**< ppm power configuration type */
+
+/** configure per nest power callouts
+ *
+ * All nests are switched off and nest 0 is selected.
+ *
+ * @param[in]  config  power configuration, NULL to return to ppmbtl_chipPower().
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmpower_configure(const ppm_power_config_t * config);
+
+/** select the nest the following actions are performed on
+ *
+ * @param[in]  nest  nest to select.
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmpower_selectNest(uint8_t nest);
+
+/** stage the nest of the next action
+ *
+ * The nest is switched off right away (unless it already is), so it has settled by the time the
+ * next action starts on it. Without a power configuration this has no effect.
+ *
+ * @param[in]  nest  nest to stage.
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmpower_stageNest(uint8_t nest);
+
+/** perform an action on a sequence of nests, staging every next nest during the current action
+ *
+ * @param[in]  nests  nests in the order to handle them.
+ * @param[in]  count  number of nests.
+ * @param[in]  action  action to perform on every nest.
+ * @param[in]  user_ctx  user context passed to the action.
+ * @param[out]  results  result per nest (count entries), may be NULL.
+ * @returns  PPM_OK when the action succeeded on all nests, else the first failure.
+ */
+ppm_err_t ppmpower_runNests(const uint8_t * nests,
+                            size_t count,
+                            ppm_power_action_cb_t action,
+                            void * user_ctx,
+                            ppm_err_t * results);
+
+/** switch the chip of the selected nest off and wait until it has settled
+ *
+ * Only waits for what is left of the settle time when the chip was switched off earlier.
+ */
+void ppmpower_prepareChip(void);
+
+/** en/disable the power of the chip of the selected nest
+ *
+ * @param[in]  enable  whether to enable the chip power.
+ */
+void ppmpower_setChip(bool enable);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
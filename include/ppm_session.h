@@ -30,6 +30,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "esp_err.h"
+
 #include "mlx_crc.h"
 #include "ppm_types.h"
 
@@ -37,6 +39,9 @@
 extern "C" {
 #endif
 
+/** Maximum number of data words in a page frame */
+#define PPM_PAGE_MAX_WORDS 128u
+
 /** Unlock session mode PPM session default configuration */
 #define PPM_SESSION_UNLOCK_DEFAULT { \
             .session_id = PPM_SESSION_UNLOCK, \
@@ -125,6 +130,17 @@ extern "C" {
             .crc_func = NULL, \
 }
 
+/** RAM programming PPM session default configuration */
+#define PPM_SESSION_RAM_PROG_DEFAULT { \
+            .session_id = PPM_SESSION_RAM_PROG, \
+            .page_size = 64u, \
+            .request_ack = true, \
+            .page0_ack_timeout = 5u, \
+            .pageX_ack_timeout = 5u, \
+            .session_ack_timeout = 10u, \
+            .crc_func = NULL, \
+}
+
 /** Flash CRC PPM session default configuration */
 #define PPM_SESSION_FLASH_CRC_DEFAULT { \
             .session_id = PPM_SESSION_FLASH_CRC, \
@@ -180,6 +196,140 @@ extern "C" {
             .crc_func = NULL, \
 }
 
+/** Page source callback type definition
+ *
+ * Provides the data of a single page just before it is transmitted, which allows page data to be
+ * kept in another form (e.g. compressed) than the plain memory image.
+ *
+ * @param[in]  ctx  page source context.
+ * @param[in]  page_index  index of the page in the memory (0..page_count-1).
+ * @param[out]  page_words  buffer to be filled with the page data (page_size words).
+ * @param[out]  page_checksum  checksum of the page data.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+typedef esp_err_t (*ppm_page_source_t)(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum);
+
+struct ppm_session_desc_s;
+
+/** Session acknowledge validator callback type definition
+ *
+ * @param[in]  desc  descriptor of the session the acknowledge belongs to.
+ * @param[in]  ack  session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  true when the acknowledge content is as expected.
+ */
+typedef bool (*ppm_ack_validator_t)(const struct ppm_session_desc_s * desc, const uint16_t * ack, size_t ack_length);
+
+/** Session result extractor callback type definition
+ *
+ * @param[in]  desc  descriptor of the session the acknowledge belongs to (result points to the output).
+ * @param[in]  ack  validated session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+typedef esp_err_t (*ppm_result_extractor_t)(const struct ppm_session_desc_s * desc, const uint16_t * ack, size_t ack_length);
+
+/** ppm session descriptor structure
+ *
+ * Describes everything which is specific to one session type, all sessions are handled by the
+ * same engine (see ppmsession_run()).
+ */
+typedef struct ppm_session_desc_s {
+    const char * name;                  /**< session name used in log messages */
+    uint16_t offset;                    /**< session frame offset field */
+    uint16_t checksum;                  /**< session frame checksum field */
+    uint16_t page_count;                /**< number of pages announced in the session frame */
+    ppm_page_source_t source;           /**< page source providing the page frames (NULL when no pages are transmitted) */
+    void * source_ctx;                  /**< context passed to the page source */
+    ppm_ack_validator_t validate;       /**< session acknowledge validator (NULL accepts any acknowledge) */
+    ppm_result_extractor_t extract;     /**< session result extractor (NULL when the session has no result) */
+    void * result;                      /**< output of the result extractor */
+} ppm_session_desc_t;                   /**< ppm session descriptor type */
+
+/** Number of session types for which wire statistics are kept */
+#define PPM_SESSION_WIRE_TYPES 10u
+
+/** ppm session wire statistics structure (per session type)
+ *
+ * The bit counts and nominal times are derived from the transmitted and received words, the other
+ * times are measured. The nominal times hold the frame timing at the nominal bitrate, whatever
+ * bitrate was selected; scale them by the nominal over the selected bitrate for the wire time.
+ * The bus is idle (session setup, page sources, inter-frame delays) for the part of time_total not
+ * spent in time_tx and time_wait. The effective payload bitrate of the session type is
+ * payload_bits * 1000000 / time_total.
+ */
+typedef struct ppm_session_wire_s {
+    uint8_t session_id;                 /**< session type (0 for an unused entry) */
+    uint32_t sessions;                  /**< number of sessions */
+    uint32_t frames;                    /**< number of session and page frames transmitted */
+    uint32_t acks;                      /**< number of session and page acknowledges received */
+    uint64_t payload_bits;              /**< page data bits transmitted */
+    uint32_t session_bits;              /**< session frame bits transmitted */
+    uint32_t page_header_bits;          /**< page sequence number bits transmitted */
+    uint32_t page_checksum_bits;        /**< page checksum bits transmitted */
+    uint32_t ack_bits;                  /**< acknowledge bits received */
+    uint64_t pulse_time;                /**< nominal time of the frame type pulses [1/4 us at the nominal bitrate] */
+    uint64_t symbol_time;               /**< nominal time of the data symbols [1/4 us at the nominal bitrate] */
+    uint64_t time_tx;                   /**< time spent transmitting frames (us) */
+    uint64_t time_wait;                 /**< time spent waiting for acknowledges or write/erase delays (us) */
+    uint64_t time_total;                /**< total time spent in sessions (us) */
+} ppm_session_wire_t;                   /**< ppm session wire statistics type */
+
+/** ppm session engine statistics structure */
+typedef struct ppm_session_stats_s {
+    uint32_t sessions;                  /**< number of sessions handled */
+    uint32_t sessions_failed;           /**< number of sessions which failed */
+    uint32_t pages;                     /**< number of page frames transmitted */
+    uint32_t page_ack_missing;          /**< number of page acknowledges not received in time */
+    uint32_t page_ack_invalid;          /**< number of page acknowledges with unexpected content */
+    uint32_t session_ack_missing;       /**< number of session acknowledges not received in time */
+    uint32_t session_ack_invalid;       /**< number of session acknowledges with unexpected content */
+    uint32_t page_time_max;             /**< longest page frame round trip (us) */
+    uint64_t page_time_total;           /**< total time spent in page frame round trips (us) */
+    uint64_t session_time_total;        /**< total time spent in sessions (us) */
+    ppm_session_wire_t wire[PPM_SESSION_WIRE_TYPES]; /**< wire statistics per session type, in order of first use */
+} ppm_session_stats_t;                  /**< ppm session engine statistics type */
+
+/** Handle a complete session as described by a session descriptor
+ *
+ * This method will handle a complete ppm session, meaning it will:
+ * - send session frame
+ * - send page frame(s) as provided by the page source
+ * - read/verify page ack(s) -> if enabled
+ * - read/verify session ack -> if enabled
+ * - extract the session result from the session ack -> if enabled
+ *
+ * No memory is allocated while handling a session.
+ *
+ * @param[in]  config  session configuration.
+ * @param[in]  desc  session descriptor.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+esp_err_t ppmsession_run(const ppm_session_config_t * config, const ppm_session_desc_t * desc);
+
+/** Get the session engine statistics
+ *
+ * @param[out]  stats  statistics gathered since the last reset.
+ */
+void ppmsession_getStats(ppm_session_stats_t * stats);
+
+/** Reset the session engine statistics */
+void ppmsession_resetStats(void);
+
+/** Get the number of arena bytes needed by the sessions
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  max_data_length  largest data length (in bytes) passed to any of the sessions.
+ *
+ * @return  number of arena bytes in use at most during a session.
+ */
+size_t ppmsession_getArenaSize(size_t max_data_length);
+
 /** Send unlock session mode on the bus
  *
  * @param[in]  config  session configuration.
@@ -213,6 +363,25 @@ esp_err_t ppmsession_doFlashProgramming(const ppm_session_config_t * config,
                                         const uint8_t * flash_bytes,
                                         size_t length);
 
+/** Send a flash programming session with the pages provided by a page source
+ *
+ * The pages are requested from the source in programming order, i.e. page 1 up to the last page
+ * followed by page 0.
+ *
+ * @param[in]  config  session configuration.
+ * @param[in]  page_count  number of pages in the flash.
+ * @param[in]  flash_crc  crc of the complete flash content.
+ * @param[in]  source  page source providing the page data.
+ * @param[in]  source_ctx  context passed to the page source.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+esp_err_t ppmsession_doFlashProgrammingPages(const ppm_session_config_t * config,
+                                             uint16_t page_count,
+                                             uint32_t flash_crc,
+                                             ppm_page_source_t source,
+                                             void * source_ctx);
+
 /** Send an eeprom programming session
  *
  * @param[in]  config  session configuration.
@@ -239,6 +408,36 @@ esp_err_t ppmsession_doFlashCsProgramming(const ppm_session_config_t * config,
                                           const uint8_t * data_bytes,
                                           size_t data_length);
 
+/** Send a flash cs programming session with the pages provided by a page source
+ *
+ * @param[in]  config  session configuration.
+ * @param[in]  page_count  number of pages to program.
+ * @param[in]  flash_crc  crc of the complete flash cs content to program.
+ * @param[in]  source  page source providing the page data.
+ * @param[in]  source_ctx  context passed to the page source.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+esp_err_t ppmsession_doFlashCsProgrammingPages(const ppm_session_config_t * config,
+                                               uint16_t page_count,
+                                               uint16_t flash_crc,
+                                               ppm_page_source_t source,
+                                               void * source_ctx);
+
+/** Send a ram programming session
+ *
+ * @param[in]  config  session configuration.
+ * @param[in]  mem_offset  offset in the ram to start programming from (in bytes, shall be page aligned).
+ * @param[in]  data_bytes  ram data to upload (needs to be of size page_size*n).
+ * @param[in]  data_length  length of the ram data to upload (in bytes).
+ *
+ * @return  an error code representing the result of the operation.
+ */
+esp_err_t ppmsession_doRamProgramming(const ppm_session_config_t * config,
+                                      uint16_t mem_offset,
+                                      const uint8_t * data_bytes,
+                                      size_t data_length);
+
 /** Send a flash crc session
  *
  * @param[in]  config  session configuration.
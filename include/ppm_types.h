@@ -38,6 +38,9 @@ extern "C" {
 /** PPM distance between 2 pulse types [1/4 us] */
 #define PPM_BIT_DISTANCE (1.5 * 4)
 
+/** PPM shortest symbol time [1/4 us] */
+#define PPM_SYMBOL_BASE_TIME (4.5 * 4)
+
 /** PPM pulse low time [1/4 us] */
 #define PPM_PULSE_LOW_TIME (1.5 * 4)
 
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief PPM bus worker definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM bus worker module.
+ *
+ * The worker owns the PPM bus: it runs in a dedicated task with a configurable core affinity and
+ * priority and executes the jobs which are posted to its queue one after the other. This decouples
+ * the bus timing from the priority and core of the application task requesting the action.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "esp_err.h"
+
+#include "intelhex.h"
+
+#include "ppm_err.h"
+#include "ppm_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** PPM worker default configuration */
+#define PPM_WORKER_CONFIG_DEFAULT { \
+            .core_id = CONFIG_PPM_BOOTLOADER_WORKER_CORE_ID, \
+            .priority = CONFIG_PPM_BOOTLOADER_WORKER_PRIORITY, \
+            .stack_size = CONFIG_PPM_BOOTLOADER_WORKER_STACK_SIZE, \
+            .queue_length = CONFIG_PPM_BOOTLOADER_WORKER_QUEUE_LENGTH, \
+}
+
+/** ppm worker configuration structure */
+typedef struct ppm_worker_config_s {
+    int core_id;                        /**< core to pin the worker task to (-1 for no affinity) */
+    uint32_t priority;                  /**< priority of the worker task */
+    uint32_t stack_size;                /**< stack size of the worker task (in bytes) */
+    uint32_t queue_length;              /**< number of jobs which can be pending in the job queue */
+} ppm_worker_config_t;                  /**< ppm worker configuration type */
+
+/** ppm worker job types enum */
+typedef enum ppm_job_type_e {
+    PPM_JOB_READ_CHIP_INFO = 0,         /**< detect the connected chip, see ppmbtl_readChipInfo() */
+    PPM_JOB_DO_ACTION,                  /**< perform an action, see ppmbtl_doAction() */
+    PPM_JOB_CALL,                       /**< call a function, e.g. for the select, library or handle functions */
+} ppm_job_type_t;                       /**< ppm worker job type */
+
+/** Job function type definition (see PPM_JOB_CALL)
+ *
+ * @param[in]  arg  argument as passed with the job.
+ * @returns  result of the job.
+ */
+typedef ppm_err_t (*ppm_job_func_t)(void *arg);
+
+/** Job done callback type definition
+ *
+ * @param[in]  result  result of the executed job.
+ * @param[in]  user_ctx  user context as passed with the job.
+ *
+ * @warning method is called in the context of the worker task and shall not block.
+ */
+typedef void (*ppm_job_done_cb_t)(ppm_err_t result, void *user_ctx);
+
+/** ppm worker job structure */
+typedef struct ppm_job_s {
+    ppm_job_type_t type;                /**< type of job to execute */
+    bool manpow;                        /**< enable manual power cycling */
+    bool broadcast;                     /**< enable broadcast mode during upload */
+    uint32_t bitrate;                   /**< bitrate to be used during bootloader operations [bps] */
+    ppm_memory_t memory;                /**< memory type to perform action on */
+    ppm_action_t action;                /**< action type to perform */
+    ihexContainer_t * ihex;             /**< intel hex container to perform action with */
+    uint16_t * project_id;              /**< location to store the detected project ID (chip info job) */
+    ppm_job_func_t func;                /**< function to call (call job) */
+    void * arg;                         /**< argument passed to the function (call job) */
+    ppm_job_done_cb_t done_cb;          /**< callback invoked once the job has been executed (optional) */
+    void * user_ctx;                    /**< user context passed to the done callback */
+} ppm_job_t;                            /**< ppm worker job type */
+
+/** start the ppm worker task
+ *
+ * @param[in]  config  worker configuration.
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmworker_start(const ppm_worker_config_t * config);
+
+/** stop the ppm worker task
+ *
+ * Jobs which are pending in the queue when the stop is requested are executed before the worker
+ * stops. Jobs which are posted while stopping are completed with PPM_FAIL_INTERNAL through their
+ * done callback, further posts fail with ESP_ERR_INVALID_STATE.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmworker_stop(void);
+
+/** get the number of arena bytes the worker allocates when started
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  config  worker configuration.
+ * @returns  number of arena bytes.
+ */
+size_t ppmworker_getArenaSize(const ppm_worker_config_t * config);
+
+/** post a job to the ppm worker
+ *
+ * The job is copied into the queue, all buffers it refers to shall remain valid until the done
+ * callback has been invoked.
+ *
+ * @param[in]  job  job to be executed.
+ * @param[in]  timeout  time to wait for space in the job queue (in ms).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmworker_post(const ppm_job_t * job, uint32_t timeout);
+
+/** detect which chip is connected using the ppm worker and wait for the result
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[out]  project_id  project ID of the connected chip.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmworker_readChipInfo(bool manpow, uint16_t * project_id);
+
+/** perform an action using the ppm worker and wait for the result
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  enable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used during bootloader operations.
+ * @param[in]  memory  memory type to perform action on.
+ * @param[in]  action  action type to perform.
+ * @param[in]  ihex  intel hex container to perform action with.
+ * @returns  error code representing the result of the action.
+ */
+ppm_err_t ppmworker_doAction(bool manpow,
+                             bool broadcast,
+                             uint32_t bitrate,
+                             ppm_memory_t memory,
+                             ppm_action_t action,
+                             ihexContainer_t * ihex);
+
+/** call a function using the ppm worker and wait for the result
+ *
+ * Runs any other library function (e.g. ppmbtl_doSelectAction(), ppmbtl_doLibraryAction() or a
+ * sequence of calls on a ppmbtl_open() handle) on the worker task.
+ *
+ * @param[in]  func  function to call.
+ * @param[in]  arg  argument passed to the function.
+ * @returns  result of the function.
+ */
+ppm_err_t ppmworker_call(ppm_job_func_t func, void * arg);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -37,9 +37,70 @@
 extern "C" {
 #endif
 
+/** Maximum number of data words in a ppm frame */
+#define RMT_PPM_MAX_FRAME_WORDS 130u
+
+/** Highest bitrate whose symbol values are at least 2 channel ticks apart [bps] */
+#define RMT_PPM_MAX_BITRATE 888000u
+
+/** Largest number of buses driven by a broadcast (including the primary bus) */
+#define RMT_PPM_MAX_BUSES 4u
+
+/** RMT PPM broadcast bus configuration */
+typedef struct {
+    gpio_num_t tx_gpio_num;       /**< GPIO driving the bus */
+    gpio_num_t rx_gpio_num;       /**< GPIO receiving the bus acknowledges (GPIO_NUM_NC when not read) */
+} rmt_ppm_bus_config_t;
+
+/** RMT PPM receive link statistics */
+typedef struct {
+    uint32_t frames_received;     /**< number of frames decoded and queued */
+    uint32_t decode_errors;       /**< number of frames dropped for an invalid frame type pulse */
+    uint32_t timing_errors;       /**< number of frames truncated at a symbol outside the timing windows */
+    uint32_t rx_overflows;        /**< number of frames dropped because the RX queue was full */
+    uint32_t glitches_merged;     /**< number of glitch symbols merged into their neighbour */
+    uint32_t resyncs;             /**< number of frames resynchronized on a later frame type pulse */
+    uint32_t repairs_rejected;    /**< number of repaired frames not matching the expected acknowledge */
+    uint32_t echoes_suppressed;   /**< number of own transmissions dropped on a shared TX/RX pin */
+    uint32_t stale_discarded;     /**< number of late responses to earlier frames discarded */
+    uint16_t timebase_permille;   /**< slave timebase of the last received frame relative to nominal [1/1000] */
+} rmt_ppm_link_stats_t;
+
+/** RMT PPM fault model, applied to the responses received from the bus */
+typedef struct {
+    uint32_t seed;                /**< seed of the fault generator (equal seeds inject equal faults) */
+    uint16_t drop_permille;       /**< probability a response is dropped [1/1000] */
+    uint16_t corrupt_permille;    /**< probability one symbol of a response is corrupted [1/1000] */
+    uint16_t jitter_percent;      /**< largest random deviation of every symbol time [%] */
+    uint16_t late_permille;       /**< probability a response is delivered late [1/1000] */
+    uint16_t late_ms;             /**< delay of a late response [ms] */
+    uint16_t session_ack_delay_ms; /**< delay of every session acknowledge, e.g. a slow erase [ms] */
+    uint16_t stuck_permille;      /**< probability the bus gets stuck at a response [1/1000] */
+    uint16_t stuck_frames;        /**< number of responses lost while the bus is stuck */
+} rmt_ppm_fault_model_t;
+
+/** RMT PPM injected fault counters */
+typedef struct {
+    uint32_t dropped;             /**< number of responses dropped */
+    uint32_t corrupted;           /**< number of responses with a corrupted symbol */
+    uint32_t jittered;            /**< number of responses with jittered symbol times */
+    uint32_t delayed;             /**< number of responses delivered late */
+    uint32_t stuck;               /**< number of responses lost on a stuck bus */
+} rmt_ppm_fault_stats_t;
+
+/** RMT PPM encoder/decoder self test result */
+typedef struct {
+    uint32_t frames;              /**< number of random frames tested */
+    uint32_t splits;              /**< number of encodings truncated over several rounds */
+    uint32_t mismatches;          /**< number of encodings or decoded frames differing from the reference, and failed echo checks */
+    uint32_t encode_symbols_per_s; /**< encoder throughput [symbols/s] */
+    uint32_t decode_symbols_per_s; /**< decoder throughput [symbols/s] */
+} rmt_ppm_selftest_result_t;
+
 typedef struct {
     gpio_num_t tx_gpio_num;       /**< GPIO pin to use for TX */
     gpio_num_t rx_gpio_num;       /**< GPIO pin to use for RX */
+    size_t max_tx_words;          /**< largest frame to be transmitted (words), sizes the TX channel memory, 0 for the maximum */
 } rmt_ppm_config_t;
 
 /** Frame received callback type definition */
@@ -58,6 +119,23 @@ esp_err_t rmt_ppm_init(const rmt_ppm_config_t *cfg);
  */
 esp_err_t rmt_ppm_deinit(void);
 
+/** Get the number of arena bytes the RMT PPM module allocates during init.
+ *
+ * Includes one response buffer of rmt_ppm_wait_for_response_frame(). Only relevant when
+ * CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @returns  number of arena bytes.
+ */
+size_t rmt_ppm_get_arena_size(void);
+
+/** Get the number of arena bytes rmt_ppm_run_selftest() allocates.
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @returns  number of arena bytes.
+ */
+size_t rmt_ppm_get_selftest_arena_size(void);
+
 /** Enable the RMT PPM module.
  *
  * @returns  error code representing the result of the action.
@@ -72,7 +150,10 @@ esp_err_t rmt_ppm_disable(void);
 
 /** Configure the average bitrate of the RMT PPM module.
  *
- * @param[in]  bitrate  bitrate to be applied from this calibration frame [bps].
+ * The symbol times of all following frames, the calibration frame included, are scaled to the
+ * bitrate, as are the decoding windows of the responses. Queued frames are transmitted first.
+ *
+ * @param[in]  bitrate  bitrate to be applied from this calibration frame (1..RMT_PPM_MAX_BITRATE) [bps].
  * @returns  error code representing the result of the action.
  */
 esp_err_t rmt_ppm_set_bitrate(uint32_t bitrate);
@@ -99,6 +180,27 @@ esp_err_t rmt_ppm_send_calibration_frame(void);
  */
 esp_err_t rmt_ppm_send_frame(ppm_frame_type_t type, const uint16_t * data, size_t length);
 
+/** Queue a frame for transmission on the bus and return without waiting for it
+ *
+ * Frames queued back to back are transmitted without software intervention, each followed by
+ * idle_us of idle bus (e.g. the gap between a session frame and its first page). At most 4 frames
+ * are queued, a further frame first waits for the queued ones. While broadcasting or recording a
+ * golden trace the frame is sent before returning.
+ *
+ * @param[in]  type     the frame type to be transmitted.
+ * @param[in]  data     the data to be transmitted in this frame (copied).
+ * @param[in]  length   the length of the data to be transmitted in the frame (1..129 words).
+ * @param[in]  idle_us  idle time after the frame (0..16000 us).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_send_frame_async(ppm_frame_type_t type, const uint16_t * data, size_t length, uint32_t idle_us);
+
+/** Wait until all queued frames, including their idle time, are transmitted.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_wait_tx_done(void);
+
 /** Wait for some time to receive a valid ppm frame on the bus.
  *
  * @param[out]  type     the type of the received frame.
@@ -108,6 +210,144 @@ esp_err_t rmt_ppm_send_frame(ppm_frame_type_t type, const uint16_t * data, size_
  */
 size_t rmt_ppm_wait_for_response_frame(ppm_frame_type_t * type, uint16_t ** data, uint16_t bus_timeout);
 
+/** Wait for some time to receive a valid ppm frame on the bus into a caller provided buffer.
+ *
+ * @param[out]  type     the type of the received frame.
+ * @param[out]  data     buffer receiving the data of the received frame.
+ * @param[in]   max_length  size of the data buffer (in words).
+ * @param[in]   bus_timeout  time to wait for a response on the bus (in ms).
+ * @return  the length of the data received (0 on timeout or when the frame does not fit).
+ */
+size_t rmt_ppm_receive_frame(ppm_frame_type_t * type, uint16_t * data, size_t max_length, uint16_t bus_timeout);
+
+/** Wait for some time to receive the acknowledge of a transmitted frame.
+ *
+ * The wait is tagged with the expected frame type and the tag bits of the expected first word
+ * (e.g. the page sequence number). Frames of another type or with another tag are stale responses
+ * to earlier frames: they are discarded and the wait continues until the timeout. Frames repaired
+ * by the glitch tolerant decoder are only accepted when their first word fully matches the
+ * expected acknowledge word. Other frames are returned as is for the caller to validate.
+ *
+ * @param[in]   type     expected frame type of the acknowledge.
+ * @param[in]   expected  expected first data word of the acknowledge.
+ * @param[in]   tag_mask  bits of the first data word identifying the acknowledged frame.
+ * @param[out]  data     buffer receiving the data of the received frame.
+ * @param[in]   max_length  size of the data buffer (in words).
+ * @param[in]   bus_timeout  time to wait for a response on the bus (in ms).
+ * @return  the length of the data received (0 on timeout or when the frame does not fit).
+ */
+size_t rmt_ppm_receive_ack(ppm_frame_type_t type,
+                           uint16_t expected,
+                           uint16_t tag_mask,
+                           uint16_t * data,
+                           size_t max_length,
+                           uint16_t bus_timeout);
+
+/** Wait for some time to receive the acknowledge of a transmitted frame on one bus of a broadcast.
+ *
+ * Same as rmt_ppm_receive_ack() for bus 0 (the primary bus), bus 1 and up are the buses configured
+ * with rmt_ppm_set_broadcast(). Responses of the other buses are neither fault injected nor traced.
+ *
+ * @param[in]   bus      bus index (0..number of broadcast buses).
+ * @param[in]   type     expected frame type of the acknowledge.
+ * @param[in]   expected  expected first data word of the acknowledge.
+ * @param[in]   tag_mask  bits of the first data word identifying the acknowledged frame.
+ * @param[out]  data     buffer receiving the data of the received frame.
+ * @param[in]   max_length  size of the data buffer (in words).
+ * @param[in]   bus_timeout  time to wait for a response on the bus (in ms).
+ * @return  the length of the data received (0 on timeout, when the frame does not fit or when the
+ *          bus does not read acknowledges).
+ */
+size_t rmt_ppm_receive_bus_ack(size_t bus,
+                               ppm_frame_type_t type,
+                               uint16_t expected,
+                               uint16_t tag_mask,
+                               uint16_t * data,
+                               size_t max_length,
+                               uint16_t bus_timeout);
+
+/** Drive additional buses together with the primary bus (broadcast fan-out).
+ *
+ * While configured, every transmission (enter ppm pattern, calibration, session and page frames) is
+ * encoded once into a symbol buffer which is transmitted on the primary bus and on all additional
+ * buses. The channels are started together by an RMT sync manager, so all devices receive the
+ * same frames at the same time. The primary bus keeps the DMA channel, the additional buses use
+ * the plain channel memory, so their acknowledges shall fit in SOC_RMT_MEM_WORDS_PER_CHANNEL symbols
+ * (session and page acknowledges do).
+ *
+ * With CONFIG_PPM_BOOTLOADER_STATIC_ALLOC, the arena shall provide rmt_ppm_get_broadcast_arena_size()
+ * bytes on top of the ppmbtl_getArenaSize() bytes. The RMT driver allocates the channels, encoders
+ * and sync manager from the heap, so configure the buses once during setup: calling it again with
+ * the active configuration keeps all resources and allocates nothing.
+ *
+ * @param[in]  buses  configuration of the additional buses, NULL to stop broadcasting.
+ * @param[in]  count  number of additional buses (0..RMT_PPM_MAX_BUSES - 1).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_set_broadcast(const rmt_ppm_bus_config_t * buses, size_t count);
+
+/** Get the number of arena bytes allocated to drive additional buses.
+ *
+ * Only relevant when CONFIG_PPM_BOOTLOADER_STATIC_ALLOC is enabled.
+ *
+ * @param[in]  buses  configuration of the additional buses.
+ * @param[in]  count  number of additional buses.
+ * @returns  number of arena bytes.
+ */
+size_t rmt_ppm_get_broadcast_arena_size(const rmt_ppm_bus_config_t * buses, size_t count);
+
+/** Discard all received frames which have not been read yet.
+ *
+ * @return  number of discarded frames.
+ */
+size_t rmt_ppm_flush_rx(void);
+
+/** Get the receive link statistics.
+ *
+ * @param[out]  stats  statistics collected since init or the last reset.
+ */
+void rmt_ppm_get_link_stats(rmt_ppm_link_stats_t * stats);
+
+/** Reset the receive link statistics. */
+void rmt_ppm_reset_link_stats(void);
+
+/** Run the encoder/decoder round trip self test.
+ *
+ * Random session and page frames are encoded in a single round and truncated at every possible
+ * round size, as done by the RMT ping-pong buffers, and all encodings are compared. The symbols are
+ * then decoded as received on the bus and compared with the frame. Finally the echo suppression of
+ * a session frame and page 0 queued together on a shared pin is checked. The bus is not used, the
+ * test buffers are allocated for the duration of the test.
+ *
+ * @param[in]   frames  number of random frames to test.
+ * @param[in]   seed    seed of the random frame generator.
+ * @param[out]  result  test result and encoder/decoder throughput.
+ * @returns  ESP_OK when all round trips match, ESP_ERR_INVALID_RESPONSE otherwise.
+ */
+esp_err_t rmt_ppm_run_selftest(uint32_t frames, uint32_t seed, rmt_ppm_selftest_result_t * result);
+
+/** Scale the response timeouts of all receive functions.
+ *
+ * @param[in]  percent  applied timeout relative to the requested timeout [%] (100 for nominal).
+ */
+void rmt_ppm_set_timeout_scale(uint16_t percent);
+
+/** Set the fault model applied to the responses received from the bus.
+ *
+ * Only available when CONFIG_PPM_BOOTLOADER_FAULT_INJECTION is enabled. Setting a model restarts
+ * the fault generator from the model seed and resets the fault counters.
+ *
+ * @param[in]  model  fault model to apply, NULL to stop injecting faults.
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_set_fault_model(const rmt_ppm_fault_model_t * model);
+
+/** Get the injected fault counters.
+ *
+ * @param[out]  stats  faults injected since the fault model was set.
+ */
+void rmt_ppm_get_fault_stats(rmt_ppm_fault_stats_t * stats);
+
 /** @} */
 
 #ifdef __cplusplus
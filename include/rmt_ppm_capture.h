@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief RMT PPM symbol capture definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the RMT PPM symbol capture module.
+ *
+ * With CONFIG_PPM_BOOTLOADER_CAPTURE enabled, every symbol generated by the PPM encoder and every
+ * symbol buffer received by the RMT RX channel is recorded in a fixed size ring, oldest entries
+ * being overwritten. Symbols are recorded in blocks: a transmitted frame or a received symbol
+ * buffer. Each entry holds the start time of its block and the offset of the symbol within the
+ * block, so the waveform can be reconstructed even when the start of a block has been overwritten.
+ *
+ * The ring is printed on the console with rmt_ppm_capture_dump(), tools/ppm_capture_export.py
+ * converts such a console log into a VCD or CSV file for a logic analyzer viewer.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "hal/rmt_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** RMT PPM capture direction enum */
+typedef enum {
+    RMT_PPM_CAPTURE_TX = 0,       /**< symbol generated by the encoder (before output inversion) */
+    RMT_PPM_CAPTURE_RX = 1,       /**< symbol received by the RX channel (after input inversion) */
+} rmt_ppm_capture_dir_t;
+
+/** RMT PPM capture ring entry */
+typedef struct {
+    uint32_t time;                /**< start time of the symbol block [us] */
+    uint32_t offset;              /**< start of the symbol relative to the block start [ticks] */
+    rmt_symbol_word_t symbol;     /**< captured symbol */
+    uint8_t direction;            /**< capture direction (rmt_ppm_capture_dir_t) */
+    uint8_t reserved[3];          /**< reserved for future use (0) */
+} rmt_ppm_capture_entry_t;
+
+/** Start recording symbols, the ring is cleared.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_capture_start(void);
+
+/** Stop recording symbols, the ring content is kept.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_capture_stop(void);
+
+/** Read the recorded symbols, oldest first, removing them from the ring.
+ *
+ * @param[out]  entries      buffer receiving the entries.
+ * @param[in]   max_entries  size of the entries buffer.
+ * @return  number of entries read.
+ */
+size_t rmt_ppm_capture_read(rmt_ppm_capture_entry_t * entries, size_t max_entries);
+
+/** Get the number of entries overwritten before they were read.
+ *
+ * @return  number of entries lost since the capture was started.
+ */
+uint32_t rmt_ppm_capture_get_lost(void);
+
+/** Get the tick resolution of the captured symbol durations.
+ *
+ * @return  resolution [Hz].
+ */
+uint32_t rmt_ppm_capture_get_resolution(void);
+
+/** Print the recorded symbols on the console, removing them from the ring.
+ *
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_capture_dump(void);
+
+/** Set the tick resolution of the RMT channels (RMT PPM layer only).
+ *
+ * @param[in]  resolution_hz  channel resolution [Hz].
+ */
+void rmt_ppm_capture_set_resolution(uint32_t resolution_hz);
+
+/** Record symbols written by the encoder (RMT PPM layer only, ISR safe).
+ *
+ * @param[in]  symbols      symbols encoded in this encoder round.
+ * @param[in]  count        number of symbols.
+ * @param[in]  frame_start  the symbols are the first ones of a new transmission.
+ */
+void rmt_ppm_capture_tx(const rmt_symbol_word_t * symbols, size_t count, bool frame_start);
+
+/** Record a received symbol buffer (RMT PPM layer only, ISR safe).
+ *
+ * @param[in]  symbols  received symbols.
+ * @param[in]  count    number of symbols.
+ * @param[in]  idle_ns  idle time after the last symbol which ended the reception [ns].
+ */
+void rmt_ppm_capture_rx(const rmt_symbol_word_t * symbols, size_t count, uint32_t idle_ns);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
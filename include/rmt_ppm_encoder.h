@@ -26,17 +26,63 @@
  */
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 #include "driver/rmt_types.h"
 
+#include "ppm_types.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct {} rmt_ppm_encoder_config_t;
 
+/** Progress of an encoding split over several encoder rounds */
+typedef struct {
+    ppm_frame_type_t frame_type;  /**< frame type being encoded */
+    size_t byte_index;            /**< index of the next encoder input byte (0 before the frame type) */
+    size_t bits_offset;           /**< current bit pair index (0, 2, 4, 6), calibration symbol index */
+    uint8_t pulse_symbols;        /**< number of frame type pulse symbols generated (0..2) */
+} rmt_ppm_encode_state_t;
+
+/** Encode PPM symbols into a plain symbol buffer.
+ *
+ * Hardware independent core of the RMT PPM encoder. The encoder input starts with the frame type
+ * byte followed by data_size bytes. An encoding which does not fit in max_symbols is continued in
+ * the next call from the saved state.
+ *
+ * @param[in,out]  state       encoding progress (zero initialized for the first call).
+ * @param[in]      raw_data    encoder input (frame type first).
+ * @param[in]      data_size   number of encoder input bytes following the frame type.
+ * @param[out]     symbols     buffer receiving the symbols.
+ * @param[in]      max_symbols number of symbols which fit in the buffer.
+ * @param[out]     complete    set when the last symbol of the frame has been generated.
+ * @return  number of symbols generated.
+ */
+size_t rmt_ppm_encode_symbols(rmt_ppm_encode_state_t *state,
+                              const uint8_t *raw_data,
+                              size_t data_size,
+                              rmt_symbol_word_t *symbols,
+                              size_t max_symbols,
+                              bool *complete);
+
+/** Set the timebase of the encoded symbols.
+ *
+ * The symbol times are defined in units of 1/4us at the nominal bitrate. Another bitrate scales
+ * the unit, while the channel keeps its resolution. Only to be changed while nothing is encoded.
+ *
+ * @param[in]  channel_hz  resolution of the RMT channel [Hz].
+ * @param[in]  unit_hz     symbol time units per second for the bitrate in use [Hz].
+ */
+void rmt_ppm_encoder_set_timebase(uint32_t channel_hz, uint32_t unit_hz);
+
 esp_err_t rmt_ppm_encoder_new(const rmt_ppm_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
 esp_err_t rmt_ppm_encoder_delete(rmt_encoder_handle_t ret_encoder);
+size_t rmt_ppm_encoder_get_arena_size(void);
 
 /** @} */
 
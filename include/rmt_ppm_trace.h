@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @brief RMT PPM golden trace definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the RMT PPM golden trace module.
+ *
+ * With CONFIG_PPM_BOOTLOADER_TRACE enabled, the bus traffic of any sequence of bootloader actions
+ * (e.g. a ppmbtl_doAction() run against a known good bus) can be recorded into a caller provided
+ * buffer and replayed later:
+ * - every transmission is recorded with the bytes handed to the encoder, the wire time and a hash
+ *   of the symbols generated by the encoder;
+ * - every received symbol buffer is recorded as is.
+ *
+ * During a replay the transmissions still run through the encoder and the RMT TX channel, but the
+ * RX channel is ignored: the recorded symbol buffers following each transmission are fed into the
+ * decoder and the session layer instead. Every transmission is compared byte-for-byte, symbol hash
+ * and wire time against the recording, so encoder, decoder and session timing changes can be
+ * checked against a golden trace without a bus.
+ *
+ * A trace blob consists of a rmt_ppm_trace_header_t followed by the records, each record being a
+ * rmt_ppm_trace_record_t followed by its payload padded to 4 bytes: the encoder input bytes
+ * (frame type first) for a transmission, the received rmt_symbol_word_t for a reception.
+ * @{
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "hal/rmt_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Golden trace blob magic ("PPMT") */
+#define RMT_PPM_TRACE_MAGIC 0x544D5050u
+
+/** Golden trace blob format version */
+#define RMT_PPM_TRACE_VERSION 1u
+
+/** RMT PPM trace record kind enum */
+typedef enum {
+    RMT_PPM_TRACE_TX = 0,         /**< transmission */
+    RMT_PPM_TRACE_RX = 1,         /**< received symbol buffer */
+} rmt_ppm_trace_kind_t;
+
+/** RMT PPM trace blob header */
+typedef struct {
+    uint32_t magic;               /**< blob magic (RMT_PPM_TRACE_MAGIC) */
+    uint16_t version;             /**< blob format version (RMT_PPM_TRACE_VERSION) */
+    uint16_t reserved;            /**< reserved for future use (0) */
+    uint32_t resolution_hz;       /**< tick resolution of the recorded symbols [Hz] */
+    uint32_t record_count;        /**< number of records */
+    uint32_t length;              /**< length of the blob including this header (in bytes) */
+} rmt_ppm_trace_header_t;
+
+/** RMT PPM trace record */
+typedef struct {
+    uint8_t kind;                 /**< record kind (rmt_ppm_trace_kind_t) */
+    uint8_t frame_type;           /**< transmitted frame type (ppm_frame_type_t), 0 for a reception */
+    uint16_t length;              /**< number of encoder input bytes or received symbols */
+    uint32_t ticks;               /**< wire time of the generated symbols [ticks], 0 for a reception */
+    uint32_t hash;                /**< hash of the generated symbols, 0 for a reception */
+} rmt_ppm_trace_record_t;
+
+/** RMT PPM trace result */
+typedef struct {
+    uint32_t tx_frames;           /**< number of transmissions recorded or replayed */
+    uint32_t tx_mismatches;       /**< number of replayed transmissions differing from the recording */
+    uint32_t first_mismatch;      /**< record index of the first mismatch (UINT32_MAX for none) */
+    uint32_t rx_blocks;           /**< number of symbol buffers recorded or injected */
+    uint32_t rx_skipped;          /**< number of recorded symbol buffers preceding the first transmission */
+    uint32_t records_left;        /**< number of records not replayed */
+    uint64_t recorded_ticks;      /**< wire time of the recorded transmissions [ticks] */
+    uint64_t replayed_ticks;      /**< wire time of the replayed transmissions [ticks] */
+    bool truncated;               /**< the recording did not fit in the buffer */
+} rmt_ppm_trace_result_t;
+
+/** Start recording the bus traffic.
+ *
+ * @param[out]  buffer  buffer receiving the trace blob (4-byte aligned, valid until stopped).
+ * @param[in]   size    size of the buffer (in bytes).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_trace_record(uint8_t * buffer, size_t size);
+
+/** Start replaying a recorded trace.
+ *
+ * @param[in]  trace   trace blob (4-byte aligned, valid until stopped).
+ * @param[in]  length  length of the trace blob (in bytes).
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t rmt_ppm_trace_replay(const uint8_t * trace, size_t length);
+
+/** Stop recording or replaying.
+ *
+ * @param[out]  length  length of the recorded trace blob (in bytes, optional).
+ * @param[out]  result  recording or replay result (optional).
+ * @returns  ESP_OK, ESP_ERR_INVALID_SIZE when the recording was truncated, ESP_ERR_INVALID_RESPONSE
+ *           when the replay differs from the recording.
+ */
+esp_err_t rmt_ppm_trace_stop(size_t * length, rmt_ppm_trace_result_t * result);
+
+/** Check whether a recording or replay is running.
+ *
+ * @return  true while recording or replaying, transmissions shall then be done one at a time.
+ */
+bool rmt_ppm_trace_is_active(void);
+
+/** Mark the start of a transmission (RMT PPM layer only).
+ *
+ * @param[in]  raw     encoder input bytes (frame type first).
+ * @param[in]  length  number of encoder input bytes.
+ */
+void rmt_ppm_trace_begin_tx(const uint8_t * raw, size_t length);
+
+/** Mark the end of a transmission (RMT PPM layer only). */
+void rmt_ppm_trace_end_tx(void);
+
+/** Account symbols written by the encoder (RMT PPM layer only, ISR safe).
+ *
+ * @param[in]  symbols      symbols encoded in this encoder round.
+ * @param[in]  count        number of symbols.
+ * @param[in]  frame_start  the symbols are the first ones of a new transmission.
+ */
+void rmt_ppm_trace_tx(const rmt_symbol_word_t * symbols, size_t count, bool frame_start);
+
+/** Record a received symbol buffer (RMT PPM layer only, ISR safe).
+ *
+ * @param[in]  symbols  received symbols.
+ * @param[in]  count    number of symbols.
+ * @return  true when a replay is running and the reception shall be ignored.
+ */
+bool rmt_ppm_trace_rx(const rmt_symbol_word_t * symbols, size_t count);
+
+/** Get the next recorded symbol buffer to inject after a replayed transmission (RMT PPM layer only).
+ *
+ * @param[out]  count  number of symbols.
+ * @return  recorded symbols, NULL when the next record is a transmission.
+ */
+const rmt_symbol_word_t * rmt_ppm_trace_next_rx(size_t * count);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,160 @@
+/**
+ * @file
+ * @brief PPM action benchmark module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM action benchmark module.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ppm_link.h"
+#include "ppm_mem.h"
+#include "rmt_ppm.h"
+
+#include "ppm_bench.h"
+
+static const char *TAG = "ppm_bench";
+
+/** Compare two run times for sorting
+ *
+ * @param[in]  a  first run time.
+ * @param[in]  b  second run time.
+ * @returns  negative, zero or positive as a is shorter, equal or longer than b.
+ */
+static int ppmbench_compareTime(const void *a, const void *b);
+
+/** Run the action for one policy
+ *
+ * @param[in]  policy  policy to apply.
+ * @param[in]  runs  number of runs.
+ * @param[in]  action  action to benchmark.
+ * @param[in]  user_ctx  user context passed to the action.
+ * @param[out]  times  buffer receiving the run times (runs entries).
+ * @param[out]  result  result of the policy.
+ */
+static void ppmbench_runPolicy(const ppm_bench_policy_t *policy,
+                               uint32_t runs,
+                               ppm_bench_action_cb_t action,
+                               void *user_ctx,
+                               uint32_t *times,
+                               ppm_bench_result_t *result);
+
+
+static int ppmbench_compareTime(const void *a, const void *b) {
+    uint32_t time_a = *(const uint32_t *)a;
+    uint32_t time_b = *(const uint32_t *)b;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+static void ppmbench_runPolicy(const ppm_bench_policy_t *policy,
+                               uint32_t runs,
+                               ppm_bench_action_cb_t action,
+                               void *user_ctx,
+                               uint32_t *times,
+                               ppm_bench_result_t *result) {
+    uint8_t attempts = (policy->attempts != 0u) ? policy->attempts : 1u;
+    uint64_t total_us = 0u;
+
+    ppmlink_setPolicy(policy->link_policy);
+    ppmlink_resetStats();
+    rmt_ppm_set_timeout_scale(policy->timeout_percent);
+
+    for (uint32_t run = 0u; run < runs; run++) {
+        int64_t start = esp_timer_get_time();
+        ppm_err_t err = PPM_FAIL_UNKNOWN;
+        for (uint8_t attempt = 0u; (attempt < attempts) && (err != PPM_OK); attempt++) {
+            err = action(user_ctx);
+            result->attempts++;
+        }
+        times[run] = (uint32_t)(esp_timer_get_time() - start);
+        total_us += times[run];
+        if (err == PPM_OK) {
+            result->successes++;
+        }
+    }
+
+    qsort(times, runs, sizeof(uint32_t), ppmbench_compareTime);
+    result->runs = runs;
+    result->mean_us = (uint32_t)(total_us / runs);
+    result->p95_us = times[((runs * 95u) + 99u) / 100u - 1u];
+    result->max_us = times[runs - 1u];
+    ppmlink_getStats(&result->link);
+}
+
+size_t ppmbench_getArenaSize(uint32_t runs) {
+    return ppmmem_blockSize(runs * sizeof(uint32_t));
+}
+
+ppm_err_t ppmbench_run(const rmt_ppm_fault_model_t * faults,
+                       const ppm_bench_policy_t * policies,
+                       size_t policy_count,
+                       uint32_t runs,
+                       ppm_bench_action_cb_t action,
+                       void * user_ctx,
+                       ppm_bench_result_t * results) {
+    if ((policies == NULL) || (policy_count == 0u) || (runs == 0u) || (action == NULL) || (results == NULL)) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    uint32_t *times = ppmmem_malloc(runs * sizeof(uint32_t));
+    if (times == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate run times");
+        return PPM_FAIL_INTERNAL;
+    }
+
+    ppm_err_t retval = PPM_OK;
+    for (size_t i = 0u; i < policy_count; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+
+        /* every policy faces the same fault sequence */
+        if ((faults != NULL) && (rmt_ppm_set_fault_model(faults) != ESP_OK)) {
+            ESP_LOGE(TAG, "Fault injection not available");
+            retval = PPM_FAIL_INTERNAL;
+            break;
+        }
+
+        ppmbench_runPolicy(&policies[i], runs, action, user_ctx, times, &results[i]);
+        rmt_ppm_get_fault_stats(&results[i].faults);
+
+        ESP_LOGI(TAG, "%s: %u/%u ok, %u attempts, mean %u us, p95 %u us, max %u us, bitrate %u bps",
+                 (policies[i].name != NULL) ? policies[i].name : "-",
+                 (unsigned)results[i].successes,
+                 (unsigned)results[i].runs,
+                 (unsigned)results[i].attempts,
+                 (unsigned)results[i].mean_us,
+                 (unsigned)results[i].p95_us,
+                 (unsigned)results[i].max_us,
+                 (unsigned)results[i].link.bitrate);
+    }
+
+    (void)rmt_ppm_set_fault_model(NULL);
+    rmt_ppm_set_timeout_scale(100u);
+    ppmlink_setPolicy(NULL);
+    ppmmem_free(times);
+
+    return retval;
+}
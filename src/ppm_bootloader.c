@@ -39,7 +39,12 @@
 #include "mlx_chip.h"
 #include "mlx_crc.h"
 
+#include "ppm_chip.h"
 #include "ppm_err.h"
+#include "ppm_image.h"
+#include "ppm_link.h"
+#include "ppm_mem.h"
+#include "ppm_power.h"
 #include "ppm_session.h"
 #include "rmt_ppm.h"
 
@@ -47,134 +52,222 @@
 
 static const char *TAG = "ppm_btl";
 
+/** ram loader currently handling the memory sessions (NULL when the rom ppm loader is used) */
+static const ppm_ram_loader_t * active_ram_loader = NULL;
+
+/** ppm programming mode handle structure */
+struct ppm_handle_s {
+    bool manpow;                        /**< manual power cycling is enabled */
+    bool broadcast;                     /**< broadcast mode is enabled */
+    bool open;                          /**< the handle is open */
+    uint16_t project_id;                /**< project ID of the unlocked chip */
+    ppm_chip_entry_t chip;              /**< information about the unlocked chip, copied as the chip cache entry may be reused */
+};
+
+/** the single programming mode handle of the bus */
+static struct ppm_handle_s open_handle = {0};
 
-/** Get a pointer to the flash crc calculation method for a specific memory type
- *
- * @param[in]  type  type of memory to calculate crc for.
- *
- * @return  flash crc calculation method.
- */
-static flash_crc_func_t ppmbtl_getFlashCrcFunc(mlx_memory_type_t type);
 
 /** Request the ic to enter into programming mode
  *
  * @param[in]  broadcast  en/disable broadcast mode during upload.
  * @param[in]  bitrate  bitrate to be used [bps].
  * @param[in]  pattern_time  time to transmit enter ppm mode pattern (in ms).
- * @param[out]  chip_info  information about the connected chip.
+ * @param[out]  chip  information about the connected chip.
+ * @param[out]  project_id  project ID of the connected chip.
  * @return  an error code representing the result of the operation.
  */
 static ppm_err_t ppmbtl_enterProgrammingMode(bool broadcast,
                                              uint32_t bitrate,
                                              uint32_t pattern_time,
-                                             const mlx_chip_t ** chip_info);
+                                             const ppm_chip_entry_t ** chip,
+                                             uint16_t * project_id);
+
+/** Power cycle the chip if needed and enter programming mode
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  bitrate  bitrate to be used [bps].
+ * @param[out]  chip  information about the connected chip.
+ * @param[out]  project_id  project ID of the connected chip.
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t ppmbtl_beginAction(bool manpow,
+                                    bool broadcast,
+                                    uint32_t bitrate,
+                                    const ppm_chip_entry_t ** chip,
+                                    uint16_t * project_id);
+
+/** Exit programming mode and power off the chip if needed
+ *
+ * @param[in]  manpow  enable manual power cycling.
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
+ */
+static void ppmbtl_endAction(bool manpow, bool broadcast, const ppm_chip_entry_t * chip);
 
 /** Request the ic to exit from programming mode
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  broadcast  en/disable broadcast mode during upload.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_exitProgrammingMode(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_exitProgrammingMode(const ppm_chip_entry_t * chip,
                                             bool broadcast);
 
+/** Get the flash programming session configuration
+ *
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[out]  session_cfg  session configuration.
+ */
+static void ppmbtl_getFlashProgConfig(const ppm_chip_entry_t * chip,
+                                      bool broadcast,
+                                      ppm_session_config_t * session_cfg);
+
+/** Get the flash cs programming session configuration
+ *
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  memLen  number of bytes to program.
+ * @param[out]  session_cfg  session configuration.
+ */
+static void ppmbtl_getFlashCsProgConfig(const ppm_chip_entry_t * chip,
+                                        bool broadcast,
+                                        size_t memLen,
+                                        ppm_session_config_t * session_cfg);
+
 /** Program the flash memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  broadcast  en/disable broadcast mode during upload.
  * @param[in]  ihex  intel hex container to be programmed.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_programFlashMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_programFlashMemory(const ppm_chip_entry_t * chip,
                                            bool broadcast,
                                            ihexContainer_t * ihex);
 
 /** Verify the flash memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  ihex  intel hex container to be verified.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_verifyFlashMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_verifyFlashMemory(const ppm_chip_entry_t * chip,
                                           ihexContainer_t * ihex);
 
 /** Program the flash cs memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  broadcast  en/disable broadcast mode during upload.
  * @param[in]  ihex  intel hex container to be programmed.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_programFlashCsMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_programFlashCsMemory(const ppm_chip_entry_t * chip,
                                              bool broadcast,
                                              ihexContainer_t * ihex);
 
 /** Verify the flash cs memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  ihex  intel hex container to be verified.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_verifyFlashCsMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_verifyFlashCsMemory(const ppm_chip_entry_t * chip,
                                             ihexContainer_t * ihex);
 
 /** Program the eeprom memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  broadcast  en/disable broadcast mode during upload.
  * @param[in]  ihex  intel hex container to be programmed.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_programEepromMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_programEepromMemory(const ppm_chip_entry_t * chip,
                                             bool broadcast,
                                             ihexContainer_t * ihex);
 
 /** Verify the eeprom memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  ihex  intel hex container to be verified.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_verifyEepromMemory(const mlx_chip_t * chip_info,
+static ppm_err_t ppmbtl_verifyEepromMemory(const ppm_chip_entry_t * chip,
                                            ihexContainer_t * ihex);
 
-/** Check and if needed execute a programming keys session
+/** Program or verify a memory of the connected ic
  *
- * @param[in]  chip_info  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
  * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  memory  memory type to perform action on.
+ * @param[in]  action  action type to perform.
+ * @param[in]  ihex  intel hex container to perform action with.
  * @return  an error code representing the result of the operation.
  */
-static ppm_err_t ppmbtl_checkAndDoProgKeysSession(const mlx_chip_t * chip_info,
-                                                  bool broadcast);
+static ppm_err_t ppmbtl_memoryAction(const ppm_chip_entry_t * chip,
+                                     bool broadcast,
+                                     ppm_memory_t memory,
+                                     ppm_action_t action,
+                                     ihexContainer_t * ihex);
 
+/** Upload a ram loader and wait for it to take over
+ *
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  loader  ram loader to upload.
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t ppmbtl_startRamLoader(bool broadcast, const ppm_ram_loader_t * loader);
 
-const struct {
-    mlx_memory_type_t type;
-    flash_crc_func_t func;
-} flash_crc_funcs[] = {
-    {MEM_TYPE_GANYMEDE_XFE, crc_calcGanyXfeCrc},
-    {MEM_TYPE_GANYMEDE_KF, crc_calcGanyKfCrc},
-    {MEM_TYPE_AMALTHEA_XFE, crc_calc24bitCrc},
-    {MEM_TYPE_AMALTHEA_KF, crc_calc24bitCrc},
-    {MEM_TYPE_AMALTHEA_XFE2, crc_calc24bitCrc},
-};
+/** Program or verify a memory of the connected ic with a prepared image
+ *
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @param[in]  action  action type to perform.
+ * @param[in]  image  prepared image to perform the action with.
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t ppmbtl_imageAction(const ppm_chip_entry_t * chip,
+                                    bool broadcast,
+                                    ppm_action_t action,
+                                    const ppm_image_t * image);
+
+/** Check whether a handle refers to an open programming mode
+ *
+ * @param[in]  handle  programming mode handle as returned by ppmbtl_open().
+ * @return  true when the handle is open.
+ */
+static bool ppmbtl_handleOpen(ppm_handle_t handle);
+
+/** Page source providing the pages of a prepared image
+ *
+ * @param[in]  ctx  prepared image.
+ * @param[in]  page_index  index of the page to get.
+ * @param[out]  page_words  buffer to be filled with the page data words.
+ * @param[out]  page_checksum  checksum of the page.
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t ppmbtl_imagePageSource(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum);
+
+/** Check and if needed execute a programming keys session
+ *
+ * @param[in]  chip  information about the connected chip as returned by enter_programming_mode().
+ * @param[in]  broadcast  en/disable broadcast mode during upload.
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t ppmbtl_checkAndDoProgKeysSession(const ppm_chip_entry_t * chip,
+                                                  bool broadcast);
 
-static flash_crc_func_t ppmbtl_getFlashCrcFunc(mlx_memory_type_t type) {
-    for (int i = 0; i < sizeof(flash_crc_funcs) / sizeof(flash_crc_funcs[1]); i++) {
-        if (flash_crc_funcs[i].type == type) {
-            return flash_crc_funcs[i].func;
-        }
-    }
-    return NULL;
-}
 
 static ppm_err_t ppmbtl_enterProgrammingMode(bool broadcast,
                                              uint32_t bitrate,
                                              uint32_t pattern_time,
-                                             const mlx_chip_t ** chip_info) {
+                                             const ppm_chip_entry_t ** chip,
+                                             uint16_t * project_id) {
     ppm_err_t result = PPM_OK;
 
-    if (chip_info != NULL) {
+    if ((chip != NULL) && (project_id != NULL)) {
         if (rmt_ppm_send_enter_ppm_pattern(pattern_time) != ESP_OK) {
             result = PPM_FAIL_BTL_ENTER_PPM_MODE;
         }
@@ -193,22 +286,20 @@ static ppm_err_t ppmbtl_enterProgrammingMode(bool broadcast,
             }
         }
 
-        uint16_t project_id;
         if (result == PPM_OK) {
             ppm_session_config_t unlock_cfg = PPM_SESSION_UNLOCK_DEFAULT;
-            unlock_cfg.request_ack = !broadcast;
-            if (ppmsession_doUnlock(&unlock_cfg, &project_id) != ESP_OK) {
+            /* the chip entry and the content selection need the project ID, while broadcasting it
+             * is taken from the chip on the primary bus */
+            unlock_cfg.request_ack = true;
+            if (ppmsession_doUnlock(&unlock_cfg, project_id) != ESP_OK) {
                 result = PPM_FAIL_UNLOCK;
             }
         }
 
         if (result == PPM_OK) {
-            ESP_LOGI(TAG, "Detected project id %i", project_id);
-            *chip_info = mlxchip_get_camcu_chip(project_id);
-            if (*chip_info == NULL) {
-                *chip_info = mlxchip_get_ganymede_chip(project_id);
-            }
-            if ((*chip_info == NULL) || ((*chip_info)->bootloaders.ppm_loader == NULL)) {
+            ESP_LOGI(TAG, "Detected project id %i", *project_id);
+            *chip = ppmchip_lookup(*project_id);
+            if ((*chip == NULL) || ((*chip)->chip_info->bootloaders.ppm_loader == NULL)) {
                 result = PPM_FAIL_CHIP_NOT_SUPPORTED;
             }
         }
@@ -219,9 +310,34 @@ static ppm_err_t ppmbtl_enterProgrammingMode(bool broadcast,
     return result;
 }
 
-static ppm_err_t ppmbtl_exitProgrammingMode(const mlx_chip_t * chip_info, bool broadcast) {
+static ppm_err_t ppmbtl_beginAction(bool manpow,
+                                    bool broadcast,
+                                    uint32_t bitrate,
+                                    const ppm_chip_entry_t ** chip,
+                                    uint16_t * project_id) {
+    uint32_t pattern_time = 50000u;
+    if (manpow) {
+        pattern_time = 100000u;
+    } else {
+        ppmpower_prepareChip();
+    }
+
+    ppmlink_beginAction();
+    return ppmbtl_enterProgrammingMode(broadcast, ppmlink_selectBitrate(bitrate), pattern_time, chip, project_id);
+}
+
+static void ppmbtl_endAction(bool manpow, bool broadcast, const ppm_chip_entry_t * chip) {
+    (void)ppmbtl_exitProgrammingMode(chip, broadcast);
+    ppmlink_endAction();
+
+    if (!manpow) {
+        ppmpower_setChip(false);
+    }
+}
+
+static ppm_err_t ppmbtl_exitProgrammingMode(const ppm_chip_entry_t * chip, bool broadcast) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if (chip_info != NULL) {
+    if (chip != NULL) {
         uint16_t proj_id_resp;
         ppm_session_config_t reset_cfg = PPM_SESSION_CHIP_RESET_DEFAULT;
         reset_cfg.request_ack = !broadcast;
@@ -234,61 +350,82 @@ static ppm_err_t ppmbtl_exitProgrammingMode(const mlx_chip_t * chip_info, bool b
     return result;
 }
 
-static ppm_err_t ppmbtl_programFlashMemory(const mlx_chip_t * chip_info, bool broadcast, ihexContainer_t * ihex) {
+static void ppmbtl_getFlashProgConfig(const ppm_chip_entry_t * chip,
+                                      bool broadcast,
+                                      ppm_session_config_t * session_cfg) {
+    *session_cfg = chip->flash_prog;
+    session_cfg->request_ack = !broadcast;
+    if ((active_ram_loader != NULL) && (active_ram_loader->page_ack_timeout != 0u)) {
+        session_cfg->pageX_ack_timeout = active_ram_loader->page_ack_timeout;
+        session_cfg->session_ack_timeout = session_cfg->pageX_ack_timeout +
+                                           (uint16_t)(chip->chip_info->memories.flash->length * 0.0000625);
+    }
+}
+
+static void ppmbtl_getFlashCsProgConfig(const ppm_chip_entry_t * chip,
+                                        bool broadcast,
+                                        size_t memLen,
+                                        ppm_session_config_t * session_cfg) {
+    *session_cfg = chip->flash_cs_prog;
+    session_cfg->request_ack = !broadcast;
+    /* the cached configuration covers the full writeable area, scale it to what is programmed */
+    session_cfg->page0_ack_timeout = (uint16_t)(memLen / chip->chip_info->memories.flash_cs->page *
+                                                chip->chip_info->memories.flash_cs->erase_time * 1.25);
+    if ((active_ram_loader != NULL) && (active_ram_loader->page_ack_timeout != 0u)) {
+        session_cfg->pageX_ack_timeout = active_ram_loader->page_ack_timeout;
+    }
+    session_cfg->session_ack_timeout = session_cfg->pageX_ack_timeout + (uint16_t)(memLen * 0.0000625);
+}
+
+static ppm_err_t ppmbtl_programFlashMemory(const ppm_chip_entry_t * chip, bool broadcast, ihexContainer_t * ihex) {
     ppm_err_t result;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        result = ppmbtl_checkAndDoProgKeysSession(chip_info, broadcast);
+        result = ppmbtl_checkAndDoProgKeysSession(chip, broadcast);
         if (result == PPM_OK) {
-            uint32_t memStart = chip_info->memories.flash->start;
-            uint32_t memEnd = chip_info->memories.flash->start + chip_info->memories.flash->length - 1;
+            uint32_t memStart = chip->chip_info->memories.flash->start;
+            uint32_t memEnd = chip->chip_info->memories.flash->start + chip->chip_info->memories.flash->length - 1;
 
             if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < memStart)) {
                 result = PPM_FAIL_MISSING_DATA;
             } else {
-                size_t memLen = chip_info->memories.flash->length;
-                uint8_t *content = malloc(memLen);
+                size_t memLen = chip->chip_info->memories.flash->length;
+                uint8_t *content = ppmmem_malloc(memLen);
                 if (content == NULL) {
                     result = PPM_FAIL_INTERNAL;
                 } else {
                     (void)intelhex_getFilled(ihex, memStart, content, memLen);
 
-                    ppm_session_config_t session_cfg = PPM_SESSION_FLASH_PROG_AMALTHEA_DEFAULT;
-                    session_cfg.request_ack = !broadcast;
-                    session_cfg.page_size = chip_info->memories.flash->page / sizeof(uint16_t);
-                    session_cfg.page0_ack_timeout = (uint16_t)(memLen / chip_info->memories.flash->erase_unit *
-                                                               chip_info->memories.flash->erase_time * 1.25);
-                    session_cfg.pageX_ack_timeout = (uint16_t)(chip_info->memories.flash->write_time * 1.25);
-                    session_cfg.session_ack_timeout = session_cfg.pageX_ack_timeout + (uint16_t)(memLen * 0.0000625);
-                    session_cfg.crc_func = ppmbtl_getFlashCrcFunc(chip_info->memories.flash->type);
+                    ppm_session_config_t session_cfg;
+                    ppmbtl_getFlashProgConfig(chip, broadcast, &session_cfg);
                     if (ppmsession_doFlashProgramming(&session_cfg, &content[0], memLen) != PPM_OK) {
                         result = PPM_FAIL_PROGRAMMING_FAILED;
                     }
                 }
-                free(content);
+                ppmmem_free(content);
             }
         }
     }
     return result;
 }
 
-static ppm_err_t ppmbtl_verifyFlashMemory(const mlx_chip_t * chip_info, ihexContainer_t * ihex) {
+static ppm_err_t ppmbtl_verifyFlashMemory(const ppm_chip_entry_t * chip, ihexContainer_t * ihex) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        size_t memLen = chip_info->memories.flash->length;
-        uint32_t memStart = chip_info->memories.flash->start;
-        uint32_t memEnd = chip_info->memories.flash->start + chip_info->memories.flash->length - 1;
+        size_t memLen = chip->chip_info->memories.flash->length;
+        uint32_t memStart = chip->chip_info->memories.flash->start;
+        uint32_t memEnd = chip->chip_info->memories.flash->start + chip->chip_info->memories.flash->length - 1;
 
         if ((memLen <= 4) ||
             (intelhex_minAddress(ihex) > memEnd) ||
             (intelhex_maxAddress(ihex) < memStart)) {
             result = PPM_FAIL_MISSING_DATA;
         } else {
-            uint16_t *content = (uint16_t *)malloc(memLen);
-            flash_crc_func_t crc_func = ppmbtl_getFlashCrcFunc(chip_info->memories.flash->type);
+            uint16_t *content = (uint16_t *)ppmmem_malloc(memLen);
+            flash_crc_func_t crc_func = chip->flash_crc_func;
             if ((content == NULL) || (crc_func == NULL)) {
                 result = PPM_FAIL_INTERNAL;
             } else {
@@ -296,90 +433,82 @@ static ppm_err_t ppmbtl_verifyFlashMemory(const mlx_chip_t * chip_info, ihexCont
                 uint32_t hex_crc = crc_func(content, memLen / 2, 1u);
                 uint32_t chip_crc;
 
-                ppm_session_config_t session_cfg = PPM_SESSION_FLASH_CRC_DEFAULT;
-                session_cfg.page_size = chip_info->memories.flash->page / sizeof(uint16_t);
-                session_cfg.session_ack_timeout = (uint16_t)(memLen * 0.0000625);
-                if ((ppmsession_doFlashCrc(&session_cfg, memLen, &chip_crc) != ESP_OK) || (chip_crc != hex_crc)) {
+                if ((ppmsession_doFlashCrc(&chip->flash_crc, memLen, &chip_crc) != ESP_OK) || (chip_crc != hex_crc)) {
                     result = PPM_FAIL_VERIFY_FAILED;
                 } else {
                     result = PPM_OK;
                 }
             }
-            free(content);
+            ppmmem_free(content);
         }
     }
     return result;
 }
 
-static ppm_err_t ppmbtl_programFlashCsMemory(const mlx_chip_t * chip_info, bool broadcast, ihexContainer_t * ihex) {
+static ppm_err_t ppmbtl_programFlashCsMemory(const ppm_chip_entry_t * chip, bool broadcast, ihexContainer_t * ihex) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        result = ppmbtl_checkAndDoProgKeysSession(chip_info, broadcast);
+        result = ppmbtl_checkAndDoProgKeysSession(chip, broadcast);
         if (result == PPM_OK) {
-            uint32_t memStart = chip_info->memories.flash_cs->start;
-            uint32_t memEnd = chip_info->memories.flash_cs->start + chip_info->memories.flash_cs->writeable - 1;
+            uint32_t memStart = chip->chip_info->memories.flash_cs->start;
+            uint32_t memEnd = chip->chip_info->memories.flash_cs->start + chip->chip_info->memories.flash_cs->writeable - 1;
 
             if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < memStart)) {
                 result = PPM_FAIL_MISSING_DATA;
             } else {
                 /* determine length to program */
-                size_t memLen = intelhex_maxAddress(ihex) - chip_info->memories.flash_cs->start + 1;
-                if (memLen > chip_info->memories.flash_cs->writeable) {
-                    memLen = chip_info->memories.flash_cs->writeable;
+                size_t memLen = intelhex_maxAddress(ihex) - chip->chip_info->memories.flash_cs->start + 1;
+                if (memLen > chip->chip_info->memories.flash_cs->writeable) {
+                    memLen = chip->chip_info->memories.flash_cs->writeable;
                 }
                 /* make page aligned */
-                if ((memLen % chip_info->memories.flash_cs->page) != 0) {
-                    memLen = memLen - (memLen % chip_info->memories.flash_cs->page) +
-                             chip_info->memories.flash_cs->page;
+                if ((memLen % chip->chip_info->memories.flash_cs->page) != 0) {
+                    memLen = memLen - (memLen % chip->chip_info->memories.flash_cs->page) +
+                             chip->chip_info->memories.flash_cs->page;
                 }
-                uint8_t *content = malloc(memLen);
+                uint8_t *content = ppmmem_malloc(memLen);
                 if (content == NULL) {
                     result = PPM_FAIL_INTERNAL;
                 } else {
                     (void)intelhex_getFilled(ihex, memStart, content, memLen);
 
-                    ppm_session_config_t session_cfg = PPM_SESSION_FLASH_CS_PROG_DEFAULT;
-                    session_cfg.request_ack = !broadcast;
-                    session_cfg.page_size = chip_info->memories.flash_cs->page / sizeof(uint16_t);
-                    session_cfg.page0_ack_timeout = (uint16_t)(memLen / chip_info->memories.flash_cs->page *
-                                                               chip_info->memories.flash_cs->erase_time * 1.25);
-                    session_cfg.pageX_ack_timeout = (uint16_t)(chip_info->memories.flash_cs->write_time * 1.25);
-                    session_cfg.session_ack_timeout = session_cfg.pageX_ack_timeout + (uint16_t)(memLen * 0.0000625);
+                    ppm_session_config_t session_cfg;
+                    ppmbtl_getFlashCsProgConfig(chip, broadcast, memLen, &session_cfg);
                     if (ppmsession_doFlashCsProgramming(&session_cfg, &content[0], memLen) != PPM_OK) {
                         result = PPM_FAIL_PROGRAMMING_FAILED;
                     }
                 }
-                free(content);
+                ppmmem_free(content);
             }
         }
     }
     return result;
 }
 
-static ppm_err_t ppmbtl_verifyFlashCsMemory(const mlx_chip_t * chip_info, ihexContainer_t * ihex) {
+static ppm_err_t ppmbtl_verifyFlashCsMemory(const ppm_chip_entry_t * chip, ihexContainer_t * ihex) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        uint32_t memStart = chip_info->memories.flash_cs->start;
-        uint32_t memEnd = chip_info->memories.flash_cs->start + chip_info->memories.flash_cs->length - 1;
+        uint32_t memStart = chip->chip_info->memories.flash_cs->start;
+        uint32_t memEnd = chip->chip_info->memories.flash_cs->start + chip->chip_info->memories.flash_cs->length - 1;
 
         if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < memStart)) {
             result = PPM_FAIL_MISSING_DATA;
         } else {
             /* determine length to program */
-            size_t memLen = intelhex_maxAddress(ihex) - chip_info->memories.flash_cs->start + 1;
-            if (memLen > chip_info->memories.flash_cs->length) {
-                memLen = chip_info->memories.flash_cs->length;
+            size_t memLen = intelhex_maxAddress(ihex) - chip->chip_info->memories.flash_cs->start + 1;
+            if (memLen > chip->chip_info->memories.flash_cs->length) {
+                memLen = chip->chip_info->memories.flash_cs->length;
             }
             /* make page aligned */
-            if ((memLen % chip_info->memories.flash_cs->page) != 0) {
-                memLen = memLen - (memLen % chip_info->memories.flash_cs->page) +
-                         chip_info->memories.flash_cs->page;
+            if ((memLen % chip->chip_info->memories.flash_cs->page) != 0) {
+                memLen = memLen - (memLen % chip->chip_info->memories.flash_cs->page) +
+                         chip->chip_info->memories.flash_cs->page;
             }
-            uint8_t *content = malloc(memLen);
+            uint8_t *content = ppmmem_malloc(memLen);
             if (content == NULL) {
                 result = PPM_FAIL_INTERNAL;
             } else {
@@ -387,34 +516,32 @@ static ppm_err_t ppmbtl_verifyFlashCsMemory(const mlx_chip_t * chip_info, ihexCo
 
                 uint16_t hex_crc = crc_calc16bitCrc(&content[0], memLen, 0x1D0Fu);
                 uint16_t chip_crc;
-                ppm_session_config_t session_cfg = PPM_SESSION_FLASH_CS_CRC_DEFAULT;
-                session_cfg.page_size = chip_info->memories.flash_cs->page / sizeof(uint16_t);
-                if ((ppmsession_doFlashCsCrc(&session_cfg, memLen, &chip_crc) != ESP_OK) || (chip_crc != hex_crc)) {
+                if ((ppmsession_doFlashCsCrc(&chip->flash_cs_crc, memLen, &chip_crc) != ESP_OK) || (chip_crc != hex_crc)) {
                     result = PPM_FAIL_VERIFY_FAILED;
                 } else {
                     result = PPM_OK;
                 }
             }
-            free(content);
+            ppmmem_free(content);
         }
     }
     return result;
 }
 
-static ppm_err_t ppmbtl_programEepromMemory(const mlx_chip_t * chip_info, bool broadcast, ihexContainer_t * ihex) {
+static ppm_err_t ppmbtl_programEepromMemory(const ppm_chip_entry_t * chip, bool broadcast, ihexContainer_t * ihex) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        result = ppmbtl_checkAndDoProgKeysSession(chip_info, broadcast);
+        result = ppmbtl_checkAndDoProgKeysSession(chip, broadcast);
         if (result == PPM_OK) {
-            uint32_t memStart = chip_info->memories.nv_memory->start;
-            uint32_t memEnd = chip_info->memories.nv_memory->start + chip_info->memories.nv_memory->writeable - 1;
+            uint32_t memStart = chip->chip_info->memories.nv_memory->start;
+            uint32_t memEnd = chip->chip_info->memories.nv_memory->start + chip->chip_info->memories.nv_memory->writeable - 1;
 
             if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < memStart)) {
                 result = PPM_FAIL_MISSING_DATA;
             } else {
-                uint8_t *content = malloc(chip_info->memories.nv_memory->writeable);
+                uint8_t *content = ppmmem_malloc(chip->chip_info->memories.nv_memory->writeable);
                 if (content == NULL) {
                     result = PPM_FAIL_INTERNAL;
                 } else {
@@ -427,28 +554,22 @@ static ppm_err_t ppmbtl_programEepromMemory(const mlx_chip_t * chip_info, bool b
                         while ((inBlock) && (currAddr < memEnd)) {
                             if (intelhex_countBytesInRange(ihex,
                                                            currAddr,
-                                                           chip_info->memories.nv_memory->page) != 0) {
+                                                           chip->chip_info->memories.nv_memory->page) != 0) {
                                 (void)intelhex_getFilled(ihex,
                                                          currAddr,
                                                          &content[currLen],
-                                                         chip_info->memories.nv_memory->page);
-                                currLen += chip_info->memories.nv_memory->page;
-                                currAddr += chip_info->memories.nv_memory->page;
+                                                         chip->chip_info->memories.nv_memory->page);
+                                currLen += chip->chip_info->memories.nv_memory->page;
+                                currAddr += chip->chip_info->memories.nv_memory->page;
                             } else {
                                 inBlock = false;
-                                currAddr = currAddr + chip_info->memories.nv_memory->page;
+                                currAddr = currAddr + chip->chip_info->memories.nv_memory->page;
                             }
                         }
                         if (currLen > 0) {
                             /* perform eeprom prog session */
-                            ppm_session_config_t session_cfg = PPM_SESSION_EEPROM_PROG_DEFAULT;
+                            ppm_session_config_t session_cfg = chip->eeprom_prog;
                             session_cfg.request_ack = !broadcast;
-                            session_cfg.page_size = chip_info->memories.nv_memory->page / sizeof(uint16_t);
-                            session_cfg.page0_ack_timeout = (uint16_t)(chip_info->memories.nv_memory->write_time *
-                                                                       1.25);
-                            session_cfg.pageX_ack_timeout = (uint16_t)(chip_info->memories.nv_memory->write_time *
-                                                                       1.25);
-                            session_cfg.session_ack_timeout = session_cfg.pageX_ack_timeout;
                             if (ppmsession_doEepromProgramming(&session_cfg,
                                                                currOff,
                                                                &content[0],
@@ -458,25 +579,25 @@ static ppm_err_t ppmbtl_programEepromMemory(const mlx_chip_t * chip_info, bool b
                         }
                     }
                 }
-                free(content);
+                ppmmem_free(content);
             }
         }
     }
     return result;
 }
 
-static ppm_err_t ppmbtl_verifyEepromMemory(const mlx_chip_t * chip_info, ihexContainer_t * ihex) {
+static ppm_err_t ppmbtl_verifyEepromMemory(const ppm_chip_entry_t * chip, ihexContainer_t * ihex) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
-    if ((ihex == NULL) || (chip_info == NULL)) {
+    if ((ihex == NULL) || (chip == NULL)) {
         result = PPM_FAIL_INTERNAL;
     } else {
-        uint32_t memStart = chip_info->memories.nv_memory->start;
-        uint32_t memEnd = chip_info->memories.nv_memory->start + chip_info->memories.nv_memory->length - 1;
+        uint32_t memStart = chip->chip_info->memories.nv_memory->start;
+        uint32_t memEnd = chip->chip_info->memories.nv_memory->start + chip->chip_info->memories.nv_memory->length - 1;
 
         if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < memStart)) {
             result = PPM_FAIL_MISSING_DATA;
         } else {
-            uint8_t *content = malloc(chip_info->memories.nv_memory->writeable);
+            uint8_t *content = ppmmem_malloc(chip->chip_info->memories.nv_memory->writeable);
             if (content == NULL) {
                 result = PPM_FAIL_INTERNAL;
             } else {
@@ -490,47 +611,182 @@ static ppm_err_t ppmbtl_verifyEepromMemory(const mlx_chip_t * chip_info, ihexCon
                     while ((inBlock) && (currAddr < memEnd)) {
                         if (intelhex_countBytesInRange(ihex,
                                                        currAddr,
-                                                       chip_info->memories.nv_memory->page) != 0) {
+                                                       chip->chip_info->memories.nv_memory->page) != 0) {
                             (void)intelhex_getFilled(ihex,
                                                      currAddr,
                                                      &content[currLen],
-                                                     chip_info->memories.nv_memory->page);
-                            currLen += chip_info->memories.nv_memory->page;
-                            currAddr += chip_info->memories.nv_memory->page;
+                                                     chip->chip_info->memories.nv_memory->page);
+                            currLen += chip->chip_info->memories.nv_memory->page;
+                            currAddr += chip->chip_info->memories.nv_memory->page;
                         } else {
                             inBlock = false;
-                            currAddr = currAddr + chip_info->memories.nv_memory->page;
+                            currAddr = currAddr + chip->chip_info->memories.nv_memory->page;
                         }
                     }
                     if (currLen > 0) {
                         /* perform eeprom crc session */
                         uint16_t hex_crc = crc_calc16bitCrc(&content[0], currLen, 0x1D0Fu);
                         uint16_t chip_crc;
-                        ppm_session_config_t session_cfg = PPM_SESSION_EEPROM_CRC_DEFAULT;
-                        session_cfg.page_size = chip_info->memories.nv_memory->page / sizeof(uint16_t);
-                        if ((ppmsession_doEepromCrc(&session_cfg, currOff, currLen, &chip_crc) != ESP_OK) ||
+                        if ((ppmsession_doEepromCrc(&chip->eeprom_crc, currOff, currLen, &chip_crc) != ESP_OK) ||
                             (chip_crc != hex_crc)) {
                             result = PPM_FAIL_VERIFY_FAILED;
                         }
                     }
                 }
             }
-            free(content);
+            ppmmem_free(content);
+        }
+    }
+    return result;
+}
+
+static ppm_err_t ppmbtl_memoryAction(const ppm_chip_entry_t * chip,
+                                     bool broadcast,
+                                     ppm_memory_t memory,
+                                     ppm_action_t action,
+                                     ihexContainer_t * ihex) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
+
+    if (memory == PPM_MEM_FLASH) {
+        if (action == PPM_ACT_PROGRAM) {
+            retval = ppmbtl_programFlashMemory(chip, broadcast, ihex);
+        } else if (action == PPM_ACT_VERIFY) {
+            retval = ppmbtl_verifyFlashMemory(chip, ihex);
+        }
+    } else if (memory == PPM_MEM_FLASH_CS) {
+        if (chip->chip_info->bootloaders.ppm_loader->flash_cs_programming_session) {
+            if (action == PPM_ACT_PROGRAM) {
+                retval = ppmbtl_programFlashCsMemory(chip, broadcast, ihex);
+            } else if (action == PPM_ACT_VERIFY) {
+                retval = ppmbtl_verifyFlashCsMemory(chip, ihex);
+            }
+        } else {
+            retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+        }
+    } else if (memory == PPM_MEM_NVRAM) {
+        if (action == PPM_ACT_PROGRAM) {
+            retval = ppmbtl_programEepromMemory(chip, broadcast, ihex);
+        } else if (action == PPM_ACT_VERIFY) {
+            if (chip->chip_info->bootloaders.ppm_loader->eeprom_verification_session) {
+                retval = ppmbtl_verifyEepromMemory(chip, ihex);
+            } else {
+                retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+            }
+        }
+    }
+
+    return retval;
+}
+
+static ppm_err_t ppmbtl_startRamLoader(bool broadcast, const ppm_ram_loader_t * loader) {
+    ppm_err_t result = PPM_OK;
+
+    ppm_session_config_t session_cfg = PPM_SESSION_RAM_PROG_DEFAULT;
+    session_cfg.request_ack = !broadcast;
+    if (loader->page_size != 0u) {
+        session_cfg.page_size = loader->page_size;
+    }
+
+    if (ppmsession_doRamProgramming(&session_cfg, loader->offset, loader->code, loader->length) != ESP_OK) {
+        ESP_LOGE(TAG, "ram loader upload failed");
+        result = PPM_FAIL_RAM_LOADER;
+    }
+
+    if (result == PPM_OK) {
+        /* give the loader time to start before talking to it */
+        vTaskDelay(loader->start_time / portTICK_PERIOD_MS);
+
+        if (loader->bitrate != 0u) {
+            if (rmt_ppm_set_bitrate(loader->bitrate) != ESP_OK) {
+                result = PPM_FAIL_SET_BAUD;
+            } else if (rmt_ppm_send_calibration_frame() != ESP_OK) {
+                result = PPM_FAIL_CALIBRATION;
+            }
+        }
+    }
+
+    return result;
+}
+
+static esp_err_t ppmbtl_imagePageSource(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum) {
+    return ppmimage_getPage((const ppm_image_t *)ctx, page_index, page_words, page_checksum);
+}
+
+static ppm_err_t ppmbtl_imageAction(const ppm_chip_entry_t * chip,
+                                    bool broadcast,
+                                    ppm_action_t action,
+                                    const ppm_image_t * image) {
+    ppm_err_t result = PPM_FAIL_UNKNOWN;
+    const ppm_image_header_t * header = image->header;
+    ppm_session_config_t session_cfg;
+
+    if (header->memory == PPM_MEM_FLASH) {
+        if (header->page_size != (chip->chip_info->memories.flash->page / sizeof(uint16_t))) {
+            result = PPM_FAIL_INV_IMAGE;
+        } else if (action == PPM_ACT_PROGRAM) {
+            result = ppmbtl_checkAndDoProgKeysSession(chip, broadcast);
+            if (result == PPM_OK) {
+                ppmbtl_getFlashProgConfig(chip, broadcast, &session_cfg);
+                if (ppmsession_doFlashProgrammingPages(&session_cfg,
+                                                       header->page_count,
+                                                       header->crc,
+                                                       ppmbtl_imagePageSource,
+                                                       (void *)image) != ESP_OK) {
+                    result = PPM_FAIL_PROGRAMMING_FAILED;
+                }
+            }
+        } else if (action == PPM_ACT_VERIFY) {
+            uint32_t chip_crc;
+            if ((ppmsession_doFlashCrc(&chip->flash_crc, header->data_length, &chip_crc) != ESP_OK) ||
+                (chip_crc != header->crc)) {
+                result = PPM_FAIL_VERIFY_FAILED;
+            } else {
+                result = PPM_OK;
+            }
         }
+    } else if (header->memory == PPM_MEM_FLASH_CS) {
+        if (!chip->chip_info->bootloaders.ppm_loader->flash_cs_programming_session) {
+            result = PPM_FAIL_ACTION_NOT_SUPPORTED;
+        } else if (header->page_size != (chip->chip_info->memories.flash_cs->page / sizeof(uint16_t))) {
+            result = PPM_FAIL_INV_IMAGE;
+        } else if (action == PPM_ACT_PROGRAM) {
+            result = ppmbtl_checkAndDoProgKeysSession(chip, broadcast);
+            if (result == PPM_OK) {
+                ppmbtl_getFlashCsProgConfig(chip, broadcast, header->data_length, &session_cfg);
+                if (ppmsession_doFlashCsProgrammingPages(&session_cfg,
+                                                         header->page_count,
+                                                         (uint16_t)header->crc,
+                                                         ppmbtl_imagePageSource,
+                                                         (void *)image) != ESP_OK) {
+                    result = PPM_FAIL_PROGRAMMING_FAILED;
+                }
+            }
+        } else if (action == PPM_ACT_VERIFY) {
+            uint16_t chip_crc;
+            if ((ppmsession_doFlashCsCrc(&chip->flash_cs_crc, header->data_length, &chip_crc) != ESP_OK) ||
+                (chip_crc != (uint16_t)header->crc)) {
+                result = PPM_FAIL_VERIFY_FAILED;
+            } else {
+                result = PPM_OK;
+            }
+        }
+    } else {
+        result = PPM_FAIL_ACTION_NOT_SUPPORTED;
     }
+
     return result;
 }
 
-static ppm_err_t ppmbtl_checkAndDoProgKeysSession(const mlx_chip_t * chip_info, bool broadcast) {
+static ppm_err_t ppmbtl_checkAndDoProgKeysSession(const ppm_chip_entry_t * chip, bool broadcast) {
     ppm_err_t result = PPM_FAIL_UNKNOWN;
 
-    if ((chip_info->bootloaders.ppm_loader != NULL) &&
-        (chip_info->bootloaders.ppm_loader->prog_keys != NULL)) {
-        ppm_session_config_t prog_keys_cfg = PPM_SESSION_PROG_KEYS_DEFAULT;
+    if ((chip->chip_info->bootloaders.ppm_loader != NULL) &&
+        (chip->chip_info->bootloaders.ppm_loader->prog_keys != NULL)) {
+        ppm_session_config_t prog_keys_cfg = chip->prog_keys;
         prog_keys_cfg.request_ack = !broadcast;
         if (ppmsession_doFlashProgKeys(&prog_keys_cfg,
-                                       chip_info->bootloaders.ppm_loader->prog_keys->values,
-                                       chip_info->bootloaders.ppm_loader->prog_keys->length) == ESP_OK) {
+                                       chip->chip_info->bootloaders.ppm_loader->prog_keys->values,
+                                       chip->chip_info->bootloaders.ppm_loader->prog_keys->length) == ESP_OK) {
             result = PPM_OK;
         }
     }
@@ -538,10 +794,23 @@ static ppm_err_t ppmbtl_checkAndDoProgKeysSession(const mlx_chip_t * chip_info,
     return result;
 }
 
+esp_err_t ppmbtl_setArena(void *arena, size_t size) {
+    return ppmmem_setArena(arena, size);
+}
+
+size_t ppmbtl_getArenaSize(size_t max_memory_length) {
+    return rmt_ppm_get_arena_size() +
+           ppmmem_blockSize(max_memory_length) +
+           ppmsession_getArenaSize(max_memory_length) +
+           ppmimage_getArenaSize(max_memory_length) +
+           rmt_ppm_get_selftest_arena_size();
+}
+
 void ppmbtl_init(void) {
     rmt_ppm_config_t cfg = {
         .tx_gpio_num = CONFIG_PPM_BOOTLOADER_TX,
         .rx_gpio_num = CONFIG_PPM_BOOTLOADER_RX,
+        .max_tx_words = 1u + PPM_PAGE_MAX_WORDS,
     };
     ESP_ERROR_CHECK(rmt_ppm_init(&cfg));
 }
@@ -557,12 +826,16 @@ esp_err_t ppmbtl_disable(void) {
 ppm_err_t ppmbtl_readChipInfo(bool manpow, uint16_t *project_id) {
     ppm_err_t retval = PPM_OK;
 
+    if (open_handle.open) {
+        /* the chip is kept in programming mode by the open handle */
+        return PPM_FAIL_BUSY;
+    }
+
     uint32_t pattern_time = 50000u;
     if (manpow) {
         pattern_time = 100000u;
-    } else if (ppmbtl_chipPowered()) {
-        ppmbtl_chipPower(false);
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+    } else {
+        ppmpower_prepareChip();
     }
 
     if (rmt_ppm_send_enter_ppm_pattern(pattern_time) != ESP_OK) {
@@ -593,7 +866,7 @@ ppm_err_t ppmbtl_readChipInfo(bool manpow, uint16_t *project_id) {
     (void)ppmsession_doChipReset(&reset_cfg, &proj_id_resp);
 
     if (!manpow) {
-        ppmbtl_chipPower(false);
+        ppmpower_setChip(false);
     }
 
     return retval;
@@ -607,55 +880,303 @@ ppm_err_t ppmbtl_doAction(bool manpow,
                           ihexContainer_t * ihex) {
     ppm_err_t retval = PPM_FAIL_UNKNOWN;
 
-    if (ihex != NULL) {
-        uint32_t pattern_time = 50000u;
-        if (manpow) {
-            pattern_time = 100000u;
-        } else if (ppmbtl_chipPowered()) {
-            ppmbtl_chipPower(false);
-            vTaskDelay(100 / portTICK_PERIOD_MS);
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if (ihex != NULL) {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            retval = ppmbtl_memoryAction(chip, broadcast, memory, action, ihex);
         }
 
-        const mlx_chip_t * chip_info = NULL;
-        retval = ppmbtl_enterProgrammingMode(broadcast, bitrate, pattern_time, &chip_info);
+        ppmbtl_endAction(manpow, broadcast, chip);
+    } else {
+        retval = PPM_FAIL_INV_HEX_FILE;
+    }
 
-        if ((retval == PPM_OK) && (chip_info != NULL)) {
-            if (memory == PPM_MEM_FLASH) {
-                if (action == PPM_ACT_PROGRAM) {
-                    retval = ppmbtl_programFlashMemory(chip_info, broadcast, ihex);
-                } else if (action == PPM_ACT_VERIFY) {
-                    retval = ppmbtl_verifyFlashMemory(chip_info, ihex);
-                }
-            } else if (memory == PPM_MEM_FLASH_CS) {
-                if (chip_info->bootloaders.ppm_loader->flash_cs_programming_session) {
-                    if (action == PPM_ACT_PROGRAM) {
-                        retval = ppmbtl_programFlashCsMemory(chip_info, broadcast, ihex);
-                    } else if (action == PPM_ACT_VERIFY) {
-                        retval = ppmbtl_verifyFlashCsMemory(chip_info, ihex);
-                    }
-                } else {
-                    retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
-                }
-            } else if (memory == PPM_MEM_NVRAM) {
-                if (action == PPM_ACT_PROGRAM) {
-                    retval = ppmbtl_programEepromMemory(chip_info, broadcast, ihex);
-                } else if (action == PPM_ACT_VERIFY) {
-                    if (chip_info->bootloaders.ppm_loader->eeprom_verification_session) {
-                        retval = ppmbtl_verifyEepromMemory(chip_info, ihex);
-                    } else {
-                        retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
-                    }
-                }
+    return retval;
+}
+
+ppm_err_t ppmbtl_doSelectAction(bool manpow,
+                                bool broadcast,
+                                uint32_t bitrate,
+                                ppm_memory_t memory,
+                                ppm_action_t action,
+                                ppm_image_select_cb_t select_cb,
+                                void * user_ctx) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
+
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if (select_cb != NULL) {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id = 0u;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            ihexContainer_t * ihex = select_cb(project_id, chip->chip_info, user_ctx);
+            if (ihex != NULL) {
+                retval = ppmbtl_memoryAction(chip, broadcast, memory, action, ihex);
+            } else {
+                retval = PPM_FAIL_INV_HEX_FILE;
+            }
+        }
+
+        ppmbtl_endAction(manpow, broadcast, chip);
+    } else {
+        retval = PPM_FAIL_INTERNAL;
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_doLibraryAction(bool manpow,
+                                 bool broadcast,
+                                 uint32_t bitrate,
+                                 ppm_memory_t memory,
+                                 ppm_action_t action,
+                                 const ppm_library_t * library) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
+
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if ((library != NULL) && (library->header != NULL)) {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id = 0u;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            ppm_image_t image;
+            retval = ppmimage_findLibraryImage(library, project_id, memory, &image);
+            if (retval == PPM_OK) {
+                retval = ppmbtl_imageAction(chip, broadcast, action, &image);
+            } else {
+                ESP_LOGE(TAG, "no image for project id %i", project_id);
+            }
+        }
+
+        ppmbtl_endAction(manpow, broadcast, chip);
+    } else {
+        retval = PPM_FAIL_INV_IMAGE;
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_doRamLoaderAction(bool manpow,
+                                   bool broadcast,
+                                   uint32_t bitrate,
+                                   const ppm_ram_loader_t * loader,
+                                   ppm_memory_t memory,
+                                   ppm_action_t action,
+                                   ihexContainer_t * ihex) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
+
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if (ihex == NULL) {
+        retval = PPM_FAIL_INV_HEX_FILE;
+    } else if ((loader == NULL) || (loader->code == NULL) || (loader->length == 0u)) {
+        retval = PPM_FAIL_RAM_LOADER;
+    } else if (loader->bitrate > RMT_PPM_MAX_BITRATE) {
+        /* rejected before the loader is uploaded rather than at the handover */
+        retval = PPM_FAIL_SET_BAUD;
+    } else if ((memory != PPM_MEM_FLASH) && (memory != PPM_MEM_FLASH_CS)) {
+        retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+    } else {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            retval = ppmbtl_startRamLoader(broadcast, loader);
+        }
+
+        if (retval == PPM_OK) {
+            active_ram_loader = loader;
+            retval = ppmbtl_memoryAction(chip, broadcast, memory, action, ihex);
+            active_ram_loader = NULL;
+        }
+
+        ppmbtl_endAction(manpow, broadcast, chip);
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_doImageAction(bool manpow,
+                               bool broadcast,
+                               uint32_t bitrate,
+                               ppm_action_t action,
+                               const ppm_image_t * image) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
+
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if ((image != NULL) && (image->header != NULL)) {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            if ((!broadcast) && (project_id != image->header->project_id)) {
+                ESP_LOGE(TAG, "image prepared for project id %i", image->header->project_id);
+                retval = PPM_FAIL_INV_IMAGE;
+            } else {
+                retval = ppmbtl_imageAction(chip, broadcast, action, image);
             }
         }
 
-        (void)ppmbtl_exitProgrammingMode(chip_info, broadcast);
+        ppmbtl_endAction(manpow, broadcast, chip);
+    } else {
+        retval = PPM_FAIL_INV_IMAGE;
+    }
+
+    return retval;
+}
+
+static bool ppmbtl_handleOpen(ppm_handle_t handle) {
+    return (handle == &open_handle) && open_handle.open;
+}
+
+ppm_err_t ppmbtl_open(bool manpow, bool broadcast, uint32_t bitrate, ppm_handle_t * handle) {
+    ppm_err_t retval = PPM_FAIL_UNKNOWN;
 
-        if (!manpow) {
-            ppmbtl_chipPower(false);
+    if (open_handle.open) {
+        retval = PPM_FAIL_BUSY;
+    } else if (handle != NULL) {
+        const ppm_chip_entry_t * chip = NULL;
+        uint16_t project_id = 0u;
+        retval = ppmbtl_beginAction(manpow, broadcast, bitrate, &chip, &project_id);
+
+        if ((retval == PPM_OK) && (chip != NULL)) {
+            open_handle.manpow = manpow;
+            open_handle.broadcast = broadcast;
+            open_handle.project_id = project_id;
+            open_handle.chip = *chip;
+            open_handle.open = true;
+            *handle = &open_handle;
+        } else {
+            ppmbtl_endAction(manpow, broadcast, chip);
         }
     } else {
+        retval = PPM_FAIL_INTERNAL;
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_close(ppm_handle_t handle) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if (ppmbtl_handleOpen(handle)) {
+        retval = ppmbtl_exitProgrammingMode(&handle->chip, handle->broadcast);
+        ppmlink_endAction();
+        if (!handle->manpow) {
+            ppmpower_setChip(false);
+        }
+        handle->open = false;
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_getProjectId(ppm_handle_t handle, uint16_t * project_id) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if (project_id == NULL) {
+        retval = PPM_FAIL_INTERNAL;
+    } else if (ppmbtl_handleOpen(handle)) {
+        *project_id = handle->project_id;
+        retval = PPM_OK;
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_program(ppm_handle_t handle, ppm_memory_t memory, ihexContainer_t * ihex) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if (ihex == NULL) {
+        retval = PPM_FAIL_INV_HEX_FILE;
+    } else if (ppmbtl_handleOpen(handle)) {
+        retval = ppmbtl_memoryAction(&handle->chip, handle->broadcast, memory, PPM_ACT_PROGRAM, ihex);
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_verify(ppm_handle_t handle, ppm_memory_t memory, ihexContainer_t * ihex) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if (ihex == NULL) {
         retval = PPM_FAIL_INV_HEX_FILE;
+    } else if (ppmbtl_handleOpen(handle)) {
+        retval = ppmbtl_memoryAction(&handle->chip, handle->broadcast, memory, PPM_ACT_VERIFY, ihex);
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_imageOperation(ppm_handle_t handle, ppm_action_t action, const ppm_image_t * image) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if ((image == NULL) || (image->header == NULL)) {
+        retval = PPM_FAIL_INV_IMAGE;
+    } else if (ppmbtl_handleOpen(handle)) {
+        if ((!handle->broadcast) && (handle->project_id != image->header->project_id)) {
+            ESP_LOGE(TAG, "image prepared for project id %i", image->header->project_id);
+            retval = PPM_FAIL_INV_IMAGE;
+        } else {
+            retval = ppmbtl_imageAction(&handle->chip, handle->broadcast, action, image);
+        }
+    }
+
+    return retval;
+}
+
+ppm_err_t ppmbtl_readCrc(ppm_handle_t handle, ppm_memory_t memory, uint16_t offset, size_t length, uint32_t * crc) {
+    ppm_err_t retval = PPM_FAIL_INV_HANDLE;
+
+    if (crc == NULL) {
+        retval = PPM_FAIL_INTERNAL;
+    } else if (ppmbtl_handleOpen(handle)) {
+        const ppm_chip_entry_t * chip = &handle->chip;
+        esp_err_t result = ESP_FAIL;
+        uint32_t crc32 = 0u;
+        uint16_t crc16 = 0u;
+
+        retval = PPM_OK;
+        if (memory == PPM_MEM_FLASH) {
+            if (offset != 0u) {
+                retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+            } else {
+                result = ppmsession_doFlashCrc(&chip->flash_crc, length, &crc32);
+            }
+        } else if ((memory == PPM_MEM_FLASH_CS) && chip->chip_info->bootloaders.ppm_loader->flash_cs_programming_session) {
+            if (offset != 0u) {
+                retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+            } else {
+                result = ppmsession_doFlashCsCrc(&chip->flash_cs_crc, length, &crc16);
+                crc32 = crc16;
+            }
+        } else if ((memory == PPM_MEM_NVRAM) && chip->chip_info->bootloaders.ppm_loader->eeprom_verification_session) {
+            result = ppmsession_doEepromCrc(&chip->eeprom_crc, offset, length, &crc16);
+            crc32 = crc16;
+        } else {
+            retval = PPM_FAIL_ACTION_NOT_SUPPORTED;
+        }
+
+        if (retval == PPM_OK) {
+            if (result == ESP_OK) {
+                *crc = crc32;
+            } else {
+                ESP_LOGE(TAG, "crc session failed: %d", result);
+                retval = PPM_FAIL_SESSION;
+            }
+        }
     }
 
     return retval;
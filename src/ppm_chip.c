@@ -0,0 +1,155 @@
+/**
+ * @file
+ * @brief PPM chip lookup module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM chip lookup module.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "mlx_chip.h"
+#include "mlx_crc.h"
+
+#include "ppm_session.h"
+
+#include "ppm_chip.h"
+
+/** Number of chip cache entries (project IDs are direct mapped onto the entries) */
+#define CHIP_CACHE_SIZE CONFIG_PPM_BOOTLOADER_CHIP_CACHE_SIZE
+
+/** Compute the session configurations of a chip
+ *
+ * @param[in]  chip_info  chip information.
+ * @param[out]  entry  cache entry to fill in.
+ */
+static void ppmchip_prepareEntry(const mlx_chip_t * chip_info, ppm_chip_entry_t * entry);
+
+static const struct {
+    mlx_memory_type_t type;
+    flash_crc_func_t func;
+} flash_crc_funcs[] = {
+    {MEM_TYPE_GANYMEDE_XFE, crc_calcGanyXfeCrc},
+    {MEM_TYPE_GANYMEDE_KF, crc_calcGanyKfCrc},
+    {MEM_TYPE_AMALTHEA_XFE, crc_calc24bitCrc},
+    {MEM_TYPE_AMALTHEA_KF, crc_calc24bitCrc},
+    {MEM_TYPE_AMALTHEA_XFE2, crc_calc24bitCrc},
+};
+
+static ppm_chip_entry_t chip_cache[CHIP_CACHE_SIZE];
+
+static void ppmchip_prepareEntry(const mlx_chip_t * chip_info, ppm_chip_entry_t * entry) {
+    entry->chip_info = chip_info;
+    entry->flash_crc_func = ppmchip_getFlashCrcFunc(chip_info);
+    entry->prog_keys = (ppm_session_config_t)PPM_SESSION_PROG_KEYS_DEFAULT;
+
+    if (chip_info->memories.flash != NULL) {
+        const mlx_memory_t * flash = chip_info->memories.flash;
+        ppm_session_config_t * cfg = &entry->flash_prog;
+
+        *cfg = (ppm_session_config_t)PPM_SESSION_FLASH_PROG_AMALTHEA_DEFAULT;
+        cfg->page_size = flash->page / sizeof(uint16_t);
+        cfg->page0_ack_timeout = (uint16_t)(flash->length / flash->erase_unit * flash->erase_time * 1.25);
+        cfg->pageX_ack_timeout = (uint16_t)(flash->write_time * 1.25);
+        cfg->session_ack_timeout = cfg->pageX_ack_timeout + (uint16_t)(flash->length * 0.0000625);
+        cfg->crc_func = entry->flash_crc_func;
+
+        cfg = &entry->flash_crc;
+        *cfg = (ppm_session_config_t)PPM_SESSION_FLASH_CRC_DEFAULT;
+        cfg->page_size = flash->page / sizeof(uint16_t);
+        cfg->session_ack_timeout = (uint16_t)(flash->length * 0.0000625);
+    }
+
+    if (chip_info->memories.flash_cs != NULL) {
+        const mlx_memory_t * flash_cs = chip_info->memories.flash_cs;
+        ppm_session_config_t * cfg = &entry->flash_cs_prog;
+
+        *cfg = (ppm_session_config_t)PPM_SESSION_FLASH_CS_PROG_DEFAULT;
+        cfg->page_size = flash_cs->page / sizeof(uint16_t);
+        cfg->page0_ack_timeout = (uint16_t)(flash_cs->writeable / flash_cs->page * flash_cs->erase_time * 1.25);
+        cfg->pageX_ack_timeout = (uint16_t)(flash_cs->write_time * 1.25);
+        cfg->session_ack_timeout = cfg->pageX_ack_timeout + (uint16_t)(flash_cs->writeable * 0.0000625);
+
+        cfg = &entry->flash_cs_crc;
+        *cfg = (ppm_session_config_t)PPM_SESSION_FLASH_CS_CRC_DEFAULT;
+        cfg->page_size = flash_cs->page / sizeof(uint16_t);
+    }
+
+    if (chip_info->memories.nv_memory != NULL) {
+        const mlx_memory_t * nv_memory = chip_info->memories.nv_memory;
+        ppm_session_config_t * cfg = &entry->eeprom_prog;
+
+        *cfg = (ppm_session_config_t)PPM_SESSION_EEPROM_PROG_DEFAULT;
+        cfg->page_size = nv_memory->page / sizeof(uint16_t);
+        cfg->page0_ack_timeout = (uint16_t)(nv_memory->write_time * 1.25);
+        cfg->pageX_ack_timeout = (uint16_t)(nv_memory->write_time * 1.25);
+        cfg->session_ack_timeout = cfg->pageX_ack_timeout;
+
+        cfg = &entry->eeprom_crc;
+        *cfg = (ppm_session_config_t)PPM_SESSION_EEPROM_CRC_DEFAULT;
+        cfg->page_size = nv_memory->page / sizeof(uint16_t);
+    }
+}
+
+const ppm_chip_entry_t * ppmchip_lookup(uint16_t project_id) {
+    ppm_chip_entry_t * entry = &chip_cache[project_id % CHIP_CACHE_SIZE];
+
+    if ((entry->chip_info == NULL) || (entry->project_id != project_id)) {
+        const mlx_chip_t * chip_info = ppmchip_find(project_id);
+        if (chip_info == NULL) {
+            return NULL;
+        }
+
+        memset(entry, 0, sizeof(*entry));
+        entry->project_id = project_id;
+        ppmchip_prepareEntry(chip_info, entry);
+    }
+
+    return entry;
+}
+
+void ppmchip_clearCache(void) {
+    memset(chip_cache, 0, sizeof(chip_cache));
+}
+
+const mlx_chip_t * ppmchip_find(uint16_t project_id) {
+    const mlx_chip_t * chip_info = mlxchip_get_camcu_chip(project_id);
+    if (chip_info == NULL) {
+        chip_info = mlxchip_get_ganymede_chip(project_id);
+    }
+    return chip_info;
+}
+
+flash_crc_func_t ppmchip_getFlashCrcFunc(const mlx_chip_t * chip_info) {
+    if ((chip_info == NULL) || (chip_info->memories.flash == NULL)) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(flash_crc_funcs) / sizeof(flash_crc_funcs[0]); i++) {
+        if (flash_crc_funcs[i].type == chip_info->memories.flash->type) {
+            return flash_crc_funcs[i].func;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief PPM chip lookup definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM chip lookup module.
+ * @{
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "mlx_chip.h"
+#include "mlx_crc.h"
+
+#include "ppm_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** cached chip information with its precomputed session configurations
+ *
+ * The session configurations do not have request_ack set, this depends on the action. The flash cs
+ * programming configuration is computed for the full writeable flash cs.
+ */
+typedef struct ppm_chip_entry_s {
+    uint16_t project_id;                /**< project ID of the chip */
+    const mlx_chip_t * chip_info;       /**< chip information (NULL for an unused cache entry) */
+    flash_crc_func_t flash_crc_func;    /**< flash crc calculation method (NULL when not supported) */
+    ppm_session_config_t prog_keys;     /**< programming keys session configuration */
+    ppm_session_config_t flash_prog;    /**< flash programming session configuration */
+    ppm_session_config_t flash_crc;     /**< flash crc session configuration */
+    ppm_session_config_t flash_cs_prog; /**< flash cs programming session configuration */
+    ppm_session_config_t flash_cs_crc;  /**< flash cs crc session configuration */
+    ppm_session_config_t eeprom_prog;   /**< eeprom programming session configuration */
+    ppm_session_config_t eeprom_crc;    /**< eeprom crc session configuration */
+} ppm_chip_entry_t;                     /**< cached chip information type */
+
+/** Get the cached chip information for a project ID
+ *
+ * The chip is looked up in the chip database and its session configurations are computed only the
+ * first time a project ID is seen (or when it has been evicted from the cache).
+ *
+ * @param[in]  project_id  project ID as reported by the unlock session.
+ *
+ * @return  cached chip information or NULL when the project ID is unknown.
+ */
+const ppm_chip_entry_t * ppmchip_lookup(uint16_t project_id);
+
+/** Drop all cached chip information */
+void ppmchip_clearCache(void);
+
+/** Get the chip information for a project ID
+ *
+ * @param[in]  project_id  project ID as reported by the unlock session.
+ *
+ * @return  chip information or NULL when the project ID is unknown.
+ */
+const mlx_chip_t * ppmchip_find(uint16_t project_id);
+
+/** Get a pointer to the flash crc calculation method for a chip
+ *
+ * @param[in]  chip_info  chip to calculate the flash crc for.
+ *
+ * @return  flash crc calculation method (NULL when not supported).
+ */
+flash_crc_func_t ppmchip_getFlashCrcFunc(const mlx_chip_t * chip_info);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -46,6 +46,12 @@ static const struct {
     {PPM_FAIL_MISSING_DATA, "no data for the memory in the hex file"},
     {PPM_FAIL_PROGRAMMING_FAILED, "programming failed"},
     {PPM_FAIL_VERIFY_FAILED, "verification failed"},
+    {PPM_FAIL_INV_IMAGE, "prepared image is invalid or does not match the chip"},
+    {PPM_FAIL_RAM_LOADER, "uploading or starting the ram loader failed"},
+    {PPM_FAIL_NO_IMAGE, "no image for the connected chip in the library"},
+    {PPM_FAIL_INV_HANDLE, "programming mode handle is not open"},
+    {PPM_FAIL_BUSY, "a programming mode handle is open"},
+    {PPM_FAIL_SESSION, "session not acknowledged or transmission failed"},
 };
 
 const char *ppm_err_to_string(ppm_err_t code) {
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief PPM binary event trace module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM binary event trace module.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ppm_event.h"
+
+/** number of entries printed per console line while dumping */
+#define DUMP_LINE_ENTRIES 4u
+
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+static const char *TAG = "ppm_event";
+
+_Static_assert((CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES & (CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES - 1)) == 0,
+               "event trace entries shall be a power of 2");
+
+/** event ring, statically allocated as events are recorded from ISR context */
+static ppm_event_entry_t event_ring[CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES];
+static uint32_t ring_head = 0u;         /**< number of events claimed since the start */
+static uint32_t ring_tail = 0u;         /**< number of events read or lost since the start */
+static uint32_t ring_lost = 0u;         /**< number of events overwritten before being read */
+static volatile bool event_enabled = false;
+#endif
+
+esp_err_t ppmevent_start(void) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    event_enabled = false;
+    __atomic_store_n(&ring_head, 0u, __ATOMIC_RELAXED);
+    ring_tail = 0u;
+    ring_lost = 0u;
+    event_enabled = true;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t ppmevent_stop(void) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    event_enabled = false;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+size_t ppmevent_read(ppm_event_entry_t * entries, size_t max_entries) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    if (entries == NULL) {
+        return 0u;
+    }
+
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    if ((head - ring_tail) > CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES) {
+        /* the writers went around the ring */
+        ring_lost += (head - ring_tail) - CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES;
+        ring_tail = head - CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES;
+    }
+
+    size_t count = 0u;
+    while ((count < max_entries) && (ring_tail != head)) {
+        entries[count++] = event_ring[ring_tail & (CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES - 1u)];
+        ring_tail++;
+    }
+
+    return count;
+#else
+    (void)entries;
+    (void)max_entries;
+    return 0u;
+#endif
+}
+
+uint32_t ppmevent_getLost(void) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    return ring_lost;
+#else
+    return 0u;
+#endif
+}
+
+esp_err_t ppmevent_dump(void) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    ppm_event_entry_t chunk[DUMP_LINE_ENTRIES];
+    char line[(DUMP_LINE_ENTRIES * sizeof(ppm_event_entry_t) * 2u) + 1u];
+    uint32_t total = 0u;
+
+    size_t count = ppmevent_read(chunk, DUMP_LINE_ENTRIES);
+    ESP_LOGI(TAG, "ppmevt,start,%u", (unsigned)ppmevent_getLost());
+    while (count > 0u) {
+        /* entries are printed as little endian bytes, as stored in memory */
+        const uint8_t *bytes = (const uint8_t *)chunk;
+        for (size_t i = 0u; i < (count * sizeof(ppm_event_entry_t)); i++) {
+            (void)snprintf(&line[i * 2u], 3u, "%02x", bytes[i]);
+        }
+        ESP_LOGI(TAG, "ppmevt,%s", line);
+        total += count;
+        count = ppmevent_read(chunk, DUMP_LINE_ENTRIES);
+    }
+    ESP_LOGI(TAG, "ppmevt,end,%u", (unsigned)total);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void IRAM_ATTR ppmevent_record(uint16_t event, uint32_t arg0, uint32_t arg1) {
+#if CONFIG_PPM_BOOTLOADER_EVENT_TRACE
+    if (!event_enabled) {
+        return;
+    }
+
+    /* claim a slot, concurrent writers (tasks, ISRs, other core) each get their own */
+    uint32_t index = __atomic_fetch_add(&ring_head, 1u, __ATOMIC_ACQ_REL);
+    ppm_event_entry_t *entry = &event_ring[index & (CONFIG_PPM_BOOTLOADER_EVENT_TRACE_ENTRIES - 1u)];
+    entry->time = (uint32_t)esp_timer_get_time();
+    entry->event = event;
+    entry->sequence = (uint16_t)index;
+    entry->arg0 = arg0;
+    entry->arg1 = arg1;
+#else
+    (void)event;
+    (void)arg0;
+    (void)arg1;
+#endif
+}
@@ -0,0 +1,935 @@
+/**
+ * @file
+ * @brief PPM prepared image module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM prepared image module.
+ *
+ * Run length encoded pages consist of 16-bit tokens:
+ * - 0x8000 | n, w: word w repeated n times
+ * - n, w_1 .. w_n: n literal words
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "intelhex.h"
+#include "mlx_chip.h"
+#include "mlx_crc.h"
+
+#include "ppm_chip.h"
+#include "ppm_mem.h"
+
+#include "ppm_image.h"
+
+static const char *TAG = "ppm_image";
+
+/** RLE token flag marking a run */
+#define RLE_RUN_FLAG 0x8000u
+
+/** RLE token count mask */
+#define RLE_COUNT_MASK 0x7FFFu
+
+/** Minimum number of equal words to be encoded as a run */
+#define RLE_MIN_RUN 3u
+
+/** FNV-1a offset basis used for page hashing */
+#define PAGE_HASH_BASIS 2166136261u
+
+/** FNV-1a prime used for page hashing */
+#define PAGE_HASH_PRIME 16777619u
+
+/** Marker for an empty page hash table slot */
+#define PAGE_HASH_EMPTY UINT32_MAX
+
+/** Largest number of library images for which a project index is built */
+#define PROJECT_INDEX_MAX_IMAGES 16384u
+
+/** memory layout of an image */
+typedef struct {
+    uint32_t start;                     /**< start address of the memory */
+    size_t length;                      /**< number of bytes to program */
+    size_t page_length;                 /**< page length (in bytes) */
+    size_t page_count;                  /**< number of pages */
+    uint32_t crc;                       /**< memory crc as used by the ppm sessions */
+} ppm_image_layout_t;
+
+/** unique page of a library under construction */
+typedef struct {
+    uint32_t hash;                      /**< hash of the page content */
+    uint16_t entry;                     /**< index of the first library entry holding the page */
+    uint16_t page;                      /**< index of the page within that entry */
+} ppm_unique_page_t;
+
+/** Determine the memory layout and crc of an image
+ *
+ * @param[in]  project_id  project ID of the chip type to prepare the image for.
+ * @param[in]  memory  memory to prepare the image for.
+ * @param[in]  ihex  intel hex container holding the memory content.
+ * @param[out]  layout  memory layout of the image.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t image_getLayout(uint16_t project_id,
+                                 ppm_memory_t memory,
+                                 ihexContainer_t * ihex,
+                                 ppm_image_layout_t * layout);
+
+/** Read the content of an image, padded to full pages with erased flash content
+ *
+ * @param[in]  layout  memory layout of the image.
+ * @param[in]  ihex  intel hex container holding the memory content.
+ * @param[out]  content  buffer receiving the content (page_count * page_length bytes).
+ */
+static void image_readContent(const ppm_image_layout_t * layout, ihexContainer_t * ihex, uint16_t * content);
+
+/** Read the content of a single page of an image
+ *
+ * @param[in]  layout  memory layout of the image.
+ * @param[in]  ihex  intel hex container holding the memory content.
+ * @param[in]  page  index of the page to read.
+ * @param[out]  page_words  buffer receiving the page content (page_length bytes).
+ */
+static void image_readPage(const ppm_image_layout_t * layout, ihexContainer_t * ihex, size_t page, uint16_t * page_words);
+
+/** Store a page in a payload area
+ *
+ * @param[in]  encoding  page payload encoding to use.
+ * @param[in]  page_words  page data words.
+ * @param[in]  page_size  number of page data words.
+ * @param[out]  payload  payload area.
+ * @param[in]  offset  offset of the page payload in the payload area.
+ * @param[out]  entry  page table entry to fill in.
+ *
+ * @return  length of the stored page payload (in bytes).
+ */
+static size_t image_storePage(ppm_image_encoding_t encoding,
+                              const uint16_t * page_words,
+                              size_t page_size,
+                              uint8_t * payload,
+                              size_t offset,
+                              ppm_image_page_t * entry);
+
+/** Get the stored length of a page
+ *
+ * @param[in]  encoding  page payload encoding to use.
+ * @param[in]  page_words  page data words.
+ * @param[in]  page_size  number of page data words.
+ *
+ * @return  length of the stored page payload (in bytes).
+ */
+static size_t image_storedLength(ppm_image_encoding_t encoding, const uint16_t * page_words, size_t page_size);
+
+/** Validate a page table
+ *
+ * @param[in]  pages  page table.
+ * @param[in]  page_count  number of page table entries.
+ * @param[in]  payload_length  length of the payload area (in bytes).
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static ppm_err_t image_checkPages(const ppm_image_page_t * pages, size_t page_count, size_t payload_length);
+
+/** Validate an image header
+ *
+ * @param[in]  header  image header.
+ *
+ * @return  true when the header content is valid.
+ */
+static bool image_checkHeader(const ppm_image_header_t * header);
+
+/** Hash the content of a page
+ *
+ * @param[in]  page_words  page data words.
+ * @param[in]  page_size  number of page data words.
+ *
+ * @return  page hash.
+ */
+static uint32_t page_hash(const uint16_t * page_words, size_t page_size);
+
+/** Get the home slot of a chip type and memory in a project index
+ *
+ * @param[in]  project_id  project ID of the chip type.
+ * @param[in]  memory  memory type.
+ * @param[in]  index_size  number of project index slots (power of 2).
+ *
+ * @return  index of the first slot to probe.
+ */
+static size_t project_slot(uint16_t project_id, uint8_t memory, size_t index_size);
+
+/** Run length encode a page
+ *
+ * @param[in]  words  page data words.
+ * @param[in]  count  number of page data words.
+ * @param[out]  out  buffer receiving the encoded words (NULL to only determine the length).
+ *
+ * @return  number of encoded words.
+ */
+static size_t rle_encode(const uint16_t * words, size_t count, uint16_t * out);
+
+/** Run length decode a page
+ *
+ * @param[in]  in  encoded words.
+ * @param[in]  in_count  number of encoded words.
+ * @param[out]  out  buffer receiving the page data words.
+ * @param[in]  out_count  number of page data words.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t rle_decode(const uint16_t * in, size_t in_count, uint16_t * out, size_t out_count);
+
+/** Get the length of the equal word run starting at a position
+ *
+ * @param[in]  words  data words.
+ * @param[in]  count  number of data words.
+ * @param[in]  start  position to start from.
+ * @param[in]  max  maximum run length to look for.
+ *
+ * @return  run length (at least 1).
+ */
+static size_t rle_runLength(const uint16_t * words, size_t count, size_t start, size_t max);
+
+
+static size_t rle_runLength(const uint16_t * words, size_t count, size_t start, size_t max) {
+    size_t run = 1u;
+    while (((start + run) < count) && (run < max) && (words[start + run] == words[start])) {
+        run++;
+    }
+    return run;
+}
+
+static size_t rle_encode(const uint16_t * words, size_t count, uint16_t * out) {
+    size_t in_idx = 0u;
+    size_t out_idx = 0u;
+
+    while (in_idx < count) {
+        size_t run = rle_runLength(words, count, in_idx, RLE_COUNT_MASK);
+
+        if (run >= RLE_MIN_RUN) {
+            if (out != NULL) {
+                out[out_idx] = (uint16_t)(RLE_RUN_FLAG | run);
+                out[out_idx + 1u] = words[in_idx];
+            }
+            out_idx += 2u;
+            in_idx += run;
+        } else {
+            /* collect literals until the next run starts */
+            size_t start = in_idx;
+            size_t len = 0u;
+            while ((in_idx < count) &&
+                   (len < RLE_COUNT_MASK) &&
+                   (rle_runLength(words, count, in_idx, RLE_MIN_RUN) < RLE_MIN_RUN)) {
+                in_idx++;
+                len++;
+            }
+            if (out != NULL) {
+                out[out_idx] = (uint16_t)len;
+                memcpy(&out[out_idx + 1u], &words[start], len * sizeof(uint16_t));
+            }
+            out_idx += 1u + len;
+        }
+    }
+
+    return out_idx;
+}
+
+static esp_err_t rle_decode(const uint16_t * in, size_t in_count, uint16_t * out, size_t out_count) {
+    size_t in_idx = 0u;
+    size_t out_idx = 0u;
+
+    while (out_idx < out_count) {
+        if (in_idx >= in_count) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        uint16_t token = in[in_idx++];
+        size_t len = token & RLE_COUNT_MASK;
+        if ((len == 0u) || (len > (out_count - out_idx))) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        if ((token & RLE_RUN_FLAG) != 0u) {
+            if (in_idx >= in_count) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            uint16_t value = in[in_idx++];
+            for (size_t i = 0u; i < len; i++) {
+                out[out_idx++] = value;
+            }
+        } else {
+            if (len > (in_count - in_idx)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(&out[out_idx], &in[in_idx], len * sizeof(uint16_t));
+            in_idx += len;
+            out_idx += len;
+        }
+    }
+
+    return ESP_OK;
+}
+
+static uint32_t page_hash(const uint16_t * page_words, size_t page_size) {
+    /* include the page size so equal prefixes of different page sizes do not collide */
+    uint32_t hash = (PAGE_HASH_BASIS ^ (uint32_t)page_size) * PAGE_HASH_PRIME;
+    const uint8_t * bytes = (const uint8_t *)page_words;
+    for (size_t i = 0u; i < (page_size * sizeof(uint16_t)); i++) {
+        hash = (hash ^ bytes[i]) * PAGE_HASH_PRIME;
+    }
+    /* keep the empty slot marker free */
+    return (hash == PAGE_HASH_EMPTY) ? 0u : hash;
+}
+
+static size_t project_slot(uint16_t project_id, uint8_t memory, size_t index_size) {
+    /* multiplicative hashing, project IDs of a product family tend to be consecutive */
+    uint32_t hash = ((uint32_t)project_id | ((uint32_t)memory << 16)) * 2654435761u;
+    hash ^= hash >> 16;
+    return hash & (index_size - 1u);
+}
+
+static ppm_err_t image_getLayout(uint16_t project_id,
+                                 ppm_memory_t memory,
+                                 ihexContainer_t * ihex,
+                                 ppm_image_layout_t * layout) {
+    const mlx_chip_t * chip_info = ppmchip_find(project_id);
+    if ((chip_info == NULL) || (chip_info->bootloaders.ppm_loader == NULL)) {
+        return PPM_FAIL_CHIP_NOT_SUPPORTED;
+    }
+
+    uint32_t memEnd;
+    if (memory == PPM_MEM_FLASH) {
+        layout->start = chip_info->memories.flash->start;
+        memEnd = chip_info->memories.flash->start + chip_info->memories.flash->length - 1;
+        layout->length = chip_info->memories.flash->length;
+        layout->page_length = chip_info->memories.flash->page;
+    } else if (memory == PPM_MEM_FLASH_CS) {
+        layout->start = chip_info->memories.flash_cs->start;
+        memEnd = chip_info->memories.flash_cs->start + chip_info->memories.flash_cs->writeable - 1;
+        layout->page_length = chip_info->memories.flash_cs->page;
+        /* determine length to program */
+        layout->length = intelhex_maxAddress(ihex) - chip_info->memories.flash_cs->start + 1;
+        if (layout->length > chip_info->memories.flash_cs->writeable) {
+            layout->length = chip_info->memories.flash_cs->writeable;
+        }
+    } else {
+        return PPM_FAIL_ACTION_NOT_SUPPORTED;
+    }
+
+    if ((intelhex_minAddress(ihex) > memEnd) || (intelhex_maxAddress(ihex) < layout->start)) {
+        return PPM_FAIL_MISSING_DATA;
+    }
+
+    size_t page_size = layout->page_length / sizeof(uint16_t);
+    if ((page_size == 0u) || (page_size > UINT8_MAX)) {
+        return PPM_FAIL_CHIP_NOT_SUPPORTED;
+    }
+    layout->page_count = (layout->length + layout->page_length - 1u) / layout->page_length;
+    if (layout->page_count > UINT16_MAX) {
+        return PPM_FAIL_CHIP_NOT_SUPPORTED;
+    }
+    if (memory == PPM_MEM_FLASH_CS) {
+        /* make page aligned */
+        layout->length = layout->page_count * layout->page_length;
+    }
+
+    /* the crc is calculated over the padded content */
+    uint16_t * content = (uint16_t *)ppmmem_malloc(layout->page_count * layout->page_length);
+    if (content == NULL) {
+        return PPM_FAIL_INTERNAL;
+    }
+    image_readContent(layout, ihex, content);
+
+    ppm_err_t result = PPM_OK;
+    if (memory == PPM_MEM_FLASH) {
+        flash_crc_func_t crc_func = ppmchip_getFlashCrcFunc(chip_info);
+        if (crc_func == NULL) {
+            result = PPM_FAIL_CHIP_NOT_SUPPORTED;
+        } else {
+            layout->crc = crc_func(content, layout->length / 2, 1u);
+        }
+    } else {
+        layout->crc = crc_calc16bitCrc((const uint8_t *)content, layout->length, 0x1D0Fu);
+    }
+
+    ppmmem_free(content);
+
+    return result;
+}
+
+static void image_readContent(const ppm_image_layout_t * layout, ihexContainer_t * ihex, uint16_t * content) {
+    /* pages are padded to a full page with erased flash content */
+    memset(content, 0xFF, layout->page_count * layout->page_length);
+    (void)intelhex_getFilled(ihex, layout->start, (uint8_t *)content, layout->length);
+}
+
+static void image_readPage(const ppm_image_layout_t * layout, ihexContainer_t * ihex, size_t page, uint16_t * page_words) {
+    size_t offset = page * layout->page_length;
+    size_t length = layout->page_length;
+    if (length > (layout->length - offset)) {
+        length = layout->length - offset;
+    }
+
+    memset(page_words, 0xFF, layout->page_length);
+    (void)intelhex_getFilled(ihex, layout->start + offset, (uint8_t *)page_words, length);
+}
+
+static size_t image_storedLength(ppm_image_encoding_t encoding, const uint16_t * page_words, size_t page_size) {
+    if (encoding == PPM_IMG_ENC_RLE) {
+        return rle_encode(page_words, page_size, NULL) * sizeof(uint16_t);
+    }
+    return page_size * sizeof(uint16_t);
+}
+
+static size_t image_storePage(ppm_image_encoding_t encoding,
+                              const uint16_t * page_words,
+                              size_t page_size,
+                              uint8_t * payload,
+                              size_t offset,
+                              ppm_image_page_t * entry) {
+    size_t length;
+    if (encoding == PPM_IMG_ENC_RLE) {
+        length = rle_encode(page_words, page_size, (uint16_t *)&payload[offset]) * sizeof(uint16_t);
+    } else {
+        length = page_size * sizeof(uint16_t);
+        memcpy(&payload[offset], page_words, length);
+    }
+    entry->offset = offset;
+    entry->length = (uint16_t)length;
+    entry->checksum = (uint8_t)crc_calcPageChecksum(page_words, page_size);
+    entry->reserved = 0u;
+    return length;
+}
+
+static bool image_checkHeader(const ppm_image_header_t * header) {
+    return (header->magic == PPM_IMAGE_MAGIC) &&
+           (header->version == PPM_IMAGE_VERSION) &&
+           (header->encoding <= PPM_IMG_ENC_RLE) &&
+           ((header->memory == PPM_MEM_FLASH) || (header->memory == PPM_MEM_FLASH_CS)) &&
+           (header->page_size != 0u) &&
+           (header->page_count != 0u);
+}
+
+static ppm_err_t image_checkPages(const ppm_image_page_t * pages, size_t page_count, size_t payload_length) {
+    for (size_t page = 0u; page < page_count; page++) {
+        if (((pages[page].offset % sizeof(uint16_t)) != 0u) ||
+            ((pages[page].length % sizeof(uint16_t)) != 0u) ||
+            (pages[page].offset > payload_length) ||
+            (pages[page].length > (payload_length - pages[page].offset))) {
+            ESP_LOGE(TAG, "invalid page table entry %u", (unsigned)page);
+            return PPM_FAIL_INV_IMAGE;
+        }
+    }
+    return PPM_OK;
+}
+
+ppm_err_t ppmimage_prepare(uint16_t project_id,
+                           ppm_memory_t memory,
+                           ppm_image_encoding_t encoding,
+                           ihexContainer_t * ihex,
+                           uint8_t * blob,
+                           size_t blob_size,
+                           size_t * blob_length) {
+    if ((ihex == NULL) || (blob_length == NULL) ||
+        ((encoding != PPM_IMG_ENC_RAW) && (encoding != PPM_IMG_ENC_RLE)) ||
+        (((uintptr_t)blob % sizeof(uint32_t)) != 0u)) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    ppm_image_layout_t layout;
+    ppm_err_t result = image_getLayout(project_id, memory, ihex, &layout);
+    if (result != PPM_OK) {
+        return result;
+    }
+    size_t page_size = layout.page_length / sizeof(uint16_t);
+
+    uint16_t * content = (uint16_t *)ppmmem_malloc(layout.page_count * layout.page_length);
+    if (content == NULL) {
+        return PPM_FAIL_INTERNAL;
+    }
+    image_readContent(&layout, ihex, content);
+
+    /* determine the blob layout */
+    size_t payload_offset = sizeof(ppm_image_header_t) + (layout.page_count * sizeof(ppm_image_page_t));
+    size_t payload_length = 0u;
+    for (size_t page = 0u; page < layout.page_count; page++) {
+        payload_length += image_storedLength(encoding, &content[page * page_size], page_size);
+    }
+    *blob_length = payload_offset + payload_length;
+
+    if (blob != NULL) {
+        if (blob_size < *blob_length) {
+            result = PPM_FAIL_INTERNAL;
+        } else {
+            ppm_image_header_t * header = (ppm_image_header_t *)blob;
+            ppm_image_page_t * pages = (ppm_image_page_t *)&blob[sizeof(ppm_image_header_t)];
+            uint8_t * payload = &blob[payload_offset];
+
+            memset(header, 0, sizeof(*header));
+            header->magic = PPM_IMAGE_MAGIC;
+            header->version = PPM_IMAGE_VERSION;
+            header->project_id = project_id;
+            header->memory = (uint8_t)memory;
+            header->encoding = (uint8_t)encoding;
+            header->page_size = (uint8_t)page_size;
+            header->page_count = (uint16_t)layout.page_count;
+            header->crc = layout.crc;
+            header->data_length = layout.length;
+            header->payload_length = payload_length;
+
+            size_t offset = 0u;
+            for (size_t page = 0u; page < layout.page_count; page++) {
+                offset += image_storePage(encoding, &content[page * page_size], page_size, payload, offset, &pages[page]);
+            }
+        }
+    }
+
+    ppmmem_free(content);
+
+    ESP_LOGD(TAG, "prepared image for %04x: %u pages, %u bytes",
+             project_id, (unsigned)layout.page_count, (unsigned)*blob_length);
+
+    return result;
+}
+
+size_t ppmimage_getArenaSize(size_t max_memory_length) {
+    /* the content is padded to whole pages, which are at most UINT8_MAX words */
+    return ppmmem_blockSize(max_memory_length + (UINT8_MAX * sizeof(uint16_t)));
+}
+
+size_t ppmimage_getLibraryArenaSize(size_t entry_count, size_t max_memory_length, size_t min_page_length) {
+    if ((entry_count == 0u) || (min_page_length == 0u)) {
+        return 0u;
+    }
+
+    size_t max_page_length = UINT8_MAX * sizeof(uint16_t);
+    size_t ref_count = entry_count * ((max_memory_length + min_page_length - 1u) / min_page_length);
+    size_t table_size = 1u;
+    while (table_size < (ref_count * 2u)) {
+        table_size <<= 1u;
+    }
+
+    /* the layouts stay allocated while the content of each entry is read for its crc, and while
+     * the pages are deduplicated */
+    size_t layouts = ppmmem_blockSize(entry_count * sizeof(ppm_image_layout_t));
+    size_t content = ppmimage_getArenaSize(max_memory_length);
+    size_t dedup = ppmmem_blockSize(ref_count * sizeof(uint16_t)) +
+                   ppmmem_blockSize(ref_count * sizeof(ppm_unique_page_t)) +
+                   ppmmem_blockSize(table_size * sizeof(uint32_t)) +
+                   (2u * ppmmem_blockSize(max_page_length));
+
+    return layouts + ((content > dedup) ? content : dedup);
+}
+
+ppm_err_t ppmimage_buildLibrary(const ppm_library_entry_t * entries,
+                                size_t entry_count,
+                                ppm_image_encoding_t encoding,
+                                uint8_t * blob,
+                                size_t blob_size,
+                                size_t * blob_length) {
+    if ((entries == NULL) || (entry_count == 0u) || (entry_count > UINT16_MAX) || (blob_length == NULL) ||
+        ((encoding != PPM_IMG_ENC_RAW) && (encoding != PPM_IMG_ENC_RLE)) ||
+        (((uintptr_t)blob % sizeof(uint32_t)) != 0u)) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    ppm_err_t result = PPM_OK;
+    size_t ref_count = 0u;
+    size_t max_page_length = 0u;
+    ppm_image_layout_t * layouts = (ppm_image_layout_t *)ppmmem_calloc(entry_count, sizeof(ppm_image_layout_t));
+    if (layouts == NULL) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    for (size_t entry = 0u; (entry < entry_count) && (result == PPM_OK); entry++) {
+        if (entries[entry].ihex == NULL) {
+            result = PPM_FAIL_INV_HEX_FILE;
+        } else {
+            result = image_getLayout(entries[entry].project_id, entries[entry].memory, entries[entry].ihex, &layouts[entry]);
+        }
+        if (result == PPM_OK) {
+            ref_count += layouts[entry].page_count;
+            if (layouts[entry].page_length > max_page_length) {
+                max_page_length = layouts[entry].page_length;
+            }
+        }
+    }
+
+    /* open addressing hash table of unique page indexes, at most half full */
+    size_t table_size = 1u;
+    while (table_size < (ref_count * 2u)) {
+        table_size <<= 1u;
+    }
+
+    uint16_t * refs = NULL;
+    ppm_unique_page_t * unique = NULL;
+    uint32_t * table = NULL;
+    uint16_t * page_words = NULL;
+    uint16_t * candidate = NULL;
+    if (result == PPM_OK) {
+        refs = (uint16_t *)ppmmem_malloc(ref_count * sizeof(uint16_t));
+        unique = (ppm_unique_page_t *)ppmmem_malloc(ref_count * sizeof(ppm_unique_page_t));
+        table = (uint32_t *)ppmmem_malloc(table_size * sizeof(uint32_t));
+        page_words = (uint16_t *)ppmmem_malloc(max_page_length);
+        candidate = (uint16_t *)ppmmem_malloc(max_page_length);
+        if ((refs == NULL) || (unique == NULL) || (table == NULL) || (page_words == NULL) || (candidate == NULL)) {
+            result = PPM_FAIL_INTERNAL;
+        } else {
+            memset(table, 0xFF, table_size * sizeof(uint32_t));
+        }
+    }
+
+    /* deduplicate the pages of all entries */
+    size_t unique_count = 0u;
+    size_t payload_length = 0u;
+    size_t ref = 0u;
+    for (size_t entry = 0u; (entry < entry_count) && (result == PPM_OK); entry++) {
+        const ppm_image_layout_t * layout = &layouts[entry];
+        size_t page_size = layout->page_length / sizeof(uint16_t);
+
+        for (size_t page = 0u; (page < layout->page_count) && (result == PPM_OK); page++) {
+            image_readPage(layout, entries[entry].ihex, page, page_words);
+            uint32_t hash = page_hash(page_words, page_size);
+            size_t slot = hash & (table_size - 1u);
+
+            while (table[slot] != PAGE_HASH_EMPTY) {
+                const ppm_unique_page_t * other = &unique[table[slot]];
+                const ppm_image_layout_t * other_layout = &layouts[other->entry];
+                if ((other->hash == hash) && (other_layout->page_length == layout->page_length)) {
+                    /* hashes match, compare the actual content */
+                    image_readPage(other_layout, entries[other->entry].ihex, other->page, candidate);
+                    if (memcmp(candidate, page_words, layout->page_length) == 0) {
+                        break;
+                    }
+                }
+                slot = (slot + 1u) & (table_size - 1u);
+            }
+
+            if (table[slot] == PAGE_HASH_EMPTY) {
+                if (unique_count >= UINT16_MAX) {
+                    result = PPM_FAIL_INTERNAL;
+                    break;
+                }
+                unique[unique_count].hash = hash;
+                unique[unique_count].entry = (uint16_t)entry;
+                unique[unique_count].page = (uint16_t)page;
+                table[slot] = unique_count;
+                unique_count++;
+                payload_length += image_storedLength(encoding, page_words, page_size);
+            }
+            refs[ref++] = (uint16_t)table[slot];
+        }
+    }
+
+    /* project index, at most half full */
+    size_t index_size = 0u;
+    if (entry_count <= PROJECT_INDEX_MAX_IMAGES) {
+        index_size = 1u;
+        while (index_size < (entry_count * 2u)) {
+            index_size <<= 1u;
+        }
+    }
+
+    /* determine the blob layout */
+    size_t images_offset = sizeof(ppm_library_header_t);
+    size_t index_offset = images_offset + (entry_count * sizeof(ppm_library_image_t));
+    size_t refs_offset = index_offset + (index_size * sizeof(uint16_t));
+    size_t pages_offset = (refs_offset + (ref_count * sizeof(uint16_t)) + 3u) & ~(size_t)3u;
+    size_t payload_offset = pages_offset + (unique_count * sizeof(ppm_image_page_t));
+    if (result == PPM_OK) {
+        *blob_length = payload_offset + payload_length;
+    }
+
+    if ((result == PPM_OK) && (blob != NULL)) {
+        if (blob_size < *blob_length) {
+            result = PPM_FAIL_INTERNAL;
+        } else {
+            ppm_library_header_t * header = (ppm_library_header_t *)blob;
+            ppm_library_image_t * images = (ppm_library_image_t *)&blob[images_offset];
+            ppm_image_page_t * pages = (ppm_image_page_t *)&blob[pages_offset];
+            uint8_t * payload = &blob[payload_offset];
+
+            memset(blob, 0, payload_offset);
+            header->magic = PPM_LIBRARY_MAGIC;
+            header->version = PPM_LIBRARY_VERSION;
+            header->encoding = (uint8_t)encoding;
+            header->image_count = (uint16_t)entry_count;
+            header->index_size = (uint16_t)index_size;
+            header->page_count = unique_count;
+            header->ref_count = ref_count;
+            header->payload_length = payload_length;
+
+            size_t first_ref = 0u;
+            for (size_t entry = 0u; entry < entry_count; entry++) {
+                ppm_image_header_t * image = &images[entry].header;
+                image->magic = PPM_IMAGE_MAGIC;
+                image->version = PPM_IMAGE_VERSION;
+                image->project_id = entries[entry].project_id;
+                image->memory = (uint8_t)entries[entry].memory;
+                image->encoding = (uint8_t)encoding;
+                image->page_size = (uint8_t)(layouts[entry].page_length / sizeof(uint16_t));
+                image->page_count = (uint16_t)layouts[entry].page_count;
+                image->crc = layouts[entry].crc;
+                image->data_length = layouts[entry].length;
+                image->payload_length = payload_length;
+                images[entry].first_ref = first_ref;
+                first_ref += layouts[entry].page_count;
+            }
+
+            uint16_t * index = (uint16_t *)&blob[index_offset];
+            for (size_t entry = 0u; (index_size != 0u) && (entry < entry_count); entry++) {
+                size_t slot = project_slot(entries[entry].project_id, (uint8_t)entries[entry].memory, index_size);
+                while (index[slot] != 0u) {
+                    const ppm_image_header_t * other = &images[index[slot] - 1u].header;
+                    if ((other->project_id == entries[entry].project_id) &&
+                        (other->memory == (uint8_t)entries[entry].memory)) {
+                        break;
+                    }
+                    slot = (slot + 1u) & (index_size - 1u);
+                }
+                if (index[slot] == 0u) {
+                    index[slot] = (uint16_t)(entry + 1u);
+                }
+            }
+
+            memcpy(&blob[refs_offset], refs, ref_count * sizeof(uint16_t));
+
+            size_t offset = 0u;
+            for (size_t page = 0u; page < unique_count; page++) {
+                const ppm_image_layout_t * layout = &layouts[unique[page].entry];
+                image_readPage(layout, entries[unique[page].entry].ihex, unique[page].page, page_words);
+                offset += image_storePage(encoding,
+                                          page_words,
+                                          layout->page_length / sizeof(uint16_t),
+                                          payload,
+                                          offset,
+                                          &pages[page]);
+            }
+        }
+    }
+
+    ppmmem_free(candidate);
+    ppmmem_free(page_words);
+    ppmmem_free(table);
+    ppmmem_free(unique);
+    ppmmem_free(refs);
+    ppmmem_free(layouts);
+
+    if (result == PPM_OK) {
+        ESP_LOGD(TAG, "library of %u images: %u of %u pages unique, %u bytes",
+                 (unsigned)entry_count, (unsigned)unique_count, (unsigned)ref_count, (unsigned)*blob_length);
+    }
+
+    return result;
+}
+
+ppm_err_t ppmimage_load(const uint8_t * blob, size_t blob_length, ppm_image_t * image) {
+    if ((blob == NULL) || (image == NULL) || (((uintptr_t)blob % sizeof(uint32_t)) != 0u) ||
+        (blob_length < sizeof(ppm_image_header_t))) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    const ppm_image_header_t * header = (const ppm_image_header_t *)blob;
+    if (!image_checkHeader(header)) {
+        ESP_LOGE(TAG, "invalid image header");
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    size_t payload_offset = sizeof(ppm_image_header_t) + (header->page_count * sizeof(ppm_image_page_t));
+    if ((payload_offset > blob_length) || (header->payload_length > (blob_length - payload_offset))) {
+        ESP_LOGE(TAG, "truncated image");
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    const ppm_image_page_t * pages = (const ppm_image_page_t *)&blob[sizeof(ppm_image_header_t)];
+    if (image_checkPages(pages, header->page_count, header->payload_length) != PPM_OK) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    image->header = header;
+    image->pages = pages;
+    image->refs = NULL;
+    image->payload = &blob[payload_offset];
+
+    return PPM_OK;
+}
+
+ppm_err_t ppmimage_loadLibrary(const uint8_t * blob, size_t blob_length, ppm_library_t * library) {
+    if ((blob == NULL) || (library == NULL) || (((uintptr_t)blob % sizeof(uint32_t)) != 0u) ||
+        (blob_length < sizeof(ppm_library_header_t))) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    const ppm_library_header_t * header = (const ppm_library_header_t *)blob;
+    if ((header->magic != PPM_LIBRARY_MAGIC) ||
+        (header->version != PPM_LIBRARY_VERSION) ||
+        (header->encoding > PPM_IMG_ENC_RLE) ||
+        (header->image_count == 0u) ||
+        (header->page_count > UINT16_MAX) ||
+        ((header->index_size & (header->index_size - 1u)) != 0u) ||
+        ((header->index_size != 0u) && (header->index_size <= header->image_count)) ||
+        (header->ref_count > (UINT16_MAX * (size_t)header->image_count))) {
+        ESP_LOGE(TAG, "invalid library header");
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    size_t images_offset = sizeof(ppm_library_header_t);
+    size_t index_offset = images_offset + (header->image_count * sizeof(ppm_library_image_t));
+    size_t refs_offset = index_offset + (header->index_size * sizeof(uint16_t));
+    size_t pages_offset = (refs_offset + (header->ref_count * sizeof(uint16_t)) + 3u) & ~(size_t)3u;
+    size_t payload_offset = pages_offset + (header->page_count * sizeof(ppm_image_page_t));
+    if ((payload_offset > blob_length) || (header->payload_length > (blob_length - payload_offset))) {
+        ESP_LOGE(TAG, "truncated library");
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    const ppm_library_image_t * images = (const ppm_library_image_t *)&blob[images_offset];
+    const uint16_t * index = (const uint16_t *)&blob[index_offset];
+    const uint16_t * refs = (const uint16_t *)&blob[refs_offset];
+    const ppm_image_page_t * pages = (const ppm_image_page_t *)&blob[pages_offset];
+
+    for (size_t index = 0u; index < header->image_count; index++) {
+        if ((!image_checkHeader(&images[index].header)) ||
+            (images[index].header.encoding != header->encoding) ||
+            (images[index].first_ref > header->ref_count) ||
+            (images[index].header.page_count > (header->ref_count - images[index].first_ref))) {
+            ESP_LOGE(TAG, "invalid library image %u", (unsigned)index);
+            return PPM_FAIL_INV_IMAGE;
+        }
+    }
+
+    size_t used_slots = 0u;
+    for (size_t slot = 0u; slot < header->index_size; slot++) {
+        if (index[slot] > header->image_count) {
+            ESP_LOGE(TAG, "invalid project index slot %u", (unsigned)slot);
+            return PPM_FAIL_INV_IMAGE;
+        }
+        if (index[slot] != 0u) {
+            used_slots++;
+        }
+    }
+    if (used_slots > header->image_count) {
+        /* lookups rely on at least one empty slot */
+        ESP_LOGE(TAG, "invalid project index");
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    for (size_t ref = 0u; ref < header->ref_count; ref++) {
+        if (refs[ref] >= header->page_count) {
+            ESP_LOGE(TAG, "invalid page reference %u", (unsigned)ref);
+            return PPM_FAIL_INV_IMAGE;
+        }
+    }
+
+    if (image_checkPages(pages, header->page_count, header->payload_length) != PPM_OK) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    library->header = header;
+    library->images = images;
+    library->index = (header->index_size != 0u) ? index : NULL;
+    library->refs = refs;
+    library->pages = pages;
+    library->payload = &blob[payload_offset];
+
+    return PPM_OK;
+}
+
+ppm_err_t ppmimage_getLibraryImage(const ppm_library_t * library, uint16_t index, ppm_image_t * image) {
+    if ((library == NULL) || (library->header == NULL) || (image == NULL) ||
+        (index >= library->header->image_count)) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    image->header = &library->images[index].header;
+    image->pages = library->pages;
+    image->refs = &library->refs[library->images[index].first_ref];
+    image->payload = library->payload;
+
+    return PPM_OK;
+}
+
+ppm_err_t ppmimage_findLibraryImage(const ppm_library_t * library,
+                                    uint16_t project_id,
+                                    ppm_memory_t memory,
+                                    ppm_image_t * image) {
+    if ((library == NULL) || (library->header == NULL) || (image == NULL)) {
+        return PPM_FAIL_INV_IMAGE;
+    }
+
+    const ppm_library_header_t * header = library->header;
+    if (library->index != NULL) {
+        /* the index is at most half full, probing always ends on an empty slot */
+        size_t slot = project_slot(project_id, (uint8_t)memory, header->index_size);
+        while (library->index[slot] != 0u) {
+            uint16_t index = library->index[slot] - 1u;
+            const ppm_image_header_t * candidate = &library->images[index].header;
+            if ((candidate->project_id == project_id) && (candidate->memory == (uint8_t)memory)) {
+                return ppmimage_getLibraryImage(library, index, image);
+            }
+            slot = (slot + 1u) & (header->index_size - 1u);
+        }
+    } else {
+        for (uint16_t index = 0u; index < header->image_count; index++) {
+            const ppm_image_header_t * candidate = &library->images[index].header;
+            if ((candidate->project_id == project_id) && (candidate->memory == (uint8_t)memory)) {
+                return ppmimage_getLibraryImage(library, index, image);
+            }
+        }
+    }
+
+    return PPM_FAIL_NO_IMAGE;
+}
+
+esp_err_t ppmimage_getPage(const ppm_image_t * image,
+                           uint16_t page_index,
+                           uint16_t * page_words,
+                           uint8_t * page_checksum) {
+    if ((image == NULL) || (image->header == NULL) || (page_words == NULL) ||
+        (page_index >= image->header->page_count)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (image->refs != NULL) {
+        page_index = image->refs[page_index];
+    }
+
+    const ppm_image_page_t * page = &image->pages[page_index];
+    const uint16_t * stored = (const uint16_t *)&image->payload[page->offset];
+    esp_err_t result = ESP_OK;
+
+    if (image->header->encoding == PPM_IMG_ENC_RLE) {
+        result = rle_decode(stored, page->length / sizeof(uint16_t), page_words, image->header->page_size);
+    } else if (page->length != (image->header->page_size * sizeof(uint16_t))) {
+        result = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(page_words, stored, page->length);
+    }
+
+    if (page_checksum != NULL) {
+        *page_checksum = page->checksum;
+    }
+
+    return result;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file
+ * @brief PPM link quality monitor module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM link quality monitor module.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ppm_session.h"
+#include "rmt_ppm.h"
+
+#include "ppm_link.h"
+
+static const char *TAG = "ppm_link";
+
+/** bitrate policy (only applied when policy_set) */
+static ppm_link_policy_t link_policy;
+static bool policy_set = false;
+
+/** bitrate ceiling of the policy for the current requests [bps] */
+static uint32_t bitrate_ceiling = 0u;
+/** number of consecutive pages transmitted without link errors */
+static uint32_t clean_run = 0u;
+
+/** accumulated link statistics, also holding the selected bitrate */
+static ppm_link_stats_t link_stats;
+
+/** counters at the start of the current action */
+static bool action_active = false;
+static rmt_ppm_link_stats_t rx_start;
+static ppm_session_stats_t session_start;
+static int64_t action_start;
+
+/** wire efficiency report of the last completed action */
+static ppm_link_report_t action_report;
+
+/** Lower the selected bitrate after an error burst */
+static void ppmlink_downshift(void);
+
+/** Raise the selected bitrate after a run of clean pages */
+static void ppmlink_upshift(void);
+
+/** Build the wire efficiency report of the action
+ *
+ * @param[in]  session  session statistics at the end of the action.
+ */
+static void ppmlink_buildReport(const ppm_session_stats_t *session);
+
+
+static void ppmlink_downshift(void) {
+    uint32_t bitrate = (uint32_t)(((uint64_t)link_stats.bitrate * (100u - link_policy.downshift_percent)) / 100u);
+    if (bitrate < link_policy.min_bitrate) {
+        bitrate = link_policy.min_bitrate;
+    }
+
+    if (bitrate != link_stats.bitrate) {
+        ESP_LOGW(TAG, "link errors, bitrate %u -> %u bps", (unsigned)link_stats.bitrate, (unsigned)bitrate);
+        link_stats.bitrate = bitrate;
+        link_stats.downshifts++;
+    }
+}
+
+static void ppmlink_upshift(void) {
+    uint32_t bitrate = (uint32_t)(((uint64_t)link_stats.bitrate * (100u + link_policy.upshift_percent)) / 100u);
+    if (bitrate > bitrate_ceiling) {
+        bitrate = bitrate_ceiling;
+    }
+
+    if (bitrate != link_stats.bitrate) {
+        ESP_LOGI(TAG, "clean link, probing bitrate %u -> %u bps", (unsigned)link_stats.bitrate, (unsigned)bitrate);
+        link_stats.bitrate = bitrate;
+        link_stats.upshifts++;
+    }
+}
+
+static void ppmlink_buildReport(const ppm_session_stats_t *session) {
+    memset(&action_report, 0, sizeof(action_report));
+    action_report.action_time = (uint32_t)(esp_timer_get_time() - action_start);
+
+    for (size_t i = 0u; (i < PPM_SESSION_WIRE_TYPES) && (session->wire[i].session_id != 0u); i++) {
+        ppm_session_wire_t wire = session->wire[i];
+        const ppm_session_wire_t *start = &session_start.wire[i];
+
+        /* entries keep their session type until a reset of the session statistics */
+        if (start->session_id == wire.session_id) {
+            wire.sessions -= start->sessions;
+            wire.frames -= start->frames;
+            wire.acks -= start->acks;
+            wire.payload_bits -= start->payload_bits;
+            wire.session_bits -= start->session_bits;
+            wire.page_header_bits -= start->page_header_bits;
+            wire.page_checksum_bits -= start->page_checksum_bits;
+            wire.ack_bits -= start->ack_bits;
+            wire.pulse_time -= start->pulse_time;
+            wire.symbol_time -= start->symbol_time;
+            wire.time_tx -= start->time_tx;
+            wire.time_wait -= start->time_wait;
+            wire.time_total -= start->time_total;
+        }
+        if (wire.sessions == 0u) {
+            continue;
+        }
+
+        action_report.sessions[action_report.count++] = wire;
+        action_report.payload_bits += wire.payload_bits;
+
+        ESP_LOGD(TAG, "session 0x%02X: %u sessions, %u frames, %u acks, payload %u bits, overhead %u bits "
+                 "(session %u, page header %u, checksum %u, ack %u), nominal pulses %u us, tx %u us, wait %u us, idle %u us, %u bps",
+                 wire.session_id,
+                 (unsigned)wire.sessions,
+                 (unsigned)wire.frames,
+                 (unsigned)wire.acks,
+                 (unsigned)wire.payload_bits,
+                 (unsigned)(wire.session_bits + wire.page_header_bits + wire.page_checksum_bits + wire.ack_bits),
+                 (unsigned)wire.session_bits,
+                 (unsigned)wire.page_header_bits,
+                 (unsigned)wire.page_checksum_bits,
+                 (unsigned)wire.ack_bits,
+                 (unsigned)(wire.pulse_time / 4u),
+                 (unsigned)wire.time_tx,
+                 (unsigned)wire.time_wait,
+                 (unsigned)(wire.time_total - wire.time_tx - wire.time_wait),
+                 (unsigned)((wire.time_total != 0u) ? ((wire.payload_bits * 1000000u) / wire.time_total) : 0u));
+    }
+
+    if (action_report.action_time != 0u) {
+        action_report.payload_bitrate = (uint32_t)((action_report.payload_bits * 1000000u) / action_report.action_time);
+    }
+    ESP_LOGD(TAG, "action: %u us, payload %u bits, %u bps",
+             (unsigned)action_report.action_time,
+             (unsigned)action_report.payload_bits,
+             (unsigned)action_report.payload_bitrate);
+}
+
+void ppmlink_setPolicy(const ppm_link_policy_t * policy) {
+    if ((policy != NULL) && (policy->downshift_percent < 100u)) {
+        link_policy = *policy;
+        policy_set = true;
+    } else {
+        policy_set = false;
+    }
+    link_stats.bitrate = 0u;
+    clean_run = 0u;
+}
+
+uint32_t ppmlink_selectBitrate(uint32_t requested) {
+    if (!policy_set) {
+        return requested;
+    }
+
+    bitrate_ceiling = (link_policy.max_bitrate != 0u) ? link_policy.max_bitrate : requested;
+    if (bitrate_ceiling < link_policy.min_bitrate) {
+        bitrate_ceiling = link_policy.min_bitrate;
+    }
+    if (bitrate_ceiling > RMT_PPM_MAX_BITRATE) {
+        /* probing up never goes beyond what the transport can time */
+        bitrate_ceiling = RMT_PPM_MAX_BITRATE;
+    }
+
+    if ((link_stats.bitrate == 0u) || (link_stats.bitrate > bitrate_ceiling)) {
+        link_stats.bitrate = bitrate_ceiling;
+    }
+
+    return link_stats.bitrate;
+}
+
+void ppmlink_beginAction(void) {
+    rmt_ppm_get_link_stats(&rx_start);
+    ppmsession_getStats(&session_start);
+    action_start = esp_timer_get_time();
+    action_active = true;
+}
+
+void ppmlink_endAction(void) {
+    if (!action_active) {
+        return;
+    }
+    action_active = false;
+
+    rmt_ppm_link_stats_t rx;
+    ppm_session_stats_t session;
+    rmt_ppm_get_link_stats(&rx);
+    ppmsession_getStats(&session);
+
+    uint32_t decode_errors = rx.decode_errors - rx_start.decode_errors;
+    uint32_t timing_errors = rx.timing_errors - rx_start.timing_errors;
+    uint32_t rx_overflows = rx.rx_overflows - rx_start.rx_overflows;
+    uint32_t ack_missing = (session.page_ack_missing - session_start.page_ack_missing) +
+                           (session.session_ack_missing - session_start.session_ack_missing);
+    uint32_t checksum_mismatches = (session.page_ack_invalid - session_start.page_ack_invalid) +
+                                   (session.session_ack_invalid - session_start.session_ack_invalid);
+    uint32_t pages = session.pages - session_start.pages;
+
+    link_stats.frames_received += rx.frames_received - rx_start.frames_received;
+    link_stats.decode_errors += decode_errors;
+    link_stats.timing_errors += timing_errors;
+    link_stats.rx_overflows += rx_overflows;
+    link_stats.ack_missing += ack_missing;
+    link_stats.checksum_mismatches += checksum_mismatches;
+    link_stats.pages += pages;
+
+    ppmlink_buildReport(&session);
+
+    if (!policy_set || (link_stats.bitrate == 0u)) {
+        return;
+    }
+
+    uint32_t errors = decode_errors + timing_errors + rx_overflows + ack_missing + checksum_mismatches;
+    if (errors == 0u) {
+        clean_run += pages;
+        if ((clean_run >= link_policy.clean_pages) && (link_stats.bitrate < bitrate_ceiling)) {
+            ppmlink_upshift();
+            clean_run = 0u;
+        }
+    } else {
+        if (errors >= link_policy.error_burst) {
+            ppmlink_downshift();
+        }
+        clean_run = 0u;
+    }
+}
+
+void ppmlink_getStats(ppm_link_stats_t * stats) {
+    if (stats != NULL) {
+        *stats = link_stats;
+    }
+}
+
+void ppmlink_getActionReport(ppm_link_report_t * report) {
+    if (report != NULL) {
+        *report = action_report;
+    }
+}
+
+void ppmlink_resetStats(void) {
+    uint32_t bitrate = link_stats.bitrate;
+    memset(&link_stats, 0, sizeof(link_stats));
+    link_stats.bitrate = bitrate;
+}
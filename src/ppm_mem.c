@@ -0,0 +1,175 @@
+/**
+ * @file
+ * @brief PPM memory allocation module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM memory allocation module.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+#include "ppm_mem.h"
+
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+
+static const char *TAG = "ppm_mem";
+
+/** Alignment of all arena blocks [bytes] */
+#define PPM_MEM_ALIGN 8u
+
+/** Round a size up to the arena alignment */
+#define PPM_MEM_ALIGN_UP(x) (((x) + (PPM_MEM_ALIGN - 1u)) & ~(PPM_MEM_ALIGN - 1u))
+
+/** Marker for the absence of a previous block */
+#define PPM_MEM_NO_BLOCK SIZE_MAX
+
+/** arena block header */
+typedef struct {
+    size_t prev_block;                  /**< offset of the previous block header */
+    size_t freed;                       /**< block has been released but is not on top of the arena */
+} ppm_mem_hdr_t;
+
+/** Arena block header size [bytes] */
+#define PPM_MEM_HDR_SIZE PPM_MEM_ALIGN_UP(sizeof(ppm_mem_hdr_t))
+
+static uint8_t * arena_base = NULL;
+static size_t arena_size = 0u;
+static size_t arena_top = 0u;
+static size_t arena_top_block = PPM_MEM_NO_BLOCK;
+/** protects the arena, the worker and the application tasks allocate concurrently */
+static portMUX_TYPE arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t ppmmem_setArena(void * arena, size_t size) {
+    if ((arena == NULL) || (((uintptr_t)arena % PPM_MEM_ALIGN) != 0u)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&arena_lock);
+    if (arena_top != 0u) {
+        /* buffers are still allocated from the current arena */
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        arena_base = (uint8_t *)arena;
+        arena_size = size;
+        arena_top = 0u;
+        arena_top_block = PPM_MEM_NO_BLOCK;
+    }
+    portEXIT_CRITICAL(&arena_lock);
+
+    return err;
+}
+
+size_t ppmmem_blockSize(size_t size) {
+    return PPM_MEM_HDR_SIZE + PPM_MEM_ALIGN_UP(size);
+}
+
+void * ppmmem_malloc(size_t size) {
+    size_t needed = ppmmem_blockSize(size);
+    ppm_mem_hdr_t * hdr = NULL;
+
+    portENTER_CRITICAL(&arena_lock);
+    if ((arena_base != NULL) && (needed <= (arena_size - arena_top))) {
+        hdr = (ppm_mem_hdr_t *)&arena_base[arena_top];
+        hdr->prev_block = arena_top_block;
+        hdr->freed = false;
+        arena_top_block = arena_top;
+        arena_top += needed;
+    }
+    portEXIT_CRITICAL(&arena_lock);
+
+    if (hdr == NULL) {
+        ESP_LOGE(TAG, "arena exhausted (%u bytes requested)", (unsigned)size);
+        return NULL;
+    }
+
+    return (uint8_t *)hdr + PPM_MEM_HDR_SIZE;
+}
+
+void * ppmmem_calloc(size_t count, size_t size) {
+    if ((size != 0u) && (count > (SIZE_MAX / size))) {
+        return NULL;
+    }
+
+    void * ptr = ppmmem_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void ppmmem_free(void * ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    ppm_mem_hdr_t * hdr = (ppm_mem_hdr_t *)((uint8_t *)ptr - PPM_MEM_HDR_SIZE);
+
+    portENTER_CRITICAL(&arena_lock);
+    hdr->freed = true;
+
+    /* release all freed blocks from the top of the arena */
+    while (arena_top_block != PPM_MEM_NO_BLOCK) {
+        ppm_mem_hdr_t * top = (ppm_mem_hdr_t *)&arena_base[arena_top_block];
+        if (!top->freed) {
+            break;
+        }
+        arena_top = arena_top_block;
+        arena_top_block = top->prev_block;
+    }
+    portEXIT_CRITICAL(&arena_lock);
+}
+
+#else
+
+esp_err_t ppmmem_setArena(void * arena, size_t size) {
+    (void)arena;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t ppmmem_blockSize(size_t size) {
+    (void)size;
+    return 0u;
+}
+
+void * ppmmem_malloc(size_t size) {
+    return malloc(size);
+}
+
+void * ppmmem_calloc(size_t count, size_t size) {
+    return calloc(count, size);
+}
+
+void ppmmem_free(void * ptr) {
+    free(ptr);
+}
+
+#endif /* CONFIG_PPM_BOOTLOADER_STATIC_ALLOC */
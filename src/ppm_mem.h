@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief PPM memory allocation definitions.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Definitions of the PPM memory allocation module.
+ *
+ * All buffers of the library are allocated through this module. By default it forwards to the heap.
+ * With CONFIG_PPM_BOOTLOADER_STATIC_ALLOC enabled, buffers are taken from a caller provided arena
+ * instead. The arena is used as a stack: buffers allocated during init stay at the bottom, buffers
+ * used during an action are released in reverse order of allocation, which matches how the session
+ * and bootloader layers use them. The arena is locked, so the worker and application tasks can
+ * allocate concurrently, the space of a released buffer is reclaimed once the buffers above it are
+ * released as well.
+ * @{
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "sdkconfig.h"
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Assign the arena to allocate from
+ *
+ * @param[in]  arena  start of the arena (shall be 8-byte aligned and DMA/internal RAM capable).
+ * @param[in]  size  size of the arena in bytes.
+ * @returns  error code representing the result of the action.
+ */
+esp_err_t ppmmem_setArena(void * arena, size_t size);
+
+/** Get the number of arena bytes consumed by a buffer
+ *
+ * @param[in]  size  requested size of the buffer in bytes.
+ * @returns  number of arena bytes used for the buffer (0 when allocating from the heap).
+ */
+size_t ppmmem_blockSize(size_t size);
+
+/** Allocate a buffer
+ *
+ * @param[in]  size  size of the buffer in bytes.
+ * @returns  pointer to the buffer or NULL on failure.
+ */
+void * ppmmem_malloc(size_t size);
+
+/** Allocate a zero initialized buffer
+ *
+ * @param[in]  count  number of elements.
+ * @param[in]  size  size of an element in bytes.
+ * @returns  pointer to the buffer or NULL on failure.
+ */
+void * ppmmem_calloc(size_t count, size_t size);
+
+/** Release a buffer
+ *
+ * @param[in]  ptr  buffer as returned by ppmmem_malloc() or ppmmem_calloc() (NULL is allowed).
+ */
+void ppmmem_free(void * ptr);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
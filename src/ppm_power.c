@@ -0,0 +1,189 @@
+/**
+ * @file
+ * @brief PPM DUT power sequencing module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM DUT power sequencing module.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ppm_bootloader.h"
+
+#include "ppm_power.h"
+
+static const char *TAG = "ppm_power";
+
+/** power configuration, nest_count 0 when the ppmbtl_chipPower() callouts are used */
+static ppm_power_config_t power_config;
+/** nest the actions are performed on */
+static uint8_t selected_nest = 0u;
+/** whether the nest power is enabled */
+static bool nest_powered[PPM_POWER_MAX_NESTS];
+/** time the nest was switched off [us] */
+static int64_t nest_off_time[PPM_POWER_MAX_NESTS];
+
+/** Switch a nest on or off through the nest power callout
+ *
+ * @param[in]  nest  nest to switch.
+ * @param[in]  enable  whether to enable the nest power.
+ */
+static void ppmpower_switchNest(uint8_t nest, bool enable);
+
+/** Wait until a chip switched off at some time has settled
+ *
+ * @param[in]  off_time  time the chip was switched off [us].
+ * @param[in]  settle_ms  settle time [ms].
+ */
+static void ppmpower_waitSettled(int64_t off_time, uint16_t settle_ms);
+
+
+static void ppmpower_switchNest(uint8_t nest, bool enable) {
+    if (enable == nest_powered[nest]) {
+        return;
+    }
+
+    power_config.set_power(nest, enable, power_config.user_ctx);
+    nest_powered[nest] = enable;
+    if (!enable) {
+        nest_off_time[nest] = esp_timer_get_time();
+    }
+}
+
+static void ppmpower_waitSettled(int64_t off_time, uint16_t settle_ms) {
+    int64_t settled_time = off_time + ((int64_t)settle_ms * 1000);
+    int64_t now = esp_timer_get_time();
+
+    if (settled_time > now) {
+        uint32_t remaining_ms = (uint32_t)((settled_time - now + 999) / 1000);
+        ESP_LOGD(TAG, "nest %u settling %u ms", (unsigned)selected_nest, (unsigned)remaining_ms);
+        vTaskDelay((remaining_ms + portTICK_PERIOD_MS - 1u) / portTICK_PERIOD_MS);
+    }
+}
+
+esp_err_t ppmpower_configure(const ppm_power_config_t * config) {
+    if (config == NULL) {
+        memset(&power_config, 0, sizeof(power_config));
+        selected_nest = 0u;
+        return ESP_OK;
+    }
+
+    if ((config->nest_count == 0u) || (config->nest_count > PPM_POWER_MAX_NESTS) || (config->set_power == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    power_config = *config;
+    for (uint8_t nest = 0u; nest < power_config.nest_count; nest++) {
+        /* the nest state is unknown, switch it off for sure */
+        nest_powered[nest] = true;
+        ppmpower_switchNest(nest, false);
+    }
+
+    return ppmpower_selectNest(0u);
+}
+
+esp_err_t ppmpower_selectNest(uint8_t nest) {
+    if ((power_config.nest_count == 0u) || (nest >= power_config.nest_count)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    selected_nest = nest;
+    if (power_config.select_bus != NULL) {
+        power_config.select_bus(nest, power_config.user_ctx);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ppmpower_stageNest(uint8_t nest) {
+    if (power_config.nest_count == 0u) {
+        return ESP_OK;
+    }
+    if (nest >= power_config.nest_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* the settle time of the next chip runs while the current one is handled */
+    ppmpower_switchNest(nest, false);
+
+    return ESP_OK;
+}
+
+ppm_err_t ppmpower_runNests(const uint8_t * nests,
+                            size_t count,
+                            ppm_power_action_cb_t action,
+                            void * user_ctx,
+                            ppm_err_t * results) {
+    if ((nests == NULL) || (count == 0u) || (action == NULL)) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    ppm_err_t retval = PPM_OK;
+    for (size_t i = 0u; i < count; i++) {
+        ppm_err_t result = PPM_FAIL_INTERNAL;
+
+        if (ppmpower_selectNest(nests[i]) == ESP_OK) {
+            if (((i + 1u) < count) && (ppmpower_stageNest(nests[i + 1u]) != ESP_OK)) {
+                ESP_LOGW(TAG, "nest %u can not be staged", (unsigned)nests[i + 1u]);
+            }
+            result = action(nests[i], user_ctx);
+        } else {
+            ESP_LOGE(TAG, "invalid nest %u", (unsigned)nests[i]);
+        }
+
+        if (results != NULL) {
+            results[i] = result;
+        }
+        if ((retval == PPM_OK) && (result != PPM_OK)) {
+            retval = result;
+        }
+    }
+
+    return retval;
+}
+
+void ppmpower_prepareChip(void) {
+    if (power_config.nest_count == 0u) {
+        if (ppmbtl_chipPowered()) {
+            ppmbtl_chipPower(false);
+            vTaskDelay(PPM_POWER_SETTLE_MS_DEFAULT / portTICK_PERIOD_MS);
+        }
+        return;
+    }
+
+    ppmpower_switchNest(selected_nest, false);
+    ppmpower_waitSettled(nest_off_time[selected_nest], power_config.settle_ms);
+}
+
+void ppmpower_setChip(bool enable) {
+    if (power_config.nest_count == 0u) {
+        ppmbtl_chipPower(enable);
+    } else {
+        ppmpower_switchNest(selected_nest, enable);
+    }
+}
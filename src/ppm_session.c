@@ -28,11 +28,14 @@
 #include <math.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "mlx_crc.h"
 
+#include "ppm_event.h"
+#include "ppm_mem.h"
 #include "rmt_ppm.h"
 #include "ppm_types.h"
 
@@ -40,81 +43,186 @@
 
 static const char *TAG = "ppm_session";
 
+/** Number of data words in a session acknowledge */
+#define PPM_SESSION_ACK_WORDS 4u
+
+/** Bus idle time between a session frame and its first page frame [us] */
+#define PPM_SESSION_PAGE_GAP_US 200u
+
+/** page source context for page data stored contiguous in memory */
+typedef struct {
+    const uint16_t * page_data;         /**< page data words */
+    uint8_t page_size;                  /**< page size (in words) */
+} ppm_buffer_source_t;
+
+/** page source context which transmits page 0 last (flash programming order) */
+typedef struct {
+    ppm_page_source_t source;           /**< page source providing the pages in memory order */
+    void * source_ctx;                  /**< context of the page source */
+    uint16_t page_count;                /**< number of pages in the memory */
+} ppm_rotated_source_t;
+
+/** page frame under construction (sequence/checksum word followed by the page data) */
+static uint16_t page_frame[1u + PPM_PAGE_MAX_WORDS];
+
+/** last received acknowledge frame */
+static uint16_t ack_frame[RMT_PPM_MAX_FRAME_WORDS];
+
+/** session engine statistics */
+static ppm_session_stats_t session_stats;
+
+/** wire statistics of session types not fitting in the statistics (not reported) */
+static ppm_session_wire_t wire_overflow;
+
+/** wire statistics of the session type being handled */
+static ppm_session_wire_t * wire_current = &wire_overflow;
+
 /** Send a session frame on the bus
  *
  * @param[in]  config  session configuration.
  * @param[in]  page_count  number of pages to be transmitted in this session.
  * @param[in]  offset  offset to be used by this programming session.
  * @param[in]  checksum  checksum for the to be programmed memory.
+ * @param[in]  idle_us  bus idle time to the first page frame, 0 when no pages follow.
  *
  * @return  an error code representing the result of the operation.
  */
 static esp_err_t send_session_frame(const ppm_session_config_t * config,
                                     uint16_t page_count,
                                     uint16_t offset,
-                                    uint16_t checksum);
+                                    uint16_t checksum,
+                                    uint32_t idle_us);
 
-/** Receive a session acknowledge from the bus
+/** Receive an acknowledge of a specific frame type from the bus into ack_frame
  *
- * @param[out]  rx_data  the acknowledge frame data received (to be deleted by consumer).
- * @param[in]  timeout  the timeout to wait for an acknowledge to be received (in ms).
+ * Late acknowledges of earlier frames are discarded while waiting, they are recognized by the
+ * upper byte of the first word (page sequence number or session command).
  *
- * @return  the length of the received data.
+ * @param[in]  type  expected frame type of the acknowledge.
+ * @param[in]  expected  expected first word of the acknowledge as transmitted by the chip.
+ * @param[in]  bus_timeout  the timeout to wait for an acknowledge to be received (in ms).
+ *
+ * @return  the length of the received data (0 when no acknowledge of the expected type was received).
  */
-static uint16_t receive_session_ack(uint16_t ** rx_data, uint16_t bus_timeout);
+static size_t receive_ack(ppm_frame_type_t type, uint16_t expected, uint16_t bus_timeout);
 
-/** Send a page frame on the bus
+/** Send all page frames of a session
  *
- * @param[in]  sequence_number  number of pages to be transmitted in this session.
- * @param[in]  page_checksum  offset to be used by this programming session.
- * @param[in]  data_words  checksum for the to be programmed memory.
- * @param[in]  data_length  length of the data to transmit.
+ * @param[in]  config  session configuration.
+ * @param[in]  desc  session descriptor.
  *
  * @return  an error code representing the result of the operation.
  */
-static esp_err_t send_page_frame(uint8_t sequence_number,
-                                 uint8_t page_checksum,
-                                 const uint16_t * data_words,
-                                 size_t data_length);
+static esp_err_t send_pages(const ppm_session_config_t * config, const ppm_session_desc_t * desc);
 
-/** Receive a page acknowledge from the bus
+/** Get the wire statistics entry of a session type
  *
- * @param[out]  rx_data  the acknowledge frame data received (to be deleted by consumer).
- * @param[in]  timeout  the timeout to wait for an acknowledge to be received.
+ * @param[in]  session_id  session type.
  *
- * @return  the length of the received data.
+ * @return  wire statistics entry, a new entry at the first use of the session type.
  */
-static uint16_t receive_page_ack(uint16_t ** rx_data, uint16_t bus_timeout);
+static ppm_session_wire_t * wire_entry(uint8_t session_id);
 
-/** Handle a complete session
+/** Get the nominal time of the data symbols of a frame
  *
- * This method will handle a complete ppm session, meaning it will:
- * - send session frame
- * - send page frame(s)
- * - read/verify page ack(s) -> if enabled
- * - read/verify session ack -> if enabled
+ * @param[in]  words  frame data words.
+ * @param[in]  count  number of frame data words.
+ *
+ * @return  nominal time of the data symbols [1/4 us at the nominal bitrate].
+ */
+static uint32_t frame_symbol_time(const uint16_t * words, size_t count);
+
+/** Send a frame and account it in the wire statistics
+ *
+ * With an idle time the frame is only queued, the next frame can be prepared while it is on the
+ * wire. Without, the function returns once the frame and all frames queued before are transmitted.
+ *
+ * @param[in]  type  frame type.
+ * @param[in]  words  frame data words.
+ * @param[in]  count  number of frame data words.
+ * @param[in]  idle_us  bus idle time to the next frame, 0 to wait for the transmission.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t send_frame(ppm_frame_type_t type, const uint16_t * words, size_t count, uint32_t idle_us);
+
+/** Page source reading pages from a contiguous buffer
+ *
+ * @param[in]  ctx  page source context (ppm_buffer_source_t).
+ * @param[in]  page_index  index of the page to get.
+ * @param[out]  page_words  buffer to be filled with the page data words.
+ * @param[out]  page_checksum  checksum of the page.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t buffer_page_source(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum);
+
+/** Page source transmitting pages 1..n-1 first followed by page 0
+ *
+ * @param[in]  ctx  page source context (ppm_rotated_source_t).
+ * @param[in]  page_index  sequence number of the page to get.
+ * @param[out]  page_words  buffer to be filled with the page data words.
+ * @param[out]  page_checksum  checksum of the page.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t rotated_page_source(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum);
+
+/** Acknowledge validator checking the offset and checksum fields are echoed
+ *
+ * @param[in]  desc  session descriptor.
+ * @param[in]  ack  session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  true when the acknowledge content is as expected.
+ */
+static bool ack_echoes_fields(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length);
+
+/** Acknowledge validator checking the checksum field is echoed
+ *
+ * @param[in]  desc  session descriptor.
+ * @param[in]  ack  session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  true when the acknowledge content is as expected.
+ */
+static bool ack_echoes_checksum(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length);
+
+/** Result extractor storing the last acknowledge word (project id or 16-bit crc)
+ *
+ * @param[in]  desc  session descriptor (result is a uint16_t pointer).
+ * @param[in]  ack  session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t extract_word(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length);
+
+/** Result extractor storing the 24-bit flash crc
+ *
+ * @param[in]  desc  session descriptor (result is a uint32_t pointer).
+ * @param[in]  ack  session acknowledge data words.
+ * @param[in]  ack_length  number of session acknowledge data words.
+ *
+ * @return  an error code representing the result of the operation.
+ */
+static esp_err_t extract_flash_crc(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length);
+
+/** Get the number of pages needed for some data
  *
  * @param[in]  config  session configuration.
- * @param[in]  offset  offset to be used by this programming session.
- * @param[in]  checksum  checksum for the to be programmed memory.
- * @param[in]  page_data  page data to be send to the ppm slave.
- * @param[in]  page_data_len  length of the page data to be send (needs to be page aligned).
- * @param[in]  rx_data  data which was received in the session acknowledge.
+ * @param[in]  words_length  number of data words.
  *
- * @return  length of the response data.
+ * @return  number of pages.
  */
-static size_t handle_session(const ppm_session_config_t * config,
-                             uint16_t offset,
-                             uint16_t checksum,
-                             const uint16_t * page_data,
-                             uint32_t page_data_len,
-                             uint16_t ** rx_data);
+static uint16_t page_count_for(const ppm_session_config_t * config, uint32_t words_length);
 
 
 static esp_err_t send_session_frame(const ppm_session_config_t * config,
                                     uint16_t page_count,
                                     uint16_t offset,
-                                    uint16_t checksum) {
+                                    uint16_t checksum,
+                                    uint32_t idle_us) {
     /* assemble the command byte */
     uint8_t session_command = config->session_id;
 
@@ -129,266 +237,299 @@ static esp_err_t send_session_frame(const ppm_session_config_t * config,
     session_frame[2] = offset;
     session_frame[3] = checksum;
 
-    /* send the frame and wait for the response (first response is the TX message to verify) */
-    return rmt_ppm_send_frame(ftSession, session_frame, 4u);
+    /* send the frame, its echo on a shared TX/RX pin is dropped by the transport */
+    return send_frame(ftSession, session_frame, 4u, idle_us);
 }
 
-static uint16_t receive_session_ack(uint16_t ** rx_data, uint16_t bus_timeout) {
-    uint16_t rx_lenght = 0u;
+static size_t receive_ack(ppm_frame_type_t type, uint16_t expected, uint16_t bus_timeout) {
+    int64_t wait_start = esp_timer_get_time();
+    size_t rx_length = rmt_ppm_receive_ack(type, expected, 0xFF00u, ack_frame, RMT_PPM_MAX_FRAME_WORDS, bus_timeout);
+    wire_current->time_wait += (uint64_t)(esp_timer_get_time() - wait_start);
+
+    if (rx_length > 0u) {
+        wire_current->acks++;
+        wire_current->ack_bits += (uint32_t)(rx_length * 16u);
+    }
+
+    if ((type == ftSession) && (rx_length > 0u)) {
+        /* apply MLX81332-77 workaround */
+        ack_frame[0] -= 1u;
+    }
 
-    if (rx_data != NULL) {
-        ppm_frame_type_t type = ftUnknown;
-        rx_lenght = rmt_ppm_wait_for_response_frame(&type, rx_data, bus_timeout);
+    return rx_length;
+}
 
-        if (*rx_data != NULL) {
-            /* apply MLX81332-77 workaround */
-            (*rx_data)[0] -= 1u;
+static ppm_session_wire_t * wire_entry(uint8_t session_id) {
+    for (size_t i = 0u; i < PPM_SESSION_WIRE_TYPES; i++) {
+        ppm_session_wire_t * entry = &session_stats.wire[i];
+        if (entry->session_id == 0u) {
+            entry->session_id = session_id;
         }
+        if (entry->session_id == session_id) {
+            return entry;
+        }
+    }
+    return &wire_overflow;
+}
 
-        if (type != ftSession) {
-            /* not expected acknowledge session type received */
-            rx_lenght = 0u;
+static uint32_t frame_symbol_time(const uint16_t * words, size_t count) {
+    uint32_t two_bits_total = 0u;
 
-            if (*rx_data != NULL) {
-                free(*rx_data);
-                *rx_data = NULL;
-            }
+    /* every 2 bits take the base symbol time plus one bit distance per value step */
+    for (size_t i = 0u; i < count; i++) {
+        for (uint8_t shift = 0u; shift < 16u; shift += 2u) {
+            two_bits_total += (words[i] >> shift) & 0x3u;
         }
-    } else {
-        /* no pointer provided, this makes no sense */
-        ESP_LOGE(TAG, "rx_data pointer is empty");
     }
 
-    return rx_lenght;
+    return (uint32_t)((count * 8u * (uint32_t)PPM_SYMBOL_BASE_TIME) + (two_bits_total * (uint32_t)PPM_BIT_DISTANCE));
 }
 
-static esp_err_t send_page_frame(uint8_t sequence_number,
-                                 uint8_t page_checksum,
-                                 const uint16_t * data_words,
-                                 size_t data_length) {
-    esp_err_t result = ESP_FAIL;
-
-    if ((data_length <= 128u) && (data_words != NULL)) {
-        /* lets start creating the frame data */
-        uint16_t * page_frame = (uint16_t*)calloc(1u + data_length, sizeof(uint16_t));
-        if (page_frame != NULL) {
-            page_frame[0] = (((uint16_t)sequence_number) << 8) | ((uint16_t)page_checksum);
-            memcpy(&page_frame[1], &data_words[0], data_length * sizeof(uint16_t));
+static esp_err_t send_frame(ppm_frame_type_t type, const uint16_t * words, size_t count, uint32_t idle_us) {
+    int64_t tx_start = esp_timer_get_time();
+    esp_err_t result = rmt_ppm_send_frame_async(type, words, count, idle_us);
+    if ((result == ESP_OK) && (idle_us == 0u)) {
+        result = rmt_ppm_wait_tx_done();
+    }
+    wire_current->time_tx += (uint64_t)(esp_timer_get_time() - tx_start);
 
-            /* send the frame and wait for the response (first response is the TX message to verify) */
-            result = rmt_ppm_send_frame(ftPage, page_frame, 1u + data_length);
-        } else {
-            /* mem allocation failed */
-            ESP_LOGE(TAG, "mem allocation failed for send page frame");
-            return ESP_ERR_NO_MEM;
-        }
-        free(page_frame);
-    } else {
-        /* incorrect data length or no buffer */
-        ESP_LOGE(TAG, "incorrect data length of incorrect pointer received");
-        return ESP_ERR_INVALID_ARG;
+    if (result == ESP_OK) {
+        wire_current->frames++;
+        wire_current->pulse_time += (uint32_t)((type == ftSession) ? PPM_SESSION_PULSE_TIME : PPM_PAGE_PULSE_TIME);
+        wire_current->symbol_time += frame_symbol_time(words, count);
     }
 
     return result;
 }
 
-static uint16_t receive_page_ack(uint16_t ** rx_data, uint16_t bus_timeout) {
-    uint16_t rx_lenght = 0u;
+static esp_err_t send_pages(const ppm_session_config_t * config, const ppm_session_desc_t * desc) {
+    if (config->page_size > PPM_PAGE_MAX_WORDS) {
+        ESP_LOGE(TAG, "incorrect page size %u", config->page_size);
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    if (rx_data != NULL) {
-        ppm_frame_type_t type = ftUnknown;
-        rx_lenght = rmt_ppm_wait_for_response_frame(&type, rx_data, bus_timeout);
+    for (uint16_t seqnr = 0u; seqnr < desc->page_count; seqnr++) {
+        uint8_t page_checksum = 0u;
+        uint16_t page_frame_timeout = (seqnr == 0u) ? config->page0_ack_timeout : config->pageX_ack_timeout;
+        int64_t page_start = esp_timer_get_time();
 
-        if (type != ftPage) {
-            /* not expected acknowledge session type received */
-            rx_lenght = 0u;
+        /* the page source fills the page data directly into the frame */
+        if (desc->source(desc->source_ctx, seqnr, &page_frame[1], &page_checksum) != ESP_OK) {
+            ESP_LOGE(TAG, "page source failed for page %u", seqnr);
+            return ESP_FAIL;
+        }
+        page_frame[0] = (((uint16_t)(seqnr & 0xFFu)) << 8) | ((uint16_t)page_checksum);
 
-            if (*rx_data != NULL) {
-                free(*rx_data);
-                *rx_data = NULL;
+        if (send_frame(ftPage, page_frame, 1u + config->page_size, 0u) != ESP_OK) {
+            ESP_LOGE(TAG, "page programming failed");
+            return ESP_FAIL;
+        }
+        session_stats.pages++;
+        PPM_EVENT(PPM_EVENT_PAGE_TX, seqnr, page_checksum);
+        wire_current->payload_bits += (uint32_t)config->page_size * 16u;
+        wire_current->page_header_bits += 8u;
+        wire_current->page_checksum_bits += 8u;
+
+        if (config->request_ack == false) {
+            /* wait for fixed time for write/erase to be done */
+            int64_t wait_start = esp_timer_get_time();
+            vTaskDelay(page_frame_timeout / portTICK_PERIOD_MS);
+            wire_current->time_wait += (uint64_t)(esp_timer_get_time() - wait_start);
+        } else {
+            /* wait for page ack */
+            uint16_t page_ack = (uint16_t)(((seqnr & 0xFFu) << 8) | (page_checksum & 0xFFu));
+            size_t resp_len = receive_ack(ftPage, page_ack, page_frame_timeout);
+            if (resp_len == 0u) {
+                session_stats.page_ack_missing++;
+                ESP_LOGE(TAG, "page programming failed");
+                return ESP_ERR_TIMEOUT;
+            }
+            if (ack_frame[0] != page_ack) {
+                session_stats.page_ack_invalid++;
+                ESP_LOGE(TAG, "page programming failed");
+                return ESP_ERR_INVALID_RESPONSE;
             }
         }
-    } else {
-        /* incorrect buffer */
-        ESP_LOGE(TAG, "incorrect pointer received");
+
+        uint32_t page_time = (uint32_t)(esp_timer_get_time() - page_start);
+        session_stats.page_time_total += page_time;
+        if (page_time > session_stats.page_time_max) {
+            session_stats.page_time_max = page_time;
+        }
     }
 
-    return rx_lenght;
+    return ESP_OK;
 }
 
-static size_t handle_session(const ppm_session_config_t * config,
-                             uint16_t offset,
-                             uint16_t checksum,
-                             const uint16_t * page_data,
-                             uint32_t page_data_len,
-                             uint16_t ** rx_data) {
-    size_t ret_len = 0;
-    uint16_t page_count = 0u;
-    uint16_t session_ack_timeout = config->session_ack_timeout;
-
-    if (config->page_size != 0u) {
-        page_count = ceil((float)page_data_len / config->page_size);
-    }
+static esp_err_t buffer_page_source(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum) {
+    const ppm_buffer_source_t * buffer = (const ppm_buffer_source_t *)ctx;
 
-    if (send_session_frame(config, page_count, offset, checksum) == ESP_OK) {
-        bool blPageSuccess = true;
-
-        if ((page_data != NULL) && (page_count != 0u)) {
-            /* older chips need some more time between session and page frames */
-            esp_rom_delay_us(200);
-
-            /* handle all page frames */
-            uint16_t * page_data_words = (uint16_t*)calloc(config->page_size, sizeof(uint16_t));
-            if (page_data_words != NULL) {
-                for (uint16_t seqnr = 0u; seqnr < page_count; seqnr++) {
-                    /* get the relevant data words for this page frame */
-                    memcpy(&page_data_words[0],
-                           &page_data[seqnr * config->page_size],
-                           config->page_size * sizeof(uint16_t));
-                    uint16_t page_checksum = crc_calcPageChecksum(page_data_words, config->page_size);
-
-                    blPageSuccess = false;
-
-                    if (send_page_frame(seqnr & 0xFFu,
-                                        page_checksum,
-                                        page_data_words,
-                                        config->page_size) == ESP_OK) {
-                        uint16_t page_frame_timeout;
-
-                        if (seqnr == 0u) {
-                            page_frame_timeout = config->page0_ack_timeout;
-                        } else {
-                            page_frame_timeout = config->pageX_ack_timeout;
-                        }
-
-                        if (config->request_ack == false) {
-                            /* wait for fixed time for write/erase to be done */
-                            vTaskDelay(page_frame_timeout / portTICK_PERIOD_MS);
-
-                            blPageSuccess = true;
-                        } else {
-                            /* wait for page ack */
-                            uint16_t * resp_data = NULL;
-                            uint16_t resp_len = receive_page_ack(&resp_data, page_frame_timeout);
-
-                            if ((resp_data != NULL) && (resp_len > 0u)) {
-                                if (resp_data[0] == (((seqnr & 0xFFu) << 8) | (page_checksum & 0xFFu))) {
-                                    blPageSuccess = true;
-                                }
-                            }
-
-                            free(resp_data);
-                        }
-                    }
-
-                    if (blPageSuccess == false) {
-                        ESP_LOGE(TAG, "page programming failed");
-                        break;
-                    }
-                }
-            } else {
-                /* mem allocation failed */
-                ESP_LOGE(TAG, "mem allocation failed for handle session");
-            }
-            free(page_data_words);
-        } else {
-            /* no data needs transmission */
-        }
+    memcpy(&page_words[0],
+           &buffer->page_data[page_index * buffer->page_size],
+           buffer->page_size * sizeof(uint16_t));
+    *page_checksum = (uint8_t)crc_calcPageChecksum(page_words, buffer->page_size);
 
-        if (blPageSuccess == true) {
-            if (config->request_ack == false) {
-                /* wait for session to be done */
-                vTaskDelay(session_ack_timeout / portTICK_PERIOD_MS);
-            } else {
-                /* wait for session ack */
-                if (rx_data != NULL) {
-                    uint16_t resp_len = receive_session_ack(rx_data, session_ack_timeout);
-
-                    if (*rx_data != NULL) {
-                        uint16_t session_command = (uint16_t)config->session_id;
-
-                        if ( ((*rx_data)[0] == ((session_command << 8) | ((uint16_t)config->page_size))) &&
-                             ((*rx_data)[1] == page_count) ) {
-                            ret_len = resp_len;
-                        } else {
-                            free(*rx_data);
-                            *rx_data = NULL;
-                        }
-                    } else {
-                        /* no session ack was received */
-                        ESP_LOGE(TAG, "no session ack received");
-                    }
-                }
-            }
-        }
+    return ESP_OK;
+}
+
+static esp_err_t rotated_page_source(void * ctx, uint16_t page_index, uint16_t * page_words, uint8_t * page_checksum) {
+    const ppm_rotated_source_t * rotated = (const ppm_rotated_source_t *)ctx;
+
+    return rotated->source(rotated->source_ctx,
+                           (uint16_t)((page_index + 1u) % rotated->page_count),
+                           page_words,
+                           page_checksum);
+}
+
+static bool ack_echoes_fields(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length) {
+    (void)ack_length;
+    return (ack[2] == desc->offset) && (ack[3] == desc->checksum);
+}
+
+static bool ack_echoes_checksum(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length) {
+    (void)ack_length;
+    return (ack[3] == desc->checksum);
+}
+
+static esp_err_t extract_word(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length) {
+    if (desc->result == NULL) {
+        ESP_LOGE(TAG, "invalid %s result pointer received", desc->name);
+        return ESP_ERR_INVALID_ARG;
     }
+    (void)ack_length;
+    *(uint16_t *)desc->result = ack[3];
+    return ESP_OK;
+}
 
-    return ret_len;
+static esp_err_t extract_flash_crc(const ppm_session_desc_t * desc, const uint16_t * ack, size_t ack_length) {
+    (void)ack_length;
+    if (desc->result == NULL) {
+        ESP_LOGE(TAG, "invalid %s result pointer received", desc->name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    *(uint32_t *)desc->result = ((uint32_t)(ack[2] & 0xFFu) << 16) | (uint32_t)(ack[3]);
+    return ESP_OK;
 }
 
-esp_err_t ppmsession_doUnlock(const ppm_session_config_t * config, uint16_t * project_id) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t * rx_data = NULL;
+static uint16_t page_count_for(const ppm_session_config_t * config, uint32_t words_length) {
+    if (config->page_size == 0u) {
+        return 0u;
+    }
+    return (uint16_t)((words_length + config->page_size - 1u) / config->page_size);
+}
 
-    ESP_LOGD(TAG, "do unlock session");
+esp_err_t ppmsession_run(const ppm_session_config_t * config, const ppm_session_desc_t * desc) {
+    esp_err_t result = ESP_OK;
+    int64_t session_start = esp_timer_get_time();
 
-    size_t rx_length = handle_session(config, 0x8374u, 0xBF12u, NULL, 0u, &rx_data);
+    PPM_EVENT(PPM_EVENT_SESSION_START, config->session_id, desc->page_count);
+    session_stats.sessions++;
+    wire_current = wire_entry(config->session_id);
+    wire_current->sessions++;
 
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if (rx_length == 4) {
-            if (project_id != NULL) {
-                *project_id = rx_data[3];
-            }
-            result = ESP_OK;
-        } else {
-            ESP_LOGE(TAG, "incorrect unlock session response length");
-        }
+    /* responses which arrived after an earlier session gave up on them are stale */
+    (void)rmt_ppm_flush_rx();
+
+    /* older chips need some more time between session and page frames, the session frame is
+     * queued with this gap so the first page is prepared while it is transmitted */
+    bool pages_follow = (desc->source != NULL) && (desc->page_count != 0u);
+    uint32_t session_idle_us = pages_follow ? PPM_SESSION_PAGE_GAP_US : 0u;
+    if (send_session_frame(config, desc->page_count, desc->offset, desc->checksum, session_idle_us) != ESP_OK) {
+        result = ESP_FAIL;
     } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not */
-            ESP_LOGE(TAG, "no unlock session response received");
+        wire_current->session_bits += 4u * 16u;
+    }
+
+    if ((result == ESP_OK) && pages_follow) {
+        result = send_pages(config, desc);
+    }
+    /* nothing stays queued when the session ends early */
+    (void)rmt_ppm_wait_tx_done();
+
+    if (result == ESP_OK) {
+        if (config->request_ack == false) {
+            /* wait for session to be done, no response expected at all */
+            int64_t wait_start = esp_timer_get_time();
+            vTaskDelay(config->session_ack_timeout / portTICK_PERIOD_MS);
+            wire_current->time_wait += (uint64_t)(esp_timer_get_time() - wait_start);
         } else {
-            /* no response expected at all */
-            result = ESP_OK;
+            /* wait for session ack (chip transmits the header incremented, see receive_ack) */
+            uint16_t session_header = (((uint16_t)config->session_id) << 8) | ((uint16_t)config->page_size);
+            size_t resp_len = receive_ack(ftSession, session_header + 1u, config->session_ack_timeout);
+
+            if (resp_len == 0u) {
+                session_stats.session_ack_missing++;
+                ESP_LOGE(TAG, "no %s session response received", desc->name);
+                result = ESP_ERR_TIMEOUT;
+            } else if ((resp_len != PPM_SESSION_ACK_WORDS) ||
+                       (ack_frame[0] != session_header) ||
+                       (ack_frame[1] != desc->page_count) ||
+                       ((desc->validate != NULL) && !desc->validate(desc, ack_frame, resp_len))) {
+                session_stats.session_ack_invalid++;
+                ESP_LOGE(TAG, "incorrect %s session response", desc->name);
+                result = ESP_ERR_INVALID_RESPONSE;
+            } else if (desc->extract != NULL) {
+                result = desc->extract(desc, ack_frame, resp_len);
+            }
         }
     }
 
-    free(rx_data);
+    if (result != ESP_OK) {
+        session_stats.sessions_failed++;
+    }
+    PPM_EVENT(PPM_EVENT_SESSION_END, config->session_id, result);
+    uint64_t session_time = (uint64_t)(esp_timer_get_time() - session_start);
+    session_stats.session_time_total += session_time;
+    wire_current->time_total += session_time;
 
     return result;
 }
 
-esp_err_t ppmsession_doFlashProgKeys(const ppm_session_config_t * config, const uint16_t * prog_keys, size_t length) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t * rx_data = NULL;
+void ppmsession_getStats(ppm_session_stats_t * stats) {
+    if (stats != NULL) {
+        *stats = session_stats;
+    }
+}
 
-    ESP_LOGD(TAG, "do flash prog keys session");
+void ppmsession_resetStats(void) {
+    memset(&session_stats, 0, sizeof(session_stats));
+}
 
-    size_t rx_length = handle_session(config, 0xBEBEu, 0xBEBEu, prog_keys, length, &rx_data);
+size_t ppmsession_getArenaSize(size_t max_data_length) {
+    size_t max_page_words = UINT8_MAX;
 
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if ((rx_length == 4) && (rx_data[2] == 0xBEBEu) && (rx_data[3] == 0xBEBEu)) {
-            result = ESP_OK;
-        } else {
-            ESP_LOGE(TAG, "incorrect flash prog keys response");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not*/
-            ESP_LOGE(TAG, "no flash prog keys response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
-    }
+    /* only the flash image words are allocated, the session engine itself does not allocate */
+    return ppmmem_blockSize((((max_data_length + 1u) / 2u) + max_page_words) * sizeof(uint16_t));
+}
 
-    free(rx_data);
+esp_err_t ppmsession_doUnlock(const ppm_session_config_t * config, uint16_t * project_id) {
+    ppm_session_desc_t desc = {
+        .name = "unlock",
+        .offset = 0x8374u,
+        .checksum = 0xBF12u,
+        .extract = (project_id != NULL) ? extract_word : NULL,
+        .result = project_id,
+    };
+
+    return ppmsession_run(config, &desc);
+}
 
-    return result;
+esp_err_t ppmsession_doFlashProgKeys(const ppm_session_config_t * config, const uint16_t * prog_keys, size_t length) {
+    ppm_buffer_source_t buffer = {
+        .page_data = prog_keys,
+        .page_size = config->page_size,
+    };
+    ppm_session_desc_t desc = {
+        .name = "flash prog keys",
+        .offset = 0xBEBEu,
+        .checksum = 0xBEBEu,
+        .page_count = page_count_for(config, length),
+        .source = (prog_keys != NULL) ? buffer_page_source : NULL,
+        .source_ctx = &buffer,
+        .validate = ack_echoes_fields,
+    };
+
+    return ppmsession_run(config, &desc);
 }
 
 esp_err_t ppmsession_doFlashProgramming(const ppm_session_config_t * config,
@@ -398,296 +539,201 @@ esp_err_t ppmsession_doFlashProgramming(const ppm_session_config_t * config,
     uint16_t words_length;
     uint16_t * flash_words = NULL;
 
-    ESP_LOGD(TAG, "do flash programming session");
-
     if (config->crc_func != NULL) {
         words_length = ceil((double)length / 2);
-        flash_words = (uint16_t*)calloc(words_length + config->page_size, sizeof(uint16_t));
+        flash_words = (uint16_t*)ppmmem_calloc(words_length + config->page_size, sizeof(uint16_t));
 
         if (flash_words != NULL) {
-            uint16_t * rx_data = NULL;
-
             for (uint16_t ctr = 0u; ctr < words_length; ctr++) {
                 flash_words[ctr] = (uint16_t)(flash_bytes[ctr * 2]) | ((uint16_t)(flash_bytes[(ctr * 2) + 1]) << 8);
             }
 
             uint32_t flash_crc = config->crc_func(flash_words, words_length, 1u);
 
-            /* we need to start at page 1 and end with page 0!!!! */
-            for (uint16_t ctr = 0u; ctr < config->page_size; ctr++) {
-                flash_words[words_length + ctr] = flash_words[ctr];
-            }
-
-            size_t rx_length = handle_session(config,
-                                              (uint16_t)((flash_crc >> 16) & 0xFFu),
-                                              (uint16_t)flash_crc,
-                                              &flash_words[config->page_size],
-                                              words_length,
-                                              &rx_data);
-
-            if (rx_data != NULL) {
-                /* lets check the ack content */
-                if ((rx_length == 4) &&
-                    (rx_data[2] == (uint16_t)((flash_crc >> 16) & 0xFFu)) &&
-                    (rx_data[3] == (uint16_t)flash_crc)) {
-                    result = ESP_OK;
-                } else {
-                    ESP_LOGE(TAG, "incorrect flash programming response");
-                }
-            } else {
-                /* no ack was received */
-                if (config->request_ack == true) {
-                    /* we should have gotten an ack... but we did not*/
-                    ESP_LOGE(TAG, "no flash programming response received");
-                } else {
-                    /* no response expected at all */
-                    result = ESP_OK;
-                }
-            }
+            ppm_buffer_source_t buffer = {
+                .page_data = flash_words,
+                .page_size = config->page_size,
+            };
 
-            free(rx_data);
+            result = ppmsession_doFlashProgrammingPages(config,
+                                                        page_count_for(config, words_length),
+                                                        flash_crc,
+                                                        buffer_page_source,
+                                                        &buffer);
         } else {
             /* mem allocation failed */
             ESP_LOGE(TAG, "mem allocation failed for flash programming do session");
         }
     }
 
-    free(flash_words);
+    ppmmem_free(flash_words);
 
     return result;
 }
 
+esp_err_t ppmsession_doFlashProgrammingPages(const ppm_session_config_t * config,
+                                             uint16_t page_count,
+                                             uint32_t flash_crc,
+                                             ppm_page_source_t source,
+                                             void * source_ctx) {
+    if ((source == NULL) || (page_count == 0u)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* we need to start at page 1 and end with page 0!!!! */
+    ppm_rotated_source_t rotated = {
+        .source = source,
+        .source_ctx = source_ctx,
+        .page_count = page_count,
+    };
+    ppm_session_desc_t desc = {
+        .name = "flash programming",
+        .offset = (uint16_t)((flash_crc >> 16) & 0xFFu),
+        .checksum = (uint16_t)flash_crc,
+        .page_count = page_count,
+        .source = rotated_page_source,
+        .source_ctx = &rotated,
+        .validate = ack_echoes_fields,
+    };
+
+    return ppmsession_run(config, &desc);
+}
+
 esp_err_t ppmsession_doEepromProgramming(const ppm_session_config_t * config,
                                          uint16_t mem_offset,
                                          const uint8_t * data_bytes,
                                          size_t data_length) {
-    esp_err_t result = ESP_FAIL;
     uint16_t words_length = ceil((double)data_length / 2);
     uint16_t page_offset = ceil((double)mem_offset / 2 / config->page_size);
-
-    ESP_LOGD(TAG, "do eeprom programming session");
-
     uint16_t eeprom_crc = crc_calc16bitCrc(data_bytes, data_length, 0x1D0Fu);
 
-    uint16_t * rx_data = NULL;
-    size_t rx_length = handle_session(config,
-                                      page_offset,
-                                      eeprom_crc,
-                                      (uint16_t *)(&data_bytes[0]),
-                                      words_length,
-                                      &rx_data);
-
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        ESP_LOGE(TAG, "crc calc = %d  chip = %d", eeprom_crc, rx_data[3]);
-
-        if ((rx_length == 4) && (rx_data[3] == eeprom_crc)) {
-            result = ESP_OK;
-        } else {
-            ESP_LOGE(TAG, "incorrect eeprom programming response");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not*/
-            ESP_LOGE(TAG, "no eeprom programming response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
+    ppm_buffer_source_t buffer = {
+        .page_data = (const uint16_t *)(&data_bytes[0]),
+        .page_size = config->page_size,
+    };
+    ppm_session_desc_t desc = {
+        .name = "eeprom programming",
+        .offset = page_offset,
+        .checksum = eeprom_crc,
+        .page_count = page_count_for(config, words_length),
+        .source = buffer_page_source,
+        .source_ctx = &buffer,
+        .validate = ack_echoes_checksum,
+    };
+
+    esp_err_t result = ppmsession_run(config, &desc);
+    if ((result == ESP_ERR_INVALID_RESPONSE) && (config->request_ack == true)) {
+        PPM_EVENT(PPM_EVENT_EEPROM_CRC, eeprom_crc, ack_frame[3]);
     }
 
-    free(rx_data);
-
     return result;
 }
 
 esp_err_t ppmsession_doFlashCsProgramming(const ppm_session_config_t * config,
                                           const uint8_t * data_bytes,
                                           size_t data_length) {
-    esp_err_t result = ESP_FAIL;
     uint16_t words_length = ceil((double)data_length / 2);
-
-    ESP_LOGD(TAG, "do flash cs programming session");
-
     uint16_t flash_crc = crc_calc16bitCrc(data_bytes, data_length, 0x1D0Fu);
 
-    uint16_t * rx_data = NULL;
-    size_t rx_length = handle_session(config,
-                                      0u,                            // offset
-                                      flash_crc,                     // checksum
-                                      (uint16_t *)(&data_bytes[0]),  // page_data
-                                      words_length,                  // page_data_len
-                                      &rx_data);                     // rx_data
-
+    ppm_buffer_source_t buffer = {
+        .page_data = (const uint16_t *)(&data_bytes[0]),
+        .page_size = config->page_size,
+    };
 
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if ((rx_length == 4) && (rx_data[2] == 0u) && (rx_data[3] == flash_crc)) {
-            result = ESP_OK;
-        } else {
-            ESP_LOGE(TAG, "incorrect flash cs programming response");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not*/
-            ESP_LOGE(TAG, "no flash cs programming response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
-    }
-
-    free(rx_data);
-
-    return result;
+    return ppmsession_doFlashCsProgrammingPages(config,
+                                                page_count_for(config, words_length),
+                                                flash_crc,
+                                                buffer_page_source,
+                                                &buffer);
 }
 
-esp_err_t ppmsession_doFlashCrc(const ppm_session_config_t * config, size_t length, uint32_t * crc) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t * rx_data = NULL;
-    uint16_t words_length = ceil((double)length / 2);
-
-    ESP_LOGD(TAG, "do ppm flash crc session");
-
-    size_t rx_length = handle_session(config, 0x0u, 0x0u, NULL, words_length, &rx_data);
+esp_err_t ppmsession_doFlashCsProgrammingPages(const ppm_session_config_t * config,
+                                               uint16_t page_count,
+                                               uint16_t flash_crc,
+                                               ppm_page_source_t source,
+                                               void * source_ctx) {
+    ppm_session_desc_t desc = {
+        .name = "flash cs programming",
+        .offset = 0u,
+        .checksum = flash_crc,
+        .page_count = page_count,
+        .source = source,
+        .source_ctx = source_ctx,
+        .validate = ack_echoes_fields,
+    };
+
+    return ppmsession_run(config, &desc);
+}
 
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if (rx_length == 4) {
-            if (crc != NULL) {
-                *crc = ((uint32_t)(rx_data[2] & 0xFFu) << 16) | (uint32_t)(rx_data[3]);
-                result = ESP_OK;
-            } else {
-                ESP_LOGE(TAG, "invalid crc pointer received");
-            }
-        } else {
-            ESP_LOGE(TAG, "incorrect flash crc response length");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not */
-            ESP_LOGE(TAG, "no flash crc session response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
+esp_err_t ppmsession_doRamProgramming(const ppm_session_config_t * config,
+                                      uint16_t mem_offset,
+                                      const uint8_t * data_bytes,
+                                      size_t data_length) {
+    if ((data_bytes == NULL) || (config->page_size == 0u) ||
+        ((data_length % (config->page_size * sizeof(uint16_t))) != 0u)) {
+        return ESP_ERR_INVALID_SIZE;
     }
 
-    free(rx_data);
+    ppm_buffer_source_t buffer = {
+        .page_data = (const uint16_t *)(&data_bytes[0]),
+        .page_size = config->page_size,
+    };
+    ppm_session_desc_t desc = {
+        .name = "ram programming",
+        .offset = mem_offset / 2u / config->page_size,
+        .checksum = crc_calc16bitCrc(data_bytes, data_length, 0x1D0Fu),
+        .page_count = page_count_for(config, data_length / 2u),
+        .source = buffer_page_source,
+        .source_ctx = &buffer,
+        .validate = ack_echoes_fields,
+    };
+
+    return ppmsession_run(config, &desc);
+}
 
-    return result;
+esp_err_t ppmsession_doFlashCrc(const ppm_session_config_t * config, size_t length, uint32_t * crc) {
+    ppm_session_desc_t desc = {
+        .name = "flash crc",
+        .page_count = page_count_for(config, ceil((double)length / 2)),
+        .extract = extract_flash_crc,
+        .result = crc,
+    };
+
+    return ppmsession_run(config, &desc);
 }
 
 esp_err_t ppmsession_doEepromCrc(const ppm_session_config_t * config,
                                  uint16_t offset,
                                  size_t length,
                                  uint16_t * crc) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t words_length = ceil((double)length / 2);
-    uint16_t page_offset = ceil((double)offset / 2 / config->page_size);
-
-    ESP_LOGD(TAG, "do ppm eeprom crc session");
-
-    uint16_t * rx_data = NULL;
-    size_t rx_length = handle_session(config, page_offset, 0x0u, NULL, words_length, &rx_data);
-
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if (rx_length == 4) {
-            if (crc != NULL) {
-                *crc = rx_data[3];
-                result = ESP_OK;
-            } else {
-                ESP_LOGE(TAG, "invalid crc pointer received");
-            }
-        } else {
-            ESP_LOGE(TAG, "incorrect eeprom crc response length");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not */
-            ESP_LOGE(TAG, "no eeprom crc session response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
-    }
-
-    free(rx_data);
-
-    return result;
+    ppm_session_desc_t desc = {
+        .name = "eeprom crc",
+        .offset = ceil((double)offset / 2 / config->page_size),
+        .page_count = page_count_for(config, ceil((double)length / 2)),
+        .extract = extract_word,
+        .result = crc,
+    };
+
+    return ppmsession_run(config, &desc);
 }
 
 esp_err_t ppmsession_doFlashCsCrc(const ppm_session_config_t * config, size_t length, uint16_t * crc) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t words_length = ceil((double)length / 2);
-
-    ESP_LOGD(TAG, "do ppm Flash CS crc session");
-
-    uint16_t * rx_data = NULL;
-    size_t rx_length = handle_session(config, 0x0u, 0x0u, NULL, words_length, &rx_data);
-
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if (rx_length == 4) {
-            if (crc != NULL) {
-                *crc = rx_data[3];
-                result = ESP_OK;
-            } else {
-                ESP_LOGE(TAG, "invalid crc pointer received");
-            }
-        } else {
-            ESP_LOGE(TAG, "incorrect Flash CS crc response length");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not */
-            ESP_LOGE(TAG, "no Flash CS crc session response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
-    }
-
-    free(rx_data);
-
-    return result;
+    ppm_session_desc_t desc = {
+        .name = "flash cs crc",
+        .page_count = page_count_for(config, ceil((double)length / 2)),
+        .extract = extract_word,
+        .result = crc,
+    };
+
+    return ppmsession_run(config, &desc);
 }
 
 esp_err_t ppmsession_doChipReset(const ppm_session_config_t * config, uint16_t * project_id) {
-    esp_err_t result = ESP_FAIL;
-    uint16_t * rx_data = NULL;
-
-    ESP_LOGD(TAG, "do chip reset session");
+    ppm_session_desc_t desc = {
+        .name = "chip reset",
+        .extract = (project_id != NULL) ? extract_word : NULL,
+        .result = project_id,
+    };
 
-    size_t rx_length = handle_session(config, 0x0u, 0x0u, NULL, 0u, &rx_data);
-
-    if (rx_data != NULL) {
-        /* lets check the ack content */
-        if (rx_length == 4) {
-            *project_id = rx_data[3];
-            result = ESP_OK;
-        } else {
-            ESP_LOGE(TAG, "incorrect chip reset session response length");
-        }
-    } else {
-        /* no ack was received */
-        if (config->request_ack == true) {
-            /* we should have gotten an ack... but we did not */
-            ESP_LOGE(TAG, "no chip reset session response received");
-        } else {
-            /* no response expected at all */
-            result = ESP_OK;
-        }
-    }
-
-    free(rx_data);
-
-    return result;
+    return ppmsession_run(config, &desc);
 }
-
@@ -0,0 +1,410 @@
+/**
+ * @file
+ * @brief PPM bus worker module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the PPM bus worker module.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "ppm_bootloader.h"
+#include "ppm_mem.h"
+
+#include "ppm_worker.h"
+
+static const char *TAG = "ppm_worker";
+
+/** worker queue item */
+typedef struct {
+    bool exit;                          /**< request the worker to stop */
+    ppm_job_t job;                      /**< job to execute */
+} ppm_worker_item_t;
+
+/** context of a caller waiting for its job to be executed */
+typedef struct {
+    TaskHandle_t task;                  /**< task waiting for the job result */
+    ppm_err_t result;                   /**< result of the job */
+} ppm_worker_waiter_t;
+
+static TaskHandle_t worker_task = NULL;
+static QueueHandle_t job_queue = NULL;
+/** task waiting in ppmworker_stop() for the worker to leave */
+static TaskHandle_t stopping_task = NULL;
+/** a stop was requested, no more jobs are accepted */
+static bool stopping = false;
+/** number of posts in progress, which may still add a job to the queue */
+static uint32_t posting = 0u;
+/** protects the stopping flag and the post counter */
+static portMUX_TYPE post_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+static StaticQueue_t job_queue_buffer;
+static StaticTask_t worker_task_buffer;
+static uint8_t * job_queue_storage = NULL;
+static StackType_t * worker_stack = NULL;
+#endif
+
+/** Worker task
+ *
+ * @param[in]  arg  not used.
+ */
+static void ppmworker_task(void *arg);
+
+/** Job done callback used by the blocking job wrappers
+ *
+ * @param[in]  result  result of the executed job.
+ * @param[in]  user_ctx  waiter context.
+ */
+static void ppmworker_wakeWaiter(ppm_err_t result, void *user_ctx);
+
+/** Post a job and block until it has been executed
+ *
+ * @param[in]  job  job to be executed (done callback will be overwritten).
+ * @returns  result of the job.
+ */
+static ppm_err_t ppmworker_postAndWait(ppm_job_t * job);
+
+/** Release the memory used for the job queue and the worker stack */
+static void ppmworker_releaseMem(void);
+
+/** Complete the jobs left in the queue after the worker stopped with an error
+ *
+ * Waits for the posts in progress, so the queue can be deleted afterwards.
+ */
+static void ppmworker_drainQueue(void);
+
+
+static void ppmworker_task(void *arg) {
+    (void)arg;
+    ppm_worker_item_t item;
+
+    while (true) {
+        if (xQueueReceive(job_queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (item.exit) {
+            break;
+        }
+
+        ppm_err_t result = PPM_FAIL_INTERNAL;
+        switch (item.job.type) {
+            case PPM_JOB_READ_CHIP_INFO:
+                result = ppmbtl_readChipInfo(item.job.manpow, item.job.project_id);
+                break;
+            case PPM_JOB_DO_ACTION:
+                result = ppmbtl_doAction(item.job.manpow,
+                                         item.job.broadcast,
+                                         item.job.bitrate,
+                                         item.job.memory,
+                                         item.job.action,
+                                         item.job.ihex);
+                break;
+            case PPM_JOB_CALL:
+                if (item.job.func != NULL) {
+                    result = item.job.func(item.job.arg);
+                }
+                break;
+            default:
+                ESP_LOGE(TAG, "unknown job type %d", (int)item.job.type);
+                break;
+        }
+
+        if (item.job.done_cb != NULL) {
+            item.job.done_cb(result, item.job.user_ctx);
+        }
+    }
+
+    /* the stopping task deletes the worker, its stack may be released only after that */
+    (void)xTaskNotifyGive(stopping_task);
+    vTaskSuspend(NULL);
+}
+
+static void ppmworker_releaseMem(void) {
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    ppmmem_free(worker_stack);
+    worker_stack = NULL;
+    ppmmem_free(job_queue_storage);
+    job_queue_storage = NULL;
+#endif
+}
+
+static void ppmworker_drainQueue(void) {
+    ppm_worker_item_t item;
+    bool busy;
+
+    do {
+        /* a post in progress may still add its job, sample before draining */
+        portENTER_CRITICAL(&post_lock);
+        busy = (posting != 0u);
+        portEXIT_CRITICAL(&post_lock);
+
+        while (xQueueReceive(job_queue, &item, 0) == pdTRUE) {
+            if ((!item.exit) && (item.job.done_cb != NULL)) {
+                /* the worker stopped, wake the waiter with an error */
+                item.job.done_cb(PPM_FAIL_INTERNAL, item.job.user_ctx);
+            }
+        }
+
+        if (busy) {
+            vTaskDelay(1);
+        }
+    } while (busy);
+}
+
+static void ppmworker_wakeWaiter(ppm_err_t result, void *user_ctx) {
+    ppm_worker_waiter_t * waiter = (ppm_worker_waiter_t *)user_ctx;
+    waiter->result = result;
+    (void)xTaskNotifyGive(waiter->task);
+}
+
+static ppm_err_t ppmworker_postAndWait(ppm_job_t * job) {
+    ppm_worker_waiter_t waiter = {
+        .task = xTaskGetCurrentTaskHandle(),
+        .result = PPM_FAIL_INTERNAL,
+    };
+
+    if (waiter.task == worker_task) {
+        /* posting from the worker itself would dead lock */
+        ESP_LOGE(TAG, "blocking job posted from worker task");
+        return PPM_FAIL_INTERNAL;
+    }
+
+    job->done_cb = ppmworker_wakeWaiter;
+    job->user_ctx = &waiter;
+
+    if (ppmworker_post(job, portMAX_DELAY) != ESP_OK) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return waiter.result;
+}
+
+esp_err_t ppmworker_start(const ppm_worker_config_t * config) {
+    if ((config == NULL) || (config->queue_length == 0u) || (config->stack_size == 0u)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (worker_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stopping = false;
+
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    job_queue_storage = ppmmem_malloc(config->queue_length * sizeof(ppm_worker_item_t));
+    worker_stack = ppmmem_malloc(config->stack_size);
+    if ((job_queue_storage != NULL) && (worker_stack != NULL)) {
+        job_queue = xQueueCreateStatic(config->queue_length,
+                                       sizeof(ppm_worker_item_t),
+                                       job_queue_storage,
+                                       &job_queue_buffer);
+    }
+#else
+    job_queue = xQueueCreate(config->queue_length, sizeof(ppm_worker_item_t));
+#endif
+    if (job_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create job queue");
+        ppmworker_releaseMem();
+        return ESP_ERR_NO_MEM;
+    }
+
+    BaseType_t core_id = tskNO_AFFINITY;
+    if (config->core_id >= 0) {
+        core_id = (BaseType_t)config->core_id;
+    }
+
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    worker_task = xTaskCreateStaticPinnedToCore(ppmworker_task,
+                                                "ppm_worker",
+                                                config->stack_size,
+                                                NULL,
+                                                config->priority,
+                                                worker_stack,
+                                                &worker_task_buffer,
+                                                core_id);
+#else
+    if (xTaskCreatePinnedToCore(ppmworker_task,
+                                "ppm_worker",
+                                config->stack_size,
+                                NULL,
+                                config->priority,
+                                &worker_task,
+                                core_id) != pdPASS) {
+        worker_task = NULL;
+    }
+#endif
+    if (worker_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create worker task");
+        vQueueDelete(job_queue);
+        job_queue = NULL;
+        ppmworker_releaseMem();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ppmworker_stop(void) {
+    if ((worker_task == NULL) || (job_queue == NULL)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xTaskGetCurrentTaskHandle() == worker_task) {
+        /* the worker can not wait for itself to leave */
+        ESP_LOGE(TAG, "worker stopped from worker task");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&post_lock);
+    bool stop_requested = stopping;
+    stopping = true;
+    portEXIT_CRITICAL(&post_lock);
+    if (stop_requested) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ppm_worker_item_t item;
+    memset(&item, 0, sizeof(item));
+    item.exit = true;
+    stopping_task = xTaskGetCurrentTaskHandle();
+    if (xQueueSend(job_queue, &item, portMAX_DELAY) != pdTRUE) {
+        stopping_task = NULL;
+        portENTER_CRITICAL(&post_lock);
+        stopping = false;
+        portEXIT_CRITICAL(&post_lock);
+        return ESP_FAIL;
+    }
+
+    /* wait for the worker to execute the jobs ahead of the stop request and leave, then delete it
+     * before its stack is freed */
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (eTaskGetState(worker_task) != eSuspended) {
+        /* the worker may still be running on the other core */
+        vTaskDelay(1);
+    }
+    vTaskDelete(worker_task);
+    worker_task = NULL;
+    stopping_task = NULL;
+
+    /* jobs posted behind the stop request are never executed */
+    ppmworker_drainQueue();
+    vQueueDelete(job_queue);
+    job_queue = NULL;
+    ppmworker_releaseMem();
+
+    return ESP_OK;
+}
+
+size_t ppmworker_getArenaSize(const ppm_worker_config_t * config) {
+    if (config == NULL) {
+        return 0u;
+    }
+
+    return ppmmem_blockSize(config->queue_length * sizeof(ppm_worker_item_t)) +
+           ppmmem_blockSize(config->stack_size);
+}
+
+esp_err_t ppmworker_post(const ppm_job_t * job, uint32_t timeout) {
+    if (job == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&post_lock);
+    bool accepted = (!stopping) && (job_queue != NULL);
+    if (accepted) {
+        posting++;
+    }
+    portEXIT_CRITICAL(&post_lock);
+    if (!accepted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ppm_worker_item_t item = {
+        .exit = false,
+        .job = *job,
+    };
+
+    TickType_t ticks = portMAX_DELAY;
+    if (timeout != portMAX_DELAY) {
+        ticks = (timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    }
+
+    BaseType_t queued = xQueueSend(job_queue, &item, ticks);
+
+    portENTER_CRITICAL(&post_lock);
+    posting--;
+    portEXIT_CRITICAL(&post_lock);
+
+    return (queued == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+ppm_err_t ppmworker_readChipInfo(bool manpow, uint16_t * project_id) {
+    ppm_job_t job = {
+        .type = PPM_JOB_READ_CHIP_INFO,
+        .manpow = manpow,
+        .project_id = project_id,
+    };
+
+    return ppmworker_postAndWait(&job);
+}
+
+ppm_err_t ppmworker_doAction(bool manpow,
+                             bool broadcast,
+                             uint32_t bitrate,
+                             ppm_memory_t memory,
+                             ppm_action_t action,
+                             ihexContainer_t * ihex) {
+    ppm_job_t job = {
+        .type = PPM_JOB_DO_ACTION,
+        .manpow = manpow,
+        .broadcast = broadcast,
+        .bitrate = bitrate,
+        .memory = memory,
+        .action = action,
+        .ihex = ihex,
+    };
+
+    return ppmworker_postAndWait(&job);
+}
+
+ppm_err_t ppmworker_call(ppm_job_func_t func, void * arg) {
+    if (func == NULL) {
+        return PPM_FAIL_INTERNAL;
+    }
+
+    ppm_job_t job = {
+        .type = PPM_JOB_CALL,
+        .func = func,
+        .arg = arg,
+    };
+
+    return ppmworker_postAndWait(&job);
+}
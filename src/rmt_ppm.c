@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "driver/rmt_tx.h"
 #include "driver/rmt_rx.h"
@@ -37,8 +38,14 @@
 #include "freertos/queue.h"
 #include "freertos/task.h"
 
+#include "soc/soc_caps.h"
+
+#include "rmt_ppm_capture.h"
 #include "rmt_ppm_encoder.h"
-#include "ppm_bootloader.h"
+#include "rmt_ppm_trace.h"
+#include "ppm_event.h"
+#include "ppm_mem.h"
+#include "ppm_power.h"
 
 #include "rmt_ppm.h"
 
@@ -46,6 +53,69 @@ static const char *TAG = "rmt_ppm";
 
 #define SYMBOLS_PER_BYTE 4
 
+/** Symbols of a frame on top of its data symbols (frame pulse and end marker, with margin) */
+#define FRAME_OVERHEAD_SYMBOLS 8u
+
+/** Granularity of the channel symbol memory */
+#define CHANNEL_MEM_STEP_SYMBOLS 64u
+
+/** Largest TX channel symbol memory, longer frames are transmitted with memory refills */
+#define TX_MAX_MEM_SYMBOLS 1536u
+
+/** Largest RX channel symbol memory */
+#define RX_MAX_MEM_SYMBOLS 256u
+
+/** Number of received frames which can be pending */
+#define RX_QUEUE_LENGTH 4
+
+/** Number of fractional bits of the rescaled symbol times */
+#define RX_FRAC_BITS 4u
+
+/** Nominal 0b00 symbol time [1/4us, fixed point] */
+#define RX_SYMBOL_BASE ((uint32_t)(4.5 * 4) << RX_FRAC_BITS)
+
+/** Nominal distance between 2 symbol values [1/4us, fixed point] */
+#define RX_BIT_DISTANCE ((uint32_t)PPM_BIT_DISTANCE << RX_FRAC_BITS)
+
+/** Shortest accepted rescaled symbol time [1/4us, fixed point] */
+#define RX_SYMBOL_MIN ((uint32_t)((4.5 - 0.75) * 4) << RX_FRAC_BITS)
+
+/** Longest accepted rescaled symbol time [1/4us, fixed point] */
+#define RX_SYMBOL_MAX ((uint32_t)((22.5 + 0.75) * 4) << RX_FRAC_BITS)
+
+/** Boundary between session and page frame pulses [1/4us] */
+#define RX_FRAME_PULSE_SPLIT ((uint32_t)((PPM_SESSION_PULSE_TIME + PPM_PAGE_PULSE_TIME) / 2))
+
+/** Shortest accepted session frame pulse (slave timebase 8% fast) [1/4us] */
+#define RX_SESSION_PULSE_MIN ((uint32_t)(PPM_SESSION_PULSE_TIME * 0.92))
+
+/** Longest accepted page frame pulse (slave timebase 8% slow) [1/4us] */
+#define RX_PAGE_PULSE_MAX ((uint32_t)(PPM_PAGE_PULSE_TIME * 1.08))
+
+/** Number of transmissions which can be queued on the TX channel (frames and idle gaps) */
+#define TX_QUEUE_DEPTH 8u
+
+/** Number of frames which can be queued by rmt_ppm_send_frame_async() */
+#define TX_ASYNC_FRAMES (TX_QUEUE_DEPTH / 2u)
+
+/** Longest idle gap of a single idle symbol [ticks] */
+#define TX_IDLE_MAX_TICKS (2u * 32767u)
+
+/** Number of leading symbols searched for the frame type pulse */
+#define RX_RESYNC_SYMBOLS 4u
+
+/** Time after the end of a transmission in which its echo is expected on a shared pin [us] */
+#define RX_ECHO_WINDOW_US 1000
+
+/** Number of echoed bytes needed to recognize a frame echo (frames can be truncated on reception) */
+#define RX_ECHO_MIN_BYTES 8u
+
+/** Largest number of response symbols faults are injected in */
+#define FAULT_SYMBOLS_MAX 256u
+
+/** Shift of a corrupted symbol, two bit distances change its value [1/4us] */
+#define FAULT_CORRUPT_SHIFT ((uint32_t)(2 * PPM_BIT_DISTANCE))
+
 typedef union {
     uint8_t raw[1 + 256 + 2];
     struct __attribute__((packed)) {
@@ -60,11 +130,31 @@ typedef union {
             struct __attribute__((packed)) {
                 uint8_t data[256 + 2];
                 size_t data_len;
+                uint16_t repairs;
             } frame;
         };
     };
 } ppm_tx_item_t;
 
+/** Largest number of symbols of a transmission pre-encoded for a broadcast */
+#define BROADCAST_MAX_SYMBOLS ((sizeof(((ppm_tx_item_t *)0)->frame.data) * SYMBOLS_PER_BYTE) + 8u)
+
+/** additional bus driven by a broadcast */
+typedef struct {
+    rmt_channel_handle_t tx_chan;       /**< bus output channel */
+    rmt_channel_handle_t rx_chan;       /**< bus input channel (NULL when acknowledges are not read) */
+    rmt_encoder_handle_t encoder;       /**< copy encoder feeding the pre-encoded symbols */
+    rmt_symbol_word_t *rx_symbols[2];   /**< receive buffers, used alternately */
+    uint8_t rx_buffer;                  /**< receive buffer in use */
+    bool shared_pin;                    /**< output and input share the bus pin */
+    volatile bool echo_pending;         /**< echo of the last transmission expected on the shared pin */
+    QueueHandle_t rx_queue;             /**< received frames */
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    StaticQueue_t rx_queue_buffer;
+    uint8_t *rx_queue_storage;
+#endif
+} ppm_bus_t;
+
 /** EPM pattern total length [us] */
 const uint32_t epm_pattern_total = EPM_PATTERN_PULSE_TIME_1 + EPM_PATTERN_PULSE_TIME_2 +
                                    EPM_PATTERN_PULSE_TIME_3 + EPM_PATTERN_PULSE_TIME_4;
@@ -87,6 +177,22 @@ static uint32_t ppm_rx_max = 22500u;
 static size_t max_rx_data_len = 10;
 
 static SemaphoreHandle_t tx_done_sem = NULL;
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+static StaticSemaphore_t tx_done_sem_buffer;
+static StaticQueue_t rx_queue_buffer;
+static uint8_t *rx_queue_storage = NULL;
+#endif
+
+/** frames queued for transmission, kept until the encoder is done with them */
+static ppm_tx_item_t tx_slots[TX_ASYNC_FRAMES];
+/** idle gaps following the queued frames */
+static rmt_symbol_word_t tx_idle[TX_ASYNC_FRAMES];
+/** copy encoder transmitting the idle gaps */
+static rmt_encoder_handle_t idle_encoder = NULL;
+/** number of transmissions queued and not waited for yet */
+static size_t tx_pending = 0u;
+/** number of frames queued in the current batch */
+static size_t tx_frames = 0u;
 
 // Buffers for RMT symbols
 static uint8_t rmt_symbols_buffer = 0u;
@@ -94,12 +200,316 @@ static rmt_symbol_word_t *rx_symbols[] = {NULL, NULL};
 static size_t max_rx_symbols = 0;
 static QueueHandle_t rx_queue = NULL;
 
+/** own transmissions expected to echo on a shared TX/RX pin */
+typedef struct {
+    volatile bool pending;              /**< echo expected and not received yet */
+    volatile int64_t tx_done_time;      /**< end of the last queued transmission [us] (0 while transmitting) */
+    volatile size_t in_flight;          /**< transmissions queued and not completed yet (idle gaps included) */
+    volatile size_t echoes;             /**< queued frames whose echo was not received yet */
+    ppm_frame_type_t type;              /**< frame type of the first transmission */
+    size_t data_len;                    /**< number of transmitted data bytes */
+    uint8_t data[256 + 2];              /**< transmitted data bytes */
+} ppm_echo_t;
+
+static ppm_echo_t tx_echo;
+/** protects the echo counters, updated from the TX and RX done callbacks */
+static portMUX_TYPE echo_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** receive link statistics (written from the RX done ISR, discarded frames from the receiving task) */
+static volatile rmt_ppm_link_stats_t link_stats;
+
+/** tick resolution of the RMT channels */
+static uint32_t channel_resolution_hz = 4000000u;
+/** received symbol time units (1/4us at the nominal bitrate) per channel tick [16.16 fixed point] */
+static uint32_t rx_units_per_tick_q16 = 1u << 16;
+
+/** symbol memory of the TX channel, sized to the largest frame at init */
+static size_t tx_mem_symbols = TX_MAX_MEM_SYMBOLS;
+/** symbol memory of the RX channel, sized to the longest response at init */
+static size_t rx_mem_symbols = RX_MAX_MEM_SYMBOLS;
+
+/** additional buses of the broadcast (the primary bus is not part of the list) */
+static ppm_bus_t broadcast_buses[RMT_PPM_MAX_BUSES - 1u];
+/** configuration of the additional buses of the broadcast */
+static rmt_ppm_bus_config_t broadcast_config[RMT_PPM_MAX_BUSES - 1u];
+static size_t broadcast_count = 0u;
+/** sync manager starting the primary and additional bus channels together */
+static rmt_sync_manager_handle_t broadcast_sync = NULL;
+/** copy encoder of the primary bus while broadcasting */
+static rmt_encoder_handle_t broadcast_encoder = NULL;
+/** symbols of the current transmission, encoded once for all buses */
+static rmt_symbol_word_t *broadcast_symbols = NULL;
+/** counts the transmissions done on the additional buses */
+static SemaphoreHandle_t broadcast_done_sem = NULL;
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+static StaticSemaphore_t broadcast_done_sem_buffer;
+#endif
+
+/** applied response timeout relative to the requested timeout [%] */
+static uint16_t timeout_scale = 100u;
+
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+/** fault model applied to the responses (only applied when fault_active) */
+static rmt_ppm_fault_model_t fault_model;
+static volatile bool fault_active = false;
+/** fault generator states, one for the RX done ISR and one for the receiving task */
+static uint32_t fault_isr_random;
+static uint32_t fault_task_random;
+/** number of responses still to be lost on the stuck bus */
+static uint32_t fault_stuck_remaining;
+/** response symbols with injected faults */
+static rmt_symbol_word_t fault_symbols[FAULT_SYMBOLS_MAX];
+/** late response held back until its delivery time */
+static ppm_tx_item_t fault_held_item;
+static bool fault_item_held = false;
+static TickType_t fault_held_until;
+static volatile rmt_ppm_fault_stats_t fault_stats;
+#endif
 
 static esp_err_t rmt_ppm_reconfigure_tx(uint32_t resolution_hz);
 static esp_err_t rmt_ppm_reconfigure_rx(uint32_t resolution_hz);
 
-/** RMT PPM decoder */
-static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols, size_t symbol_count, ppm_tx_item_t *item);
+/** Get the channel symbol memory holding a frame completely.
+ *
+ * @param[in]  data_bytes   number of frame data bytes.
+ * @param[in]  max_symbols  largest symbol memory.
+ * @returns  number of symbols, a multiple of CHANNEL_MEM_STEP_SYMBOLS.
+ */
+static size_t ppm_channel_mem_symbols(size_t data_bytes, size_t max_symbols);
+
+/** Classify a frame type pulse
+ *
+ * @param[in]  pulse  measured pulse time [1/4us].
+ * @param[out]  type  frame type of the pulse.
+ * @param[out]  nominal_pulse  nominal pulse time of the frame type [1/4us].
+ * @return  true when the pulse is a valid frame type pulse.
+ */
+static bool ppm_classify_frame_pulse(uint32_t pulse, ppm_frame_type_t *type, uint32_t *nominal_pulse);
+
+/** Get the time of a received symbol in symbol time units
+ *
+ * @param[in]  symbol  received symbol.
+ * @return  symbol time [1/4us at the nominal bitrate].
+ */
+static uint32_t ppm_symbol_time(const rmt_symbol_word_t *symbol);
+
+/** RMT PPM decoder
+ *
+ * @param[in]  symbols  received symbols.
+ * @param[in]  symbol_count  number of received symbols.
+ * @param[out]  item  decoded frame.
+ * @param[in,out]  stats  receive statistics updated with the decoding errors and repairs.
+ * @return  ESP_OK when a frame was decoded.
+ */
+static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols,
+                                    size_t symbol_count,
+                                    ppm_tx_item_t *item,
+                                    volatile rmt_ppm_link_stats_t *stats);
+
+/** Wait until a deadline to receive a frame from the RX queue
+ *
+ * @param[out]  item  received frame.
+ * @param[in]  deadline  tick count to stop waiting at.
+ * @return  true when a frame was received.
+ */
+static bool ppm_receive_item(ppm_tx_item_t *item, TickType_t deadline);
+
+/** Copy the data words of a received frame
+ *
+ * @param[in]  item  received frame.
+ * @param[out]  data  buffer receiving the data words.
+ * @param[in]  max_length  size of the data buffer (in words).
+ * @return  number of data words (0 when the frame does not fit).
+ */
+static size_t ppm_copy_frame(const ppm_tx_item_t *item, uint16_t *data, size_t max_length);
+
+/** Register a transmission whose echo shall be suppressed on a shared TX/RX pin
+ *
+ * @param[in]  item  item about to be transmitted.
+ */
+static void ppm_expect_echo(const ppm_tx_item_t *item);
+
+/** Register a transmission in an echo state
+ *
+ * A frame queued behind frames whose echo is still expected joins them, its echo is matched against
+ * the frame slots.
+ *
+ * @param[in,out]  echo  echo state.
+ * @param[in]  item  item about to be transmitted.
+ * @param[in]  queued_behind  whether earlier transmissions of the batch were not waited for yet.
+ * @param[in]  shared_pin  whether the transmission echoes on the receive pin.
+ */
+static void ppm_echo_expect(ppm_echo_t *echo, const ppm_tx_item_t *item, bool queued_behind, bool shared_pin);
+
+/** Count a transmission queued to the TX channel
+ *
+ * @param[in,out]  echo  echo state.
+ */
+static void ppm_echo_tx_queued(ppm_echo_t *echo);
+
+/** Count a completed (or failed) transmission, the echo window starts with the last one
+ *
+ * @warning method is called in ISR context.
+ *
+ * @param[in,out]  echo  echo state.
+ * @param[in]  now  completion time [us].
+ */
+static void ppm_echo_tx_done(ppm_echo_t *echo, int64_t now);
+
+/** Count a received echo, no more echoes are expected after the one of the last queued frame
+ *
+ * @warning method is called in ISR context.
+ *
+ * @param[in,out]  echo  echo state.
+ */
+static void ppm_echo_received(ppm_echo_t *echo);
+
+/** Check whether a reception falls in the echo window of the queued transmissions
+ *
+ * @warning method is called in ISR context.
+ *
+ * @param[in,out]  echo  echo state.
+ * @param[in]  now  reception time [us].
+ * @return  true when an echo of the queued transmissions can be received.
+ */
+static bool ppm_echo_window_open(ppm_echo_t *echo, int64_t now);
+
+/** Check whether a received frame is the echo of the last transmission
+ *
+ * @warning method is called in ISR context.
+ *
+ * @param[in]  item  decoded frame.
+ * @return  true when the frame content matches the transmitted frame.
+ */
+static bool ppm_matches_echo(const ppm_tx_item_t *item);
+
+/** Decode a received symbol buffer and queue the frame.
+ *
+ * @param[in]  symbols  received symbols.
+ * @param[in]  symbol_count  number of received symbols.
+ * @param[in]  in_isr  whether called from ISR context (RX done callback).
+ * @return  whether a higher priority task was woken (value to be returned by the RX done callback).
+ */
+static bool ppm_process_symbols(const rmt_symbol_word_t *symbols, size_t symbol_count, bool in_isr);
+
+/** Complete a transmission for the golden trace, feeding the recorded responses when replaying. */
+static void ppm_trace_tx_done(void);
+
+/** Start a transmission on the primary bus, or on all buses while broadcasting
+ *
+ * @param[in]  raw  encoder input (frame type first).
+ * @param[in]  size  number of encoder input bytes following the frame type.
+ * @param[in]  config  transmit configuration.
+ * @return  error code representing the result of the action.
+ */
+static esp_err_t ppm_transmit(const uint8_t *raw, size_t size, const rmt_transmit_config_t *config);
+
+/** Wait until the transmission is done on all buses */
+static void ppm_wait_tx_done(void);
+
+/** Encode a transmission once and start it on all buses together
+ *
+ * @param[in]  raw  encoder input (frame type first).
+ * @param[in]  size  number of encoder input bytes following the frame type.
+ * @param[in]  config  transmit configuration.
+ * @return  error code representing the result of the action.
+ */
+static esp_err_t ppm_broadcast_transmit(const uint8_t *raw, size_t size, const rmt_transmit_config_t *config);
+
+/** Release the additional buses and the broadcast resources */
+static void ppm_broadcast_close(void);
+
+/** Create the channels and buffers of an additional bus
+ *
+ * @param[out]  bus  bus to open.
+ * @param[in]  config  bus configuration.
+ * @return  error code representing the result of the action.
+ */
+static esp_err_t ppm_bus_open(ppm_bus_t *bus, const rmt_ppm_bus_config_t *config);
+
+/** Release the channels and buffers of an additional bus
+ *
+ * @param[in,out]  bus  bus to close.
+ */
+static void ppm_bus_close(ppm_bus_t *bus);
+
+/** Start receiving on an additional bus
+ *
+ * @warning method is called in ISR context.
+ *
+ * @param[in,out]  bus  bus to receive on.
+ */
+static void ppm_bus_receive(ppm_bus_t *bus);
+
+/** Get the tick count of a response deadline
+ *
+ * @param[in]  bus_timeout  time to wait for a response on the bus (in ms).
+ * @return  tick count to stop waiting at.
+ */
+static TickType_t ppm_response_deadline(uint16_t bus_timeout);
+
+/** Get the number of ticks left until a deadline
+ *
+ * @param[in]  deadline  tick count to stop waiting at.
+ * @return  ticks left, 0 when the deadline has passed.
+ */
+static TickType_t ppm_ticks_until(TickType_t deadline);
+
+/** Draw the next number of a pseudo random generator (xorshift32)
+ *
+ * @param[in,out]  state  generator state (non-zero).
+ * @return  pseudo random number.
+ */
+static uint32_t ppm_random(uint32_t *state);
+
+/** Convert transmitted symbols into the symbols received for them on the bus
+ *
+ * A received symbol starts with the short pulse and ends with the time until the next pulse,
+ * the low time in front of the first pulse is part of the idle time.
+ *
+ * @param[in]  tx_symbols  transmitted symbols.
+ * @param[in]  symbol_count  number of symbols.
+ * @param[out]  rx_symbols  buffer receiving the received symbols (symbol_count entries).
+ */
+static void ppm_loopback_symbols(const rmt_symbol_word_t *tx_symbols, size_t symbol_count, rmt_symbol_word_t *rx_symbols);
+
+/** Check the echo suppression of a session frame and page 0 queued together on a shared pin
+ *
+ * @return  number of failed checks.
+ */
+static uint32_t ppm_selftest_echo(void);
+
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+
+/** Decide whether to inject a fault
+ *
+ * @param[in,out]  state  fault generator state.
+ * @param[in]  permille  probability of the fault [1/1000].
+ * @return  true when the fault shall be injected.
+ */
+static bool ppm_fault_hit(uint32_t *state, uint16_t permille);
+
+/** Inject symbol faults (jitter, corruption) in a received symbol buffer
+ *
+ * @param[in]  symbols  received symbols.
+ * @param[in,out]  symbol_count  number of symbols.
+ * @return  symbols to decode, either the received ones or a faulty copy.
+ */
+static const rmt_symbol_word_t *ppm_fault_symbols(const rmt_symbol_word_t *symbols, size_t *symbol_count);
+
+/** Decide whether a decoded response is lost (dropped, stuck bus)
+ *
+ * @return  true when the response shall be dropped.
+ */
+static bool ppm_fault_drop(void);
+
+/** Get the delivery delay of a received response (late response, slow erase)
+ *
+ * @param[in]  item  received response.
+ * @return  delivery delay [ms].
+ */
+static uint32_t ppm_fault_delay(const ppm_tx_item_t *item);
+#endif
 
 /** RMT TX done callback.
  *
@@ -113,6 +523,18 @@ static bool tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_dat
  */
 static bool rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_ctx);
 
+/** RMT TX done callback of an additional bus.
+ *
+ * @warning method is called in ISR context.
+ */
+static bool bus_tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx);
+
+/** RMT RX done callback of an additional bus.
+ *
+ * @warning method is called in ISR context.
+ */
+static bool bus_rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_ctx);
+
 
 static esp_err_t rmt_ppm_reconfigure_tx(uint32_t resolution_hz) {
     if (tx_chan) {
@@ -125,8 +547,8 @@ static esp_err_t rmt_ppm_reconfigure_tx(uint32_t resolution_hz) {
         .gpio_num = tx_gpio_num,
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .resolution_hz = resolution_hz,
-        .mem_block_symbols = 1536,
-        .trans_queue_depth = 1,
+        .mem_block_symbols = tx_mem_symbols,
+        .trans_queue_depth = TX_QUEUE_DEPTH,
         .flags.with_dma = true,
 #if (CONFIG_PPM_BOOTLOADER_TX_INVERT)
         .flags.invert_out = true,
@@ -165,7 +587,7 @@ static esp_err_t rmt_ppm_reconfigure_rx(uint32_t resolution_hz) {
         .gpio_num = rx_gpio_num,
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .resolution_hz = resolution_hz,
-        .mem_block_symbols = 256,
+        .mem_block_symbols = rx_mem_symbols,
         .flags.with_dma = true,
         .flags.invert_in = true,
     };
@@ -186,37 +608,124 @@ static esp_err_t rmt_ppm_reconfigure_rx(uint32_t resolution_hz) {
     return err;
 }
 
-static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols, size_t symbol_count, ppm_tx_item_t *item) {
+static size_t ppm_channel_mem_symbols(size_t data_bytes, size_t max_symbols) {
+    size_t symbols = (data_bytes * SYMBOLS_PER_BYTE) + FRAME_OVERHEAD_SYMBOLS;
+
+    /* DMA channels need an even number of symbols of at least the hardware block size */
+    symbols = ((symbols + CHANNEL_MEM_STEP_SYMBOLS - 1u) / CHANNEL_MEM_STEP_SYMBOLS) * CHANNEL_MEM_STEP_SYMBOLS;
+    if (symbols < SOC_RMT_MEM_WORDS_PER_CHANNEL) {
+        symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    }
+    if (symbols > max_symbols) {
+        symbols = max_symbols;
+    }
+
+    return symbols;
+}
+
+static bool ppm_classify_frame_pulse(uint32_t pulse, ppm_frame_type_t *type, uint32_t *nominal_pulse) {
+    /* the slave times its response with its own oscillator, so the frame type is taken from the
+     * nearest nominal frame pulse */
+    if ((pulse >= RX_SESSION_PULSE_MIN) && (pulse < RX_FRAME_PULSE_SPLIT)) {
+        *type = ftSession;
+        *nominal_pulse = (uint32_t)PPM_SESSION_PULSE_TIME;
+    } else if ((pulse >= RX_FRAME_PULSE_SPLIT) && (pulse <= RX_PAGE_PULSE_MAX)) {
+        *type = ftPage;
+        *nominal_pulse = (uint32_t)PPM_PAGE_PULSE_TIME;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static uint32_t ppm_symbol_time(const rmt_symbol_word_t *symbol) {
+    uint32_t ticks = (uint32_t)symbol->duration0 + (uint32_t)symbol->duration1;
+    return (uint32_t)((((uint64_t)ticks * rx_units_per_tick_q16) + (1u << 15)) >> 16);
+}
+
+static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols,
+                                    size_t symbol_count,
+                                    ppm_tx_item_t *item,
+                                    volatile rmt_ppm_link_stats_t *stats) {
     size_t byte_idx = 0;
     uint8_t current_byte = 0;
     int bits_filled = 0;
 
     /* TODO allow for re-entering this function for partial reception */
 
-    uint32_t frame_pulse = symbols[0].duration0 + symbols[0].duration1;
-    if ((frame_pulse > (PPM_SESSION_PULSE_TIME - (PPM_BIT_DISTANCE / 2))) &&
-        (frame_pulse < (PPM_SESSION_PULSE_TIME + (PPM_BIT_DISTANCE / 2)))) {
-        item->type = ftSession;
-    } else if ((frame_pulse > (PPM_PAGE_PULSE_TIME - (PPM_BIT_DISTANCE / 2))) &&
-               (frame_pulse < (PPM_PAGE_PULSE_TIME + (PPM_BIT_DISTANCE / 2)))) {
-        item->type = ftPage;
-    } else {
-        ESP_EARLY_LOGE(TAG, "Invalid frame pulse: %d us", (int)frame_pulse);
+    if (symbol_count == 0) {
+        return ESP_FAIL;
+    }
+
+    size_t first = 0;
+    uint32_t frame_pulse = ppm_symbol_time(&symbols[0]);
+    uint32_t nominal_pulse = 0;
+    item->frame.repairs = 0;
+#if CONFIG_PPM_BOOTLOADER_RX_ROBUST_DECODE
+    /* skip glitches in front of the frame type pulse */
+    while ((!ppm_classify_frame_pulse(frame_pulse, &item->type, &nominal_pulse)) &&
+           (first < (RX_RESYNC_SYMBOLS - 1u)) && (first < (symbol_count - 1))) {
+        first++;
+        frame_pulse = ppm_symbol_time(&symbols[first]);
+        item->frame.repairs++;
+    }
+#endif
+    if (!ppm_classify_frame_pulse(frame_pulse, &item->type, &nominal_pulse)) {
+        PPM_EVENT(PPM_EVENT_RX_PULSE_ERROR, frame_pulse, 0u);
+        stats->decode_errors++;
         return ESP_FAIL;
     }
 
-    for (size_t i = 1; i < symbol_count - 1; i++) {
-        uint32_t total_time = symbols[i].duration0 + symbols[i].duration1;
-        if ((total_time < (uint32_t)((4.5 - 0.75) * 4)) || (total_time > (uint32_t)((22.5 + 0.75) * 4))) {
-            ESP_EARLY_LOGE(TAG, "Invalid symbol timing: %d us", (int)total_time);
+    /* glitch time to be merged into the next symbol */
+    uint32_t pending_time = 0;
+    for (size_t i = first + 1; i < symbol_count - 1; i++) {
+#if CONFIG_PPM_BOOTLOADER_RX_ROBUST_DECODE
+        bool merged = (pending_time != 0u);
+#endif
+        uint32_t total_time = pending_time + ppm_symbol_time(&symbols[i]);
+        pending_time = 0;
+#if CONFIG_PPM_BOOTLOADER_RX_ROBUST_DECODE
+        ppm_frame_type_t resync_type;
+        uint32_t resync_nominal;
+        /* a frame type pulse can only start at a byte boundary and is never made of merged glitch
+         * time, classify it in the timebase of the current frame */
+        if ((!merged) && (bits_filled == 0u) &&
+            ppm_classify_frame_pulse((total_time * nominal_pulse) / frame_pulse, &resync_type, &resync_nominal)) {
+            /* frame type pulse within the frame, restart decoding from it */
+            item->type = resync_type;
+            nominal_pulse = resync_nominal;
+            frame_pulse = total_time;
+            byte_idx = 0;
+            current_byte = 0;
+            bits_filled = 0;
+            item->frame.repairs++;
+            stats->resyncs++;
+            continue;
+        }
+#endif
+
+        /* rescale the symbol to the slave timebase of this frame (fixed point) */
+        uint32_t scaled_time = ((total_time * nominal_pulse) << RX_FRAC_BITS) / frame_pulse;
+#if CONFIG_PPM_BOOTLOADER_RX_ROBUST_DECODE
+        if (scaled_time < RX_SYMBOL_MIN) {
+            /* glitch splitting a symbol, merge it with the next one */
+            pending_time = total_time;
+            item->frame.repairs++;
+            stats->glitches_merged++;
+            continue;
+        }
+#endif
+        if ((scaled_time < RX_SYMBOL_MIN) || (scaled_time > RX_SYMBOL_MAX)) {
+            PPM_EVENT(PPM_EVENT_RX_TIMING_ERROR, total_time, byte_idx);
+            stats->timing_errors++;
             break;
         }
 
-        uint8_t val = (uint8_t)((total_time - (uint32_t)(4.5 * 4) + (uint32_t)(PPM_BIT_DISTANCE / 2.0)) /
-                                (uint32_t)PPM_BIT_DISTANCE);
+        uint8_t val = (uint8_t)((scaled_time - RX_SYMBOL_BASE + (RX_BIT_DISTANCE / 2u)) / RX_BIT_DISTANCE);
 
         if (val > 3) {
-            ESP_EARLY_LOGE(TAG, "Invalid symbol timing: %d us => %d", (int)total_time, (int)val);
+            PPM_EVENT(PPM_EVENT_RX_TIMING_ERROR, total_time, byte_idx);
+            stats->timing_errors++;
             break;
         }
 
@@ -232,6 +741,7 @@ static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols, size_t sym
             bits_filled = 0;
         }
     }
+    stats->timebase_permille = (uint16_t)((frame_pulse * 1000u) / nominal_pulse);
 
     /* Handle partial last byte */
     if (bits_filled > 0 && byte_idx < sizeof(item->frame.data)) {
@@ -243,8 +753,114 @@ static esp_err_t ppm_decode_symbols(const rmt_symbol_word_t *symbols, size_t sym
     return ESP_OK;
 }
 
+static void ppm_expect_echo(const ppm_tx_item_t *item) {
+    if ((tx_gpio_num != rx_gpio_num) && (broadcast_count == 0u)) {
+        return;
+    }
+
+    /* the content is kept for the shared pins of the additional buses as well */
+    ppm_echo_expect(&tx_echo, item, tx_pending != 0u, tx_gpio_num == rx_gpio_num);
+}
+
+static void ppm_echo_expect(ppm_echo_t *echo, const ppm_tx_item_t *item, bool queued_behind, bool shared_pin) {
+    portENTER_CRITICAL_SAFE(&echo_lock);
+    bool joined = queued_behind && echo->pending && ((echo->type == ftSession) || (echo->type == ftPage));
+    if (joined) {
+        /* the window opens after this transmission */
+        echo->echoes++;
+        echo->tx_done_time = 0;
+    }
+    portEXIT_CRITICAL_SAFE(&echo_lock);
+    if (joined) {
+        return;
+    }
+
+    echo->pending = false;
+    echo->tx_done_time = 0;
+    echo->echoes = 1u;
+    echo->type = item->type;
+    echo->data_len = 0;
+    if ((item->type == ftSession) || (item->type == ftPage)) {
+        echo->data_len = item->frame.data_len;
+        memcpy(echo->data, item->frame.data, item->frame.data_len);
+    }
+    echo->pending = shared_pin;
+}
+
+static void ppm_echo_tx_queued(ppm_echo_t *echo) {
+    portENTER_CRITICAL_SAFE(&echo_lock);
+    echo->in_flight++;
+    portEXIT_CRITICAL_SAFE(&echo_lock);
+}
+
+static void ppm_echo_tx_done(ppm_echo_t *echo, int64_t now) {
+    portENTER_CRITICAL_SAFE(&echo_lock);
+    if (echo->in_flight != 0u) {
+        echo->in_flight--;
+    }
+    if (echo->pending && (echo->in_flight == 0u)) {
+        echo->tx_done_time = now;
+    }
+    portEXIT_CRITICAL_SAFE(&echo_lock);
+}
+
+static void ppm_echo_received(ppm_echo_t *echo) {
+    portENTER_CRITICAL_SAFE(&echo_lock);
+    if (echo->echoes != 0u) {
+        echo->echoes--;
+    }
+    if (echo->echoes == 0u) {
+        echo->pending = false;
+    }
+    portEXIT_CRITICAL_SAFE(&echo_lock);
+}
+
+static bool ppm_echo_window_open(ppm_echo_t *echo, int64_t now) {
+    if (!echo->pending) {
+        return false;
+    }
+
+    int64_t tx_done_time = echo->tx_done_time;
+    if ((tx_done_time != 0) && ((now - tx_done_time) > RX_ECHO_WINDOW_US)) {
+        echo->pending = false;
+        return false;
+    }
+
+    return true;
+}
+
+static bool ppm_matches_echo(const ppm_tx_item_t *item) {
+    /* long frames are truncated on reception, so only their start is compared, but at least a
+     * full session frame so a page acknowledge is never mistaken for the echo of its page */
+    size_t min_len = (tx_echo.data_len < RX_ECHO_MIN_BYTES) ? tx_echo.data_len : RX_ECHO_MIN_BYTES;
+
+    if ((item->type == tx_echo.type) &&
+        (item->frame.data_len >= min_len) &&
+        (item->frame.data_len <= tx_echo.data_len) &&
+        (memcmp(item->frame.data, tx_echo.data, item->frame.data_len) == 0)) {
+        return true;
+    }
+
+    /* queued frames transmitted back to back echo before the last one */
+    for (size_t i = 0; i < TX_ASYNC_FRAMES; i++) {
+        const ppm_tx_item_t *slot = &tx_slots[i];
+        min_len = (slot->frame.data_len < RX_ECHO_MIN_BYTES) ? slot->frame.data_len : RX_ECHO_MIN_BYTES;
+        if ((i < tx_frames) &&
+            (item->type == slot->type) &&
+            (item->frame.data_len >= min_len) &&
+            (item->frame.data_len <= slot->frame.data_len) &&
+            (memcmp(item->frame.data, slot->frame.data, item->frame.data_len) == 0)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static bool tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    /* runs for every queued transmission, idle gaps included */
+    ppm_echo_tx_done(&tx_echo, esp_timer_get_time());
     xSemaphoreGiveFromISR(tx_done_sem, &xHigherPriorityTaskWoken);
 
     rmt_receive_config_t rx_cfg = {
@@ -254,12 +870,17 @@ static bool tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_dat
             .en_partial_rx = false,
         },
     };
-    rmt_symbols_buffer ^= 1;
+    /* every queued transmission (idle symbols included) ends here while the receiver may still be
+     * armed, only switch to the other buffer when it is really taken, else the buffer being decoded
+     * would be re-armed */
+    uint8_t next_buffer = rmt_symbols_buffer ^ 1u;
     esp_err_t err = rmt_receive(rx_chan,
-                                rx_symbols[rmt_symbols_buffer],
+                                rx_symbols[next_buffer],
                                 max_rx_symbols * sizeof(rmt_symbol_word_t),
                                 &rx_cfg);
-    if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) {
+    if (err == ESP_OK) {
+        rmt_symbols_buffer = next_buffer;
+    } else if (err != ESP_ERR_INVALID_STATE) {
         /* this function is run in ISR context so no happy flow logging! */
         ESP_EARLY_LOGE(TAG, "RX start failed in TX done cb: %d", err);
     }
@@ -281,12 +902,15 @@ static bool rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_dat
 #endif
             },
         };
-        rmt_symbols_buffer ^= 1;
+        /* as in tx_done_cb(), only switch buffers when the receiver was armed on the other one */
+        uint8_t next_buffer = rmt_symbols_buffer ^ 1u;
         esp_err_t err = rmt_receive(rx_chan,
-                                    rx_symbols[rmt_symbols_buffer],
+                                    rx_symbols[next_buffer],
                                     max_rx_symbols * sizeof(rmt_symbol_word_t),
                                     &rx_cfg);
-        if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) {
+        if (err == ESP_OK) {
+            rmt_symbols_buffer = next_buffer;
+        } else if (err != ESP_ERR_INVALID_STATE) {
             /* this function is run in ISR context so no happy flow logging! */
             ESP_EARLY_LOGE(TAG, "RX start failed in RX done cb: %d", err);
         }
@@ -299,71 +923,426 @@ static bool rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_dat
         num_symbols = max_rx_symbols;
     }
 
-    ppm_tx_item_t item;
-    if (ppm_decode_symbols(edata->received_symbols, num_symbols, &item) == ESP_OK) {
-        if (xQueueSend(rx_queue, &item, 0) != pdTRUE) {
-            ESP_EARLY_LOGE(TAG, "RX queue full");
-            return ESP_ERR_NO_MEM;
-        }
+    rmt_ppm_capture_rx(edata->received_symbols, num_symbols, ppm_rx_max);
+    if (rmt_ppm_trace_rx(edata->received_symbols, num_symbols)) {
+        /* responses are taken from the trace being replayed */
+        return false;
     }
 
-    return false; // no context switch needed
+    return ppm_process_symbols(edata->received_symbols, num_symbols, true);
 }
 
-esp_err_t rmt_ppm_init(const rmt_ppm_config_t *cfg) {
-    if ((!cfg) || (cfg->tx_gpio_num == GPIO_NUM_MAX) || (cfg->rx_gpio_num == GPIO_NUM_MAX)) {
-        return ESP_ERR_INVALID_ARG;
+static bool ppm_process_symbols(const rmt_symbol_word_t *symbols, size_t symbol_count, bool in_isr) {
+    bool echo_window = ppm_echo_window_open(&tx_echo, esp_timer_get_time());
+    if (echo_window && (tx_echo.type != ftSession) && (tx_echo.type != ftPage)) {
+        /* echo of the enter ppm pattern or calibration frame on a shared pin */
+        link_stats.echoes_suppressed++;
+        return false;
     }
 
-    ESP_LOGI(TAG, "Init PPM component on GPIO %d %d", cfg->tx_gpio_num, cfg->rx_gpio_num);
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+    if (fault_active && !echo_window) {
+        symbols = ppm_fault_symbols(symbols, &symbol_count);
+    }
+#endif
 
-    tx_gpio_num = cfg->tx_gpio_num;
-    rx_gpio_num = cfg->rx_gpio_num;
+    ppm_tx_item_t item;
+    if (ppm_decode_symbols(symbols, symbol_count, &item, &link_stats) == ESP_OK) {
+        if (echo_window && ppm_matches_echo(&item)) {
+            /* own frame seen back on a shared pin */
+            ppm_echo_received(&tx_echo);
+            PPM_EVENT(PPM_EVENT_RX_ECHO, item.type, 0u);
+            link_stats.echoes_suppressed++;
+            return false;
+        }
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+        if (fault_active && ppm_fault_drop()) {
+            return false;
+        }
+#endif
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        BaseType_t queued;
+        if (in_isr) {
+            queued = xQueueSendFromISR(rx_queue, &item, &xHigherPriorityTaskWoken);
+        } else {
+            queued = xQueueSend(rx_queue, &item, 0);
+        }
+        if (queued != pdTRUE) {
+            PPM_EVENT(PPM_EVENT_RX_OVERFLOW, item.type, item.frame.data_len);
+            link_stats.rx_overflows++;
+            return false;
+        }
+        link_stats.frames_received++;
+        PPM_EVENT(PPM_EVENT_RX_FRAME, item.type | (item.frame.repairs << 8), item.frame.data_len);
+        return xHigherPriorityTaskWoken == pdTRUE;
+    }
 
-    ESP_ERROR_CHECK(rmt_ppm_reconfigure_tx(ppm_resolution_hz));
-    ESP_ERROR_CHECK(rmt_ppm_reconfigure_rx(ppm_resolution_hz));
+    return false; // no context switch needed
+}
 
-    max_rx_symbols = max_rx_data_len * SYMBOLS_PER_BYTE;
-    rmt_symbols_buffer = 0;
-    rx_symbols[0] = calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
-    rx_symbols[1] = calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
-    if (!rx_symbols[0] || !rx_symbols[1]) {
-        free(rx_symbols[0]);
-        free(rx_symbols[1]);
-        ESP_LOGE(TAG, "Failed to allocate symbol buffers");
-        return ESP_ERR_NO_MEM;
-    }
+static void ppm_trace_tx_done(void) {
+    rmt_ppm_trace_end_tx();
 
-    tx_done_sem = xSemaphoreCreateBinary();
-    if (!tx_done_sem) {
-        ESP_LOGE(TAG, "Failed to create TX done semaphore");
-        return ESP_ERR_NO_MEM;
+    size_t symbol_count;
+    const rmt_symbol_word_t *symbols;
+    while ((symbols = rmt_ppm_trace_next_rx(&symbol_count)) != NULL) {
+        (void)ppm_process_symbols(symbols, symbol_count, false);
     }
+}
 
-    rmt_ppm_encoder_config_t rmt_ppm_enc_cfg = {};
-    ESP_ERROR_CHECK(rmt_ppm_encoder_new(&rmt_ppm_enc_cfg, &ppm_encoder));
+static esp_err_t ppm_transmit(const uint8_t *raw, size_t size, const rmt_transmit_config_t *config) {
+    esp_err_t err;
+    ppm_echo_tx_queued(&tx_echo);
+    if (broadcast_count != 0u) {
+        err = ppm_broadcast_transmit(raw, size, config);
+    } else {
+        err = rmt_transmit(tx_chan, ppm_encoder, raw, size, config);
+    }
+    if (err == ESP_OK) {
+        tx_pending++;
+    } else {
+        ppm_echo_tx_done(&tx_echo, esp_timer_get_time());
+    }
+    return err;
+}
 
-    rx_queue = xQueueCreate(4, sizeof(ppm_tx_item_t));
-    if (!rx_queue) {
-        ESP_LOGE(TAG, "Failed to create RX queue");
-        return ESP_ERR_NO_MEM;
+static void ppm_wait_tx_done(void) {
+    if (tx_pending == 0u) {
+        return;
     }
 
-    return ESP_OK;
+    /* Wait for TX done via callback semaphore, once per queued transmission */
+    for (; tx_pending > 0u; tx_pending--) {
+        if (xSemaphoreTake(tx_done_sem, portMAX_DELAY) != pdTRUE) {
+            ESP_LOGE(TAG, "TX done wait failed");
+        }
+        for (size_t i = 0; i < broadcast_count; i++) {
+            if (xSemaphoreTake(broadcast_done_sem, portMAX_DELAY) != pdTRUE) {
+                ESP_LOGE(TAG, "TX done wait failed on bus %u", (unsigned)(i + 1u));
+            }
+        }
+    }
+    ppm_trace_tx_done();
 }
 
-esp_err_t rmt_ppm_deinit(void) {
-    if (tx_done_sem) {
-        vSemaphoreDelete(tx_done_sem);
-        tx_done_sem = NULL;
+static esp_err_t ppm_broadcast_transmit(const uint8_t *raw, size_t size, const rmt_transmit_config_t *config) {
+    rmt_ppm_encode_state_t state = {0};
+    bool complete = false;
+    size_t symbol_count = rmt_ppm_encode_symbols(&state, raw, size, broadcast_symbols, BROADCAST_MAX_SYMBOLS, &complete);
+    if (!complete) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    rmt_ppm_capture_tx(broadcast_symbols, symbol_count, true);
+    rmt_ppm_trace_tx(broadcast_symbols, symbol_count, true);
+
+    esp_err_t err = rmt_sync_reset(broadcast_sync);
+    for (size_t i = 0; (err == ESP_OK) && (i < broadcast_count); i++) {
+        ppm_bus_t *bus = &broadcast_buses[i];
+        if (bus->rx_chan != NULL) {
+            (void)rmt_disable(bus->rx_chan);
+            err = rmt_enable(bus->rx_chan);
+        }
+        bus->echo_pending = bus->shared_pin;
+        if (err == ESP_OK) {
+            err = rmt_transmit(bus->tx_chan,
+                               bus->encoder,
+                               broadcast_symbols,
+                               symbol_count * sizeof(rmt_symbol_word_t),
+                               config);
+        }
     }
 
-    rmt_ppm_encoder_delete(ppm_encoder);
-    ppm_encoder = NULL;
-
-    free(rx_symbols[0]);
+    /* the sync manager starts all channels once the primary one is queued as well */
+    if (err == ESP_OK) {
+        err = rmt_transmit(tx_chan, broadcast_encoder, broadcast_symbols, symbol_count * sizeof(rmt_symbol_word_t), config);
+    }
+
+    return err;
+}
+
+static esp_err_t ppm_bus_open(ppm_bus_t *bus, const rmt_ppm_bus_config_t *config) {
+    memset(bus, 0, sizeof(*bus));
+    bus->shared_pin = (config->tx_gpio_num == config->rx_gpio_num);
+
+    /* the DMA channel is kept for the primary bus, the copy encoder refills the channel memory */
+    rmt_tx_channel_config_t tx_cfg = {
+        .gpio_num = config->tx_gpio_num,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = channel_resolution_hz,
+        .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+        .trans_queue_depth = 1,
+#if (CONFIG_PPM_BOOTLOADER_TX_INVERT)
+        .flags.invert_out = true,
+#endif
+        .flags.io_od_mode = bus->shared_pin,
+    };
+    esp_err_t err = rmt_new_tx_channel(&tx_cfg, &bus->tx_chan);
+
+    if (err == ESP_OK) {
+        rmt_tx_event_callbacks_t tx_cbs = {
+            .on_trans_done = bus_tx_done_cb,
+        };
+        err = rmt_tx_register_event_callbacks(bus->tx_chan, &tx_cbs, bus);
+    }
+    if (err == ESP_OK) {
+        err = rmt_enable(bus->tx_chan);
+    }
+    if (err == ESP_OK) {
+        rmt_copy_encoder_config_t copy_cfg = {};
+        err = rmt_new_copy_encoder(&copy_cfg, &bus->encoder);
+    }
+    if ((err != ESP_OK) || (config->rx_gpio_num == GPIO_NUM_NC)) {
+        return err;
+    }
+
+    rmt_rx_channel_config_t rx_cfg = {
+        .gpio_num = config->rx_gpio_num,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = channel_resolution_hz,
+        .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+        .flags.invert_in = true,
+    };
+    err = rmt_new_rx_channel(&rx_cfg, &bus->rx_chan);
+    if (err == ESP_OK) {
+        rmt_rx_event_callbacks_t rx_cbs = {
+            .on_recv_done = bus_rx_done_cb,
+        };
+        err = rmt_rx_register_event_callbacks(bus->rx_chan, &rx_cbs, bus);
+    }
+    if (err == ESP_OK) {
+        err = rmt_enable(bus->rx_chan);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    bus->rx_symbols[0] = ppmmem_calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
+    bus->rx_symbols[1] = ppmmem_calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    bus->rx_queue_storage = ppmmem_malloc(RX_QUEUE_LENGTH * sizeof(ppm_tx_item_t));
+    if (bus->rx_queue_storage != NULL) {
+        bus->rx_queue = xQueueCreateStatic(RX_QUEUE_LENGTH, sizeof(ppm_tx_item_t), bus->rx_queue_storage, &bus->rx_queue_buffer);
+    }
+#else
+    bus->rx_queue = xQueueCreate(RX_QUEUE_LENGTH, sizeof(ppm_tx_item_t));
+#endif
+    if (!bus->rx_symbols[0] || !bus->rx_symbols[1] || !bus->rx_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+static void ppm_bus_close(ppm_bus_t *bus) {
+    if (bus->tx_chan) {
+        (void)rmt_disable(bus->tx_chan);
+        (void)rmt_del_channel(bus->tx_chan);
+    }
+    if (bus->rx_chan) {
+        (void)rmt_disable(bus->rx_chan);
+        (void)rmt_del_channel(bus->rx_chan);
+    }
+    if (bus->encoder) {
+        (void)rmt_del_encoder(bus->encoder);
+    }
+    if (bus->rx_queue) {
+        vQueueDelete(bus->rx_queue);
+    }
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    ppmmem_free(bus->rx_queue_storage);
+#endif
+    ppmmem_free(bus->rx_symbols[1]);
+    ppmmem_free(bus->rx_symbols[0]);
+    memset(bus, 0, sizeof(*bus));
+}
+
+static void ppm_broadcast_close(void) {
+    if (broadcast_sync) {
+        (void)rmt_del_sync_manager(broadcast_sync);
+        broadcast_sync = NULL;
+    }
+
+    for (size_t i = 0; i < broadcast_count; i++) {
+        ppm_bus_close(&broadcast_buses[i]);
+    }
+    broadcast_count = 0u;
+
+    if (broadcast_encoder) {
+        (void)rmt_del_encoder(broadcast_encoder);
+        broadcast_encoder = NULL;
+    }
+    if (broadcast_done_sem) {
+        vSemaphoreDelete(broadcast_done_sem);
+        broadcast_done_sem = NULL;
+    }
+    ppmmem_free(broadcast_symbols);
+    broadcast_symbols = NULL;
+}
+
+static void ppm_bus_receive(ppm_bus_t *bus) {
+    rmt_receive_config_t rx_cfg = {
+        .signal_range_min_ns = ppm_rx_min,
+        .signal_range_max_ns = ppm_rx_max,
+        .flags = {
+            .en_partial_rx = false,
+        },
+    };
+    /* as in tx_done_cb(), only switch buffers when the receiver was armed on the other one */
+    uint8_t next_buffer = bus->rx_buffer ^ 1u;
+    esp_err_t err = rmt_receive(bus->rx_chan,
+                                bus->rx_symbols[next_buffer],
+                                max_rx_symbols * sizeof(rmt_symbol_word_t),
+                                &rx_cfg);
+    if (err == ESP_OK) {
+        bus->rx_buffer = next_buffer;
+    } else if (err != ESP_ERR_INVALID_STATE) {
+        /* this function is run in ISR context so no happy flow logging! */
+        ESP_EARLY_LOGE(TAG, "RX start failed on bus: %d", err);
+    }
+}
+
+static bool bus_tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx) {
+    ppm_bus_t *bus = (ppm_bus_t *)user_ctx;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR(broadcast_done_sem, &xHigherPriorityTaskWoken);
+    if (bus->rx_chan != NULL) {
+        ppm_bus_receive(bus);
+    }
+
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+static bool bus_rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_ctx) {
+    ppm_bus_t *bus = (ppm_bus_t *)user_ctx;
+
+    if (edata->flags.is_last) {
+        ppm_bus_receive(bus);
+    }
+
+    if (bus->echo_pending && (tx_echo.type != ftSession) && (tx_echo.type != ftPage)) {
+        /* echo of the enter ppm pattern or calibration frame on a shared pin */
+        bus->echo_pending = false;
+        link_stats.echoes_suppressed++;
+        return false;
+    }
+
+    size_t num_symbols = edata->num_symbols;
+    if (num_symbols > max_rx_symbols) {
+        num_symbols = max_rx_symbols;
+    }
+
+    ppm_tx_item_t item;
+    if (ppm_decode_symbols(edata->received_symbols, num_symbols, &item, &link_stats) != ESP_OK) {
+        return false;
+    }
+    if (bus->echo_pending && ppm_matches_echo(&item)) {
+        /* own frame seen back on a shared pin */
+        bus->echo_pending = false;
+        link_stats.echoes_suppressed++;
+        PPM_EVENT(PPM_EVENT_RX_ECHO, item.type, 0u);
+        return false;
+    }
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if (xQueueSendFromISR(bus->rx_queue, &item, &xHigherPriorityTaskWoken) != pdTRUE) {
+        PPM_EVENT(PPM_EVENT_RX_OVERFLOW, item.type, item.frame.data_len);
+        link_stats.rx_overflows++;
+        return false;
+    }
+    link_stats.frames_received++;
+    PPM_EVENT(PPM_EVENT_RX_FRAME, item.type | (item.frame.repairs << 8), item.frame.data_len);
+
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+esp_err_t rmt_ppm_init(const rmt_ppm_config_t *cfg) {
+    if ((!cfg) || (cfg->tx_gpio_num == GPIO_NUM_MAX) || (cfg->rx_gpio_num == GPIO_NUM_MAX)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Init PPM component on GPIO %d %d", cfg->tx_gpio_num, cfg->rx_gpio_num);
+
+    tx_gpio_num = cfg->tx_gpio_num;
+    rx_gpio_num = cfg->rx_gpio_num;
+
+    /* the channels tick at the nominal symbol time unit, other bitrates scale the symbol times */
+    ppm_resolution_hz = channel_resolution_hz;
+    rx_units_per_tick_q16 = 1u << 16;
+    rmt_ppm_encoder_set_timebase(channel_resolution_hz, ppm_resolution_hz);
+    /* the largest frame is transmitted without memory refills, the channel is never rebuilt for
+     * smaller ones */
+    tx_mem_symbols = (cfg->max_tx_words == 0u) ? TX_MAX_MEM_SYMBOLS :
+                     ppm_channel_mem_symbols(cfg->max_tx_words * 2u, TX_MAX_MEM_SYMBOLS);
+    ESP_ERROR_CHECK(rmt_ppm_reconfigure_tx(channel_resolution_hz));
+    /* the channel holds the longest response, sized from the same length as the receive buffers */
+    rx_mem_symbols = ppm_channel_mem_symbols(max_rx_data_len, RX_MAX_MEM_SYMBOLS);
+    ESP_ERROR_CHECK(rmt_ppm_reconfigure_rx(channel_resolution_hz));
+    rmt_ppm_capture_set_resolution(channel_resolution_hz);
+
+    max_rx_symbols = max_rx_data_len * SYMBOLS_PER_BYTE;
+    rmt_symbols_buffer = 0;
+    rx_symbols[0] = ppmmem_calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
+    rx_symbols[1] = ppmmem_calloc(max_rx_symbols, sizeof(rmt_symbol_word_t));
+    if (!rx_symbols[0] || !rx_symbols[1]) {
+        ppmmem_free(rx_symbols[1]);
+        ppmmem_free(rx_symbols[0]);
+        ESP_LOGE(TAG, "Failed to allocate symbol buffers");
+        return ESP_ERR_NO_MEM;
+    }
+
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    tx_done_sem = xSemaphoreCreateCountingStatic(TX_QUEUE_DEPTH, 0, &tx_done_sem_buffer);
+#else
+    tx_done_sem = xSemaphoreCreateCounting(TX_QUEUE_DEPTH, 0);
+#endif
+    if (!tx_done_sem) {
+        ESP_LOGE(TAG, "Failed to create TX done semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+
+    rmt_ppm_encoder_config_t rmt_ppm_enc_cfg = {};
+    ESP_ERROR_CHECK(rmt_ppm_encoder_new(&rmt_ppm_enc_cfg, &ppm_encoder));
+    rmt_copy_encoder_config_t idle_enc_cfg = {};
+    ESP_ERROR_CHECK(rmt_new_copy_encoder(&idle_enc_cfg, &idle_encoder));
+
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    rx_queue_storage = ppmmem_malloc(RX_QUEUE_LENGTH * sizeof(ppm_tx_item_t));
+    if (rx_queue_storage != NULL) {
+        rx_queue = xQueueCreateStatic(RX_QUEUE_LENGTH, sizeof(ppm_tx_item_t), rx_queue_storage, &rx_queue_buffer);
+    }
+#else
+    rx_queue = xQueueCreate(RX_QUEUE_LENGTH, sizeof(ppm_tx_item_t));
+#endif
+    if (!rx_queue) {
+        ESP_LOGE(TAG, "Failed to create RX queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_ppm_deinit(void) {
+    ppm_broadcast_close();
+
+    if (tx_done_sem) {
+        vSemaphoreDelete(tx_done_sem);
+        tx_done_sem = NULL;
+    }
+
+    rmt_ppm_encoder_delete(ppm_encoder);
+    ppm_encoder = NULL;
+    if (idle_encoder) {
+        (void)rmt_del_encoder(idle_encoder);
+        idle_encoder = NULL;
+    }
+    tx_pending = 0u;
+    tx_frames = 0u;
+    memset(&tx_echo, 0, sizeof(tx_echo));
+
+    ppmmem_free(rx_symbols[0]);
     rx_symbols[0] = NULL;
-    free(rx_symbols[1]);
+    ppmmem_free(rx_symbols[1]);
     rx_symbols[1] = NULL;
 
     if (tx_chan) {
@@ -382,10 +1361,30 @@ esp_err_t rmt_ppm_deinit(void) {
         vQueueDelete(rx_queue);
         rx_queue = NULL;
     }
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    ppmmem_free(rx_queue_storage);
+    rx_queue_storage = NULL;
+#endif
 
     return ESP_OK;
 }
 
+size_t rmt_ppm_get_arena_size(void) {
+    size_t symbols_size = max_rx_data_len * SYMBOLS_PER_BYTE * sizeof(rmt_symbol_word_t);
+
+    return (2u * ppmmem_blockSize(symbols_size)) +
+           ppmmem_blockSize(RX_QUEUE_LENGTH * sizeof(ppm_tx_item_t)) +
+           ppmmem_blockSize(RMT_PPM_MAX_FRAME_WORDS * sizeof(uint16_t)) +
+           rmt_ppm_encoder_get_arena_size();
+}
+
+size_t rmt_ppm_get_selftest_arena_size(void) {
+    const size_t max_symbols = 2u + (sizeof(((ppm_tx_item_t *)0)->frame.data) * SYMBOLS_PER_BYTE);
+
+    return (2u * ppmmem_blockSize(max_symbols * sizeof(rmt_symbol_word_t))) +
+           ppmmem_blockSize(2u * sizeof(ppm_tx_item_t));
+}
+
 esp_err_t rmt_ppm_enable(void) {
     return ESP_OK;
 }
@@ -398,7 +1397,8 @@ esp_err_t rmt_ppm_disable(void) {
 }
 
 esp_err_t rmt_ppm_set_bitrate(uint32_t bitrate) {
-    if (bitrate == 0) {
+    if ((bitrate == 0) || (bitrate > RMT_PPM_MAX_BITRATE)) {
+        /* above the maximum symbol values are closer than 2 channel ticks */
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -415,10 +1415,17 @@ esp_err_t rmt_ppm_set_bitrate(uint32_t bitrate) {
      *
      * Min pulse = 1us
      * Max pulse = 22.5us
+     *
+     * The channels keep their resolution, the symbol times are scaled to the bitrate instead.
      */
+    /* nothing may be encoded or decoded at the previous bitrate meanwhile */
+    ppm_wait_tx_done();
+
     ppm_resolution_hz = bitrate / 2u * 27u;
     ppm_rx_min = 8000000000u / 27u / bitrate;
     ppm_rx_max = 20000000000u / 3u / bitrate;
+    rmt_ppm_encoder_set_timebase(channel_resolution_hz, ppm_resolution_hz);
+    rx_units_per_tick_q16 = (uint32_t)(((uint64_t)ppm_resolution_hz << 16) / channel_resolution_hz);
 
     return ESP_OK;
 }
@@ -428,6 +1435,9 @@ esp_err_t rmt_ppm_send_enter_ppm_pattern(uint32_t pattern_time) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    /* queued frames go first */
+    ppm_wait_tx_done();
+
     (void)rmt_disable(rx_chan);
     esp_err_t err = rmt_enable(rx_chan);
     if (err != ESP_OK) {
@@ -449,23 +1459,27 @@ esp_err_t rmt_ppm_send_enter_ppm_pattern(uint32_t pattern_time) {
     }
 
     rmt_transmit_config_t tx_cfg = {.loop_count = loop_count};
-    err = rmt_transmit(tx_chan, ppm_encoder, item.raw, item.epm_pattern.pulse_len, &tx_cfg);
+    ppm_expect_echo(&item);
+    rmt_ppm_trace_begin_tx(item.raw, item.epm_pattern.pulse_len);
+    PPM_EVENT(PPM_EVENT_TX_START, ftEnter_Ppm, pattern_time);
+    err = ppm_transmit(item.raw, item.epm_pattern.pulse_len, &tx_cfg);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "TX failed: %d", err);
         return ESP_FAIL;
     }
 
-    ppmbtl_chipPower(true);
+    ppmpower_setChip(true);
 
-    /* Wait for TX done via callback semaphore */
-    if (xSemaphoreTake(tx_done_sem, portMAX_DELAY) != pdTRUE) {
-        ESP_LOGE(TAG, "TX done wait failed");
-    }
+    ppm_wait_tx_done();
+    PPM_EVENT(PPM_EVENT_TX_DONE, ftEnter_Ppm, ESP_OK);
 
     return ESP_OK;
 }
 
 esp_err_t rmt_ppm_send_calibration_frame(void) {
+    /* queued frames go first */
+    ppm_wait_tx_done();
+
     (void)rmt_disable(rx_chan);
     esp_err_t err = rmt_enable(rx_chan);
     if (err != ESP_OK) {
@@ -475,52 +1489,111 @@ esp_err_t rmt_ppm_send_calibration_frame(void) {
 
     ppm_tx_item_t item = { .type = ftCalibration };
     rmt_transmit_config_t tx_cfg = {.loop_count = 0};
-    err = rmt_transmit(tx_chan, ppm_encoder, item.raw, 1, &tx_cfg);
+    ppm_expect_echo(&item);
+    rmt_ppm_trace_begin_tx(item.raw, 1);
+    PPM_EVENT(PPM_EVENT_TX_START, ftCalibration, 0u);
+    err = ppm_transmit(item.raw, 1, &tx_cfg);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "TX failed: %d", err);
         return ESP_FAIL;
     }
 
-    /* Wait for TX done via callback semaphore */
-    if (xSemaphoreTake(tx_done_sem, portMAX_DELAY) != pdTRUE) {
-        ESP_LOGE(TAG, "TX done wait failed");
-    }
+    ppm_wait_tx_done();
+    PPM_EVENT(PPM_EVENT_TX_DONE, ftCalibration, ESP_OK);
 
     return ESP_OK;
 }
 
 esp_err_t rmt_ppm_send_frame(ppm_frame_type_t type, const uint16_t * data, size_t length) {
-    if (!data || length == 0) {
+    esp_err_t err = rmt_ppm_send_frame_async(type, data, length, 0u);
+    if (err == ESP_OK) {
+        err = rmt_ppm_wait_tx_done();
+    }
+
+    return err;
+}
+
+esp_err_t rmt_ppm_send_frame_async(ppm_frame_type_t type, const uint16_t * data, size_t length, uint32_t idle_us) {
+    if (!data || length == 0 || length > (sizeof(((ppm_tx_item_t *)0)->frame.data) / 2u)) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    (void)rmt_disable(rx_chan);
-    esp_err_t err = rmt_enable(rx_chan);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Enable RX failed: %d", err);
-        return ESP_FAIL;
+    uint32_t idle_ticks = (uint32_t)(((uint64_t)idle_us * channel_resolution_hz) / 1000000u);
+    if (idle_ticks > TX_IDLE_MAX_TICKS) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    ppm_tx_item_t item;
-    memset(&item, 0, sizeof(item));
-    item.type = type;
+    if (tx_frames == TX_ASYNC_FRAMES) {
+        /* all frame slots in use */
+        ppm_wait_tx_done();
+    }
+
+    esp_err_t err;
+    if (tx_pending == 0u) {
+        /* a new batch of frames, the previous ones are no longer echoed */
+        tx_frames = 0u;
+        (void)rmt_disable(rx_chan);
+        err = rmt_enable(rx_chan);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Enable RX failed: %d", err);
+            return ESP_FAIL;
+        }
+    }
+
+    /* the frame is kept in its slot until the encoder has consumed it */
+    ppm_tx_item_t *item = &tx_slots[tx_frames];
+    memset(item, 0, sizeof(*item));
+    item->type = type;
     for (size_t i = 0; i < length; i++) {
-        item.frame.data[i * 2] = (uint8_t)(data[i] >> 8);
-        item.frame.data[(i * 2) + 1] = (uint8_t)(data[i] >> 0);
+        item->frame.data[i * 2] = (uint8_t)(data[i] >> 8);
+        item->frame.data[(i * 2) + 1] = (uint8_t)(data[i] >> 0);
     }
-    item.frame.data_len = length * 2;
+    item->frame.data_len = length * 2;
 
     rmt_transmit_config_t tx_cfg = {.loop_count = 0};
-    err = rmt_transmit(tx_chan, ppm_encoder, item.raw, item.frame.data_len, &tx_cfg);
+    ppm_expect_echo(item);
+    rmt_ppm_trace_begin_tx(item->raw, item->frame.data_len);
+    PPM_EVENT(PPM_EVENT_TX_START, type, length);
+    err = ppm_transmit(item->raw, item->frame.data_len, &tx_cfg);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "TX failed: %d", err);
         return ESP_FAIL;
     }
+    tx_frames++;
+
+    if ((broadcast_count != 0u) || rmt_ppm_trace_is_active()) {
+        /* the broadcast symbols and the golden trace hold a single transmission, send it now */
+        ppm_wait_tx_done();
+        PPM_EVENT(PPM_EVENT_TX_DONE, type, ESP_OK);
+        esp_rom_delay_us(idle_us);
+        return ESP_OK;
+    }
+
+    if (idle_ticks != 0u) {
+        /* the gap to the next frame is transmitted as an idle symbol */
+        rmt_symbol_word_t *idle = &tx_idle[tx_frames - 1u];
+        idle->level0 = 0;
+        idle->duration0 = (idle_ticks + 1u) / 2u;
+        idle->level1 = 0;
+        idle->duration1 = idle_ticks / 2u;
+        ppm_echo_tx_queued(&tx_echo);
+        err = rmt_transmit(tx_chan, idle_encoder, idle, sizeof(*idle), &tx_cfg);
+        if (err != ESP_OK) {
+            ppm_echo_tx_done(&tx_echo, esp_timer_get_time());
+            ESP_LOGE(TAG, "TX failed: %d", err);
+            return ESP_FAIL;
+        }
+        tx_pending++;
+    }
 
-    /* Wait for TX done via callback semaphore */
-    if (xSemaphoreTake(tx_done_sem, portMAX_DELAY) != pdTRUE) {
-        ESP_LOGE(TAG, "TX done wait failed");
+    return ESP_OK;
+}
+
+esp_err_t rmt_ppm_wait_tx_done(void) {
+    if (tx_pending != 0u) {
+        PPM_EVENT(PPM_EVENT_TX_DONE, tx_slots[tx_frames - 1u].type, ESP_OK);
     }
+    ppm_wait_tx_done();
 
     return ESP_OK;
 }
@@ -530,21 +1603,562 @@ size_t rmt_ppm_wait_for_response_frame(ppm_frame_type_t * type, uint16_t ** data
         return 0;
     }
 
+    uint16_t frame[RMT_PPM_MAX_FRAME_WORDS];
+    size_t retval = rmt_ppm_receive_frame(type, frame, RMT_PPM_MAX_FRAME_WORDS, bus_timeout);
+    if (retval > 0) {
+        uint16_t * buffer = ppmmem_calloc(retval, sizeof(uint16_t));
+        if (buffer != NULL) {
+            memcpy(buffer, frame, retval * sizeof(uint16_t));
+        } else {
+            ESP_LOGE(TAG, "Failed to allocate response buffer");
+            retval = 0;
+        }
+        *data = buffer;
+    }
+
+    return retval;
+}
+
+static TickType_t ppm_response_deadline(uint16_t bus_timeout) {
+    uint32_t timeout = ((uint32_t)bus_timeout * timeout_scale) / 100u;
+
     /* round up to multiple of portTICK_PERIOD_MS (add 1 for margin) */
-    uint16_t timeout = ((bus_timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS) + 1;
+    return xTaskGetTickCount() + ((timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS) + 1;
+}
+
+static TickType_t ppm_ticks_until(TickType_t deadline) {
+    TickType_t now = xTaskGetTickCount();
+    return ((TickType_t)(deadline - now) <= (TickType_t)(portMAX_DELAY / 2)) ? (deadline - now) : 0;
+}
+
+static bool ppm_receive_item(ppm_tx_item_t *item, TickType_t deadline) {
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+    while (fault_active) {
+        TickType_t until = deadline;
+        if (fault_item_held) {
+            if (ppm_ticks_until(fault_held_until) == 0) {
+                /* late response is due */
+                *item = fault_held_item;
+                fault_item_held = false;
+                return true;
+            }
+            if (ppm_ticks_until(fault_held_until) < ppm_ticks_until(deadline)) {
+                until = fault_held_until;
+            }
+        }
+
+        if (xQueueReceive(rx_queue, item, ppm_ticks_until(until)) != pdTRUE) {
+            if ((ppm_ticks_until(deadline) == 0) &&
+                (!fault_item_held || (ppm_ticks_until(fault_held_until) != 0))) {
+                return false;
+            }
+            continue;
+        }
+
+        uint32_t delay = ppm_fault_delay(item);
+        if ((delay == 0u) || fault_item_held) {
+            return true;
+        }
+        /* hold back the response, it is delivered once due */
+        fault_held_item = *item;
+        fault_item_held = true;
+        fault_held_until = xTaskGetTickCount() + ((delay + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+        fault_stats.delayed++;
+    }
+#endif
+
+    return xQueueReceive(rx_queue, item, ppm_ticks_until(deadline)) == pdTRUE;
+}
+
+static size_t ppm_copy_frame(const ppm_tx_item_t *item, uint16_t *data, size_t max_length) {
+    size_t retval = item->frame.data_len / 2;
+    if (retval > max_length) {
+        ESP_LOGE(TAG, "Response frame too long (%u words)", (unsigned)retval);
+        retval = 0;
+    }
+    for (size_t i = 0; i < retval; i++) {
+        data[i] = ((uint16_t)item->frame.data[i * 2]) << 8;
+        data[i] |= ((uint16_t)item->frame.data[(i * 2) + 1]) << 0;
+    }
+
+    return retval;
+}
+
+size_t rmt_ppm_receive_frame(ppm_frame_type_t * type, uint16_t * data, size_t max_length, uint16_t bus_timeout) {
+    if (!type || !data) {
+        return 0;
+    }
 
     size_t retval = 0;
     ppm_tx_item_t item;
-    if (xQueueReceive(rx_queue, &item, timeout) == pdTRUE) {
+    if (ppm_receive_item(&item, ppm_response_deadline(bus_timeout))) {
         *type = item.type;
-        retval = item.frame.data_len / 2;
-        uint16_t * buffer = calloc(retval, sizeof(uint16_t));
-        for (size_t i = 0; i < retval; i++) {
-            buffer[i] = ((uint16_t)item.frame.data[i * 2]) << 8;
-            buffer[i] |= ((uint16_t)item.frame.data[(i * 2) + 1]) << 0;
-        }
-        *data = buffer;
+        retval = ppm_copy_frame(&item, data, max_length);
     }
 
     return retval;
 }
+
+size_t rmt_ppm_receive_ack(ppm_frame_type_t type,
+                           uint16_t expected,
+                           uint16_t tag_mask,
+                           uint16_t * data,
+                           size_t max_length,
+                           uint16_t bus_timeout) {
+    return rmt_ppm_receive_bus_ack(0u, type, expected, tag_mask, data, max_length, bus_timeout);
+}
+
+size_t rmt_ppm_receive_bus_ack(size_t bus,
+                               ppm_frame_type_t type,
+                               uint16_t expected,
+                               uint16_t tag_mask,
+                               uint16_t * data,
+                               size_t max_length,
+                               uint16_t bus_timeout) {
+    if (!data || (bus > broadcast_count)) {
+        return 0;
+    }
+
+    QueueHandle_t bus_queue = (bus == 0u) ? NULL : broadcast_buses[bus - 1u].rx_queue;
+    if ((bus != 0u) && (bus_queue == NULL)) {
+        /* the bus does not read acknowledges */
+        return 0;
+    }
+
+    TickType_t deadline = ppm_response_deadline(bus_timeout);
+
+    ppm_tx_item_t item;
+    while ((bus_queue == NULL) ? ppm_receive_item(&item, deadline) :
+           (xQueueReceive(bus_queue, &item, ppm_ticks_until(deadline)) == pdTRUE)) {
+        size_t retval = ppm_copy_frame(&item, data, max_length);
+        if ((item.type != type) || (retval == 0) || ((data[0] & tag_mask) != (expected & tag_mask))) {
+            /* late response to an earlier frame, keep waiting */
+            link_stats.stale_discarded++;
+            PPM_EVENT(PPM_EVENT_ACK_STALE, item.type, (retval != 0) ? data[0] : 0u);
+            continue;
+        }
+        if ((item.frame.repairs != 0) && (data[0] != expected)) {
+            /* the repair did not restore the expected acknowledge, keep waiting */
+            link_stats.repairs_rejected++;
+            PPM_EVENT(PPM_EVENT_ACK_STALE, item.type, data[0]);
+            continue;
+        }
+        PPM_EVENT(PPM_EVENT_ACK, type, data[0]);
+        return retval;
+    }
+
+    PPM_EVENT(PPM_EVENT_ACK_TIMEOUT, type, expected);
+    return 0;
+}
+
+size_t rmt_ppm_flush_rx(void) {
+    size_t flushed = 0;
+    ppm_tx_item_t item;
+
+    while (xQueueReceive(rx_queue, &item, 0) == pdTRUE) {
+        flushed++;
+    }
+    for (size_t i = 0; i < broadcast_count; i++) {
+        while ((broadcast_buses[i].rx_queue != NULL) && (xQueueReceive(broadcast_buses[i].rx_queue, &item, 0) == pdTRUE)) {
+            flushed++;
+        }
+    }
+    link_stats.stale_discarded += flushed;
+
+    return flushed;
+}
+
+esp_err_t rmt_ppm_set_broadcast(const rmt_ppm_bus_config_t * buses, size_t count) {
+    if ((count > (RMT_PPM_MAX_BUSES - 1u)) || ((count != 0u) && (buses == NULL)) || (tx_chan == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* queued frames go out on the current set of buses */
+    ppm_wait_tx_done();
+
+    bool unchanged = (count == broadcast_count);
+    for (size_t i = 0; unchanged && (i < count); i++) {
+        unchanged = (buses[i].tx_gpio_num == broadcast_config[i].tx_gpio_num) &&
+                    (buses[i].rx_gpio_num == broadcast_config[i].rx_gpio_num);
+    }
+    if (unchanged) {
+        /* the resources are kept, nothing is allocated */
+        return ESP_OK;
+    }
+
+    ppm_broadcast_close();
+    if (count == 0u) {
+        return ESP_OK;
+    }
+    memcpy(broadcast_config, buses, count * sizeof(rmt_ppm_bus_config_t));
+
+    esp_err_t err = ESP_OK;
+    broadcast_symbols = ppmmem_malloc(BROADCAST_MAX_SYMBOLS * sizeof(rmt_symbol_word_t));
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    broadcast_done_sem = xSemaphoreCreateCountingStatic(count, 0, &broadcast_done_sem_buffer);
+#else
+    broadcast_done_sem = xSemaphoreCreateCounting(count, 0);
+#endif
+    if (!broadcast_symbols || !broadcast_done_sem) {
+        err = ESP_ERR_NO_MEM;
+    }
+    if (err == ESP_OK) {
+        rmt_copy_encoder_config_t copy_cfg = {};
+        err = rmt_new_copy_encoder(&copy_cfg, &broadcast_encoder);
+    }
+
+    rmt_channel_handle_t channels[RMT_PPM_MAX_BUSES] = { tx_chan };
+    for (size_t i = 0; (err == ESP_OK) && (i < count); i++) {
+        /* counted first, so a partly opened bus is closed as well */
+        broadcast_count = i + 1u;
+        err = ppm_bus_open(&broadcast_buses[i], &buses[i]);
+        channels[i + 1u] = broadcast_buses[i].tx_chan;
+    }
+
+    if (err == ESP_OK) {
+        rmt_sync_manager_config_t sync_cfg = {
+            .tx_channel_array = channels,
+            .array_size = count + 1u,
+        };
+        err = rmt_new_sync_manager(&sync_cfg, &broadcast_sync);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Broadcast setup failed: %d", err);
+        ppm_broadcast_close();
+    }
+
+    return err;
+}
+
+size_t rmt_ppm_get_broadcast_arena_size(const rmt_ppm_bus_config_t * buses, size_t count) {
+    if ((buses == NULL) || (count == 0u)) {
+        return 0u;
+    }
+
+    size_t symbols_size = max_rx_data_len * SYMBOLS_PER_BYTE * sizeof(rmt_symbol_word_t);
+    size_t size = ppmmem_blockSize(BROADCAST_MAX_SYMBOLS * sizeof(rmt_symbol_word_t));
+    for (size_t i = 0; i < count; i++) {
+        if (buses[i].rx_gpio_num != GPIO_NUM_NC) {
+            size += (2u * ppmmem_blockSize(symbols_size)) +
+                    ppmmem_blockSize(RX_QUEUE_LENGTH * sizeof(ppm_tx_item_t));
+        }
+    }
+
+    return size;
+}
+
+void rmt_ppm_get_link_stats(rmt_ppm_link_stats_t * stats) {
+    if (stats != NULL) {
+        stats->frames_received = link_stats.frames_received;
+        stats->decode_errors = link_stats.decode_errors;
+        stats->timing_errors = link_stats.timing_errors;
+        stats->rx_overflows = link_stats.rx_overflows;
+        stats->glitches_merged = link_stats.glitches_merged;
+        stats->resyncs = link_stats.resyncs;
+        stats->repairs_rejected = link_stats.repairs_rejected;
+        stats->echoes_suppressed = link_stats.echoes_suppressed;
+        stats->stale_discarded = link_stats.stale_discarded;
+        stats->timebase_permille = link_stats.timebase_permille;
+    }
+}
+
+void rmt_ppm_reset_link_stats(void) {
+    link_stats.frames_received = 0u;
+    link_stats.decode_errors = 0u;
+    link_stats.timing_errors = 0u;
+    link_stats.rx_overflows = 0u;
+    link_stats.glitches_merged = 0u;
+    link_stats.resyncs = 0u;
+    link_stats.repairs_rejected = 0u;
+    link_stats.echoes_suppressed = 0u;
+    link_stats.stale_discarded = 0u;
+    link_stats.timebase_permille = 0u;
+}
+
+static void ppm_loopback_symbols(const rmt_symbol_word_t *tx_symbols, size_t symbol_count, rmt_symbol_word_t *rx_symbols) {
+    for (size_t i = 0; i < symbol_count; i++) {
+        rx_symbols[i].level0 = tx_symbols[i].level1;
+        rx_symbols[i].duration0 = tx_symbols[i].duration1;
+        if ((i + 1) < symbol_count) {
+            rx_symbols[i].level1 = tx_symbols[i + 1].level0;
+            rx_symbols[i].duration1 = tx_symbols[i + 1].duration0;
+        } else {
+            /* idle after the last pulse ends the reception */
+            rx_symbols[i].level1 = 0;
+            rx_symbols[i].duration1 = 0;
+        }
+    }
+}
+
+static uint32_t ppm_selftest_echo(void) {
+    uint32_t failures = 0u;
+    ppm_echo_t echo;
+    ppm_tx_item_t item;
+    memset(&echo, 0, sizeof(echo));
+    memset(&item, 0, sizeof(item));
+
+    /* session frame with the idle gap in front of page 0, and page 0, queued together */
+    item.type = ftSession;
+    item.frame.data_len = 8u;
+    ppm_echo_expect(&echo, &item, false, true);
+    ppm_echo_tx_queued(&echo);
+    ppm_echo_tx_queued(&echo);
+    item.type = ftPage;
+    item.frame.data_len = 130u;
+    ppm_echo_expect(&echo, &item, true, true);
+    ppm_echo_tx_queued(&echo);
+
+    /* the session frame and the idle gap complete, the session frame echo is received */
+    ppm_echo_tx_done(&echo, 1000);
+    ppm_echo_tx_done(&echo, 2000);
+    ppm_echo_received(&echo);
+
+    /* page 0 takes several ms, its echo may not be taken for the page acknowledge */
+    int64_t page_done = 2000 + (10 * RX_ECHO_WINDOW_US);
+    if (!ppm_echo_window_open(&echo, page_done)) {
+        failures++;
+    }
+    ppm_echo_tx_done(&echo, page_done);
+    if (!ppm_echo_window_open(&echo, page_done + 100)) {
+        failures++;
+    }
+    ppm_echo_received(&echo);
+
+    /* the acknowledge following the echo is a response */
+    if (ppm_echo_window_open(&echo, page_done + 200)) {
+        failures++;
+    }
+
+    return failures;
+}
+
+esp_err_t rmt_ppm_run_selftest(uint32_t frames, uint32_t seed, rmt_ppm_selftest_result_t * result) {
+    if ((frames == 0u) || (result == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* frame type pulse and 4 symbols per byte */
+    const size_t max_symbols = 2u + (sizeof(((ppm_tx_item_t *)0)->frame.data) * SYMBOLS_PER_BYTE);
+    rmt_symbol_word_t *reference = ppmmem_malloc(max_symbols * sizeof(rmt_symbol_word_t));
+    rmt_symbol_word_t *split = ppmmem_malloc(max_symbols * sizeof(rmt_symbol_word_t));
+    ppm_tx_item_t *tx_item = ppmmem_malloc(2u * sizeof(ppm_tx_item_t));
+    if ((reference == NULL) || (split == NULL) || (tx_item == NULL)) {
+        ppmmem_free(tx_item);
+        ppmmem_free(split);
+        ppmmem_free(reference);
+        return ESP_ERR_NO_MEM;
+    }
+    ppm_tx_item_t *rx_item = &tx_item[1];
+
+    memset(result, 0, sizeof(*result));
+    uint32_t random = (seed != 0u) ? seed : 1u;
+    uint64_t encoded_symbols = 0u;
+    uint64_t encode_us = 0u;
+    uint64_t decode_us = 0u;
+    rmt_ppm_link_stats_t selftest_stats = {0};
+
+    for (uint32_t frame = 0u; frame < frames; frame++) {
+        memset(tx_item, 0, sizeof(*tx_item));
+        tx_item->type = ((ppm_random(&random) & 1u) != 0u) ? ftPage : ftSession;
+        tx_item->frame.data_len = 2u * (1u + (ppm_random(&random) % (sizeof(tx_item->frame.data) / 2u)));
+        for (size_t i = 0; i < tx_item->frame.data_len; i++) {
+            tx_item->frame.data[i] = (uint8_t)ppm_random(&random);
+        }
+
+        /* reference encoding in a single round */
+        rmt_ppm_encode_state_t state = { .frame_type = ftUnknown };
+        bool complete = false;
+        int64_t start = esp_timer_get_time();
+        size_t symbol_count = rmt_ppm_encode_symbols(&state, tx_item->raw, tx_item->frame.data_len,
+                                                     reference, max_symbols, &complete);
+        encode_us += (uint64_t)(esp_timer_get_time() - start);
+        encoded_symbols += symbol_count;
+        if (!complete || (symbol_count != (2u + (tx_item->frame.data_len * SYMBOLS_PER_BYTE)))) {
+            result->mismatches++;
+            continue;
+        }
+
+        /* the same encoding truncated at every possible round size */
+        for (size_t round = 1u; round <= symbol_count; round++) {
+            size_t count = 0u;
+            memset(&state, 0, sizeof(state));
+            complete = false;
+            while (!complete && (count < symbol_count)) {
+                size_t room = symbol_count - count;
+                count += rmt_ppm_encode_symbols(&state, tx_item->raw, tx_item->frame.data_len,
+                                                &split[count], (round < room) ? round : room, &complete);
+            }
+            result->splits++;
+            if (!complete || (count != symbol_count) ||
+                (memcmp(split, reference, symbol_count * sizeof(rmt_symbol_word_t)) != 0)) {
+                result->mismatches++;
+            }
+        }
+
+        /* decode the symbols as received on the bus */
+        ppm_loopback_symbols(reference, symbol_count, split);
+        start = esp_timer_get_time();
+        /* the link statistics only count what was received from the bus */
+        esp_err_t err = ppm_decode_symbols(split, symbol_count, rx_item, &selftest_stats);
+        decode_us += (uint64_t)(esp_timer_get_time() - start);
+        if ((err != ESP_OK) ||
+            (rx_item->type != tx_item->type) ||
+            (rx_item->frame.data_len != tx_item->frame.data_len) ||
+            (memcmp(rx_item->frame.data, tx_item->frame.data, tx_item->frame.data_len) != 0)) {
+            result->mismatches++;
+        }
+        result->frames++;
+
+        /* let the idle task run during long tests */
+        vTaskDelay(1);
+    }
+
+    result->mismatches += ppm_selftest_echo();
+
+    if (encode_us != 0u) {
+        result->encode_symbols_per_s = (uint32_t)((encoded_symbols * 1000000u) / encode_us);
+    }
+    if (decode_us != 0u) {
+        result->decode_symbols_per_s = (uint32_t)((encoded_symbols * 1000000u) / decode_us);
+    }
+
+    ppmmem_free(tx_item);
+    ppmmem_free(split);
+    ppmmem_free(reference);
+
+    ESP_LOGI(TAG, "self test: %u frames, %u splits, %u mismatches, encode %u sym/s, decode %u sym/s",
+             (unsigned)result->frames,
+             (unsigned)result->splits,
+             (unsigned)result->mismatches,
+             (unsigned)result->encode_symbols_per_s,
+             (unsigned)result->decode_symbols_per_s);
+
+    return (result->mismatches == 0u) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+void rmt_ppm_set_timeout_scale(uint16_t percent) {
+    timeout_scale = (percent != 0u) ? percent : 100u;
+}
+
+static uint32_t ppm_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+
+static bool ppm_fault_hit(uint32_t *state, uint16_t permille) {
+    return (permille != 0u) && ((ppm_random(state) % 1000u) < permille);
+}
+
+static const rmt_symbol_word_t *ppm_fault_symbols(const rmt_symbol_word_t *symbols, size_t *symbol_count) {
+    bool corrupt = ppm_fault_hit(&fault_isr_random, fault_model.corrupt_permille);
+    if (((fault_model.jitter_percent == 0u) && !corrupt) || (*symbol_count == 0u)) {
+        return symbols;
+    }
+
+    size_t count = (*symbol_count < FAULT_SYMBOLS_MAX) ? *symbol_count : FAULT_SYMBOLS_MAX;
+    memcpy(fault_symbols, symbols, count * sizeof(rmt_symbol_word_t));
+
+    if (fault_model.jitter_percent != 0u) {
+        uint32_t span = (2u * fault_model.jitter_percent * 10u) + 1u;
+        for (size_t i = 0; i < count; i++) {
+            int32_t permille = 1000 + (int32_t)(ppm_random(&fault_isr_random) % span) -
+                               (int32_t)(fault_model.jitter_percent * 10u);
+            fault_symbols[i].duration0 = (uint16_t)(((uint32_t)fault_symbols[i].duration0 * (uint32_t)permille) / 1000u);
+            fault_symbols[i].duration1 = (uint16_t)(((uint32_t)fault_symbols[i].duration1 * (uint32_t)permille) / 1000u);
+        }
+        fault_stats.jittered++;
+    }
+
+    if (corrupt) {
+        /* shift one symbol, changing its value */
+        rmt_symbol_word_t *symbol = &fault_symbols[ppm_random(&fault_isr_random) % count];
+        if (symbol->duration0 > FAULT_CORRUPT_SHIFT) {
+            symbol->duration0 -= FAULT_CORRUPT_SHIFT;
+        } else {
+            symbol->duration0 += FAULT_CORRUPT_SHIFT;
+        }
+        fault_stats.corrupted++;
+    }
+
+    *symbol_count = count;
+    return fault_symbols;
+}
+
+static bool ppm_fault_drop(void) {
+    if (fault_stuck_remaining > 0u) {
+        fault_stuck_remaining--;
+        fault_stats.stuck++;
+        return true;
+    }
+    if (ppm_fault_hit(&fault_isr_random, fault_model.drop_permille)) {
+        fault_stats.dropped++;
+        return true;
+    }
+    if ((fault_model.stuck_frames != 0u) && ppm_fault_hit(&fault_isr_random, fault_model.stuck_permille)) {
+        fault_stuck_remaining = fault_model.stuck_frames - 1u;
+        fault_stats.stuck++;
+        return true;
+    }
+    return false;
+}
+
+static uint32_t ppm_fault_delay(const ppm_tx_item_t *item) {
+    uint32_t delay = 0u;
+    if (item->type == ftSession) {
+        delay += fault_model.session_ack_delay_ms;
+    }
+    if (ppm_fault_hit(&fault_task_random, fault_model.late_permille)) {
+        delay += fault_model.late_ms;
+    }
+    return delay;
+}
+#endif
+
+esp_err_t rmt_ppm_set_fault_model(const rmt_ppm_fault_model_t * model) {
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+    fault_active = false;
+    if (model != NULL) {
+        fault_model = *model;
+        /* xorshift needs a non-zero state */
+        fault_isr_random = (model->seed != 0u) ? model->seed : 1u;
+        fault_task_random = fault_isr_random ^ 0x9E3779B9u;
+        if (fault_task_random == 0u) {
+            fault_task_random = 1u;
+        }
+        fault_stuck_remaining = 0u;
+        fault_item_held = false;
+        fault_stats.dropped = 0u;
+        fault_stats.corrupted = 0u;
+        fault_stats.jittered = 0u;
+        fault_stats.delayed = 0u;
+        fault_stats.stuck = 0u;
+        fault_active = true;
+    }
+    return ESP_OK;
+#else
+    (void)model;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void rmt_ppm_get_fault_stats(rmt_ppm_fault_stats_t * stats) {
+    if (stats == NULL) {
+        return;
+    }
+#if CONFIG_PPM_BOOTLOADER_FAULT_INJECTION
+    stats->dropped = fault_stats.dropped;
+    stats->corrupted = fault_stats.corrupted;
+    stats->jittered = fault_stats.jittered;
+    stats->delayed = fault_stats.delayed;
+    stats->stuck = fault_stats.stuck;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
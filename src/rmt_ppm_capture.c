@@ -0,0 +1,250 @@
+/**
+ * @file
+ * @brief RMT PPM symbol capture module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the RMT PPM symbol capture module.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "rmt_ppm_capture.h"
+
+/** number of entries printed per ring access while dumping */
+#define DUMP_CHUNK_ENTRIES 16u
+
+/** tick resolution of the RMT channels */
+static uint32_t capture_resolution_hz = 4000000u;
+
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+static const char *TAG = "rmt_ppm_capture";
+
+/** capture ring, statically allocated as the recording is done from ISR context */
+static rmt_ppm_capture_entry_t capture_ring[CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES];
+static size_t ring_head = 0u;           /**< index of the next entry to write */
+static size_t ring_count = 0u;          /**< number of entries in the ring */
+static uint32_t ring_lost = 0u;         /**< number of entries overwritten before being read */
+static volatile bool capture_enabled = false;
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** transmission currently being encoded */
+static uint32_t tx_block_time = 0u;
+static uint32_t tx_block_offset = 0u;
+
+/** Append a block of symbols to the ring
+ *
+ * @param[in]  direction  capture direction.
+ * @param[in]  time  start time of the block [us].
+ * @param[in]  offset  offset of the first symbol within the block [ticks].
+ * @param[in]  symbols  symbols to append.
+ * @param[in]  count  number of symbols.
+ * @returns  offset following the last symbol within the block [ticks].
+ */
+static uint32_t rmt_ppm_capture_push(rmt_ppm_capture_dir_t direction,
+                                     uint32_t time,
+                                     uint32_t offset,
+                                     const rmt_symbol_word_t *symbols,
+                                     size_t count);
+
+/** Get the length of a block of symbols
+ *
+ * @param[in]  symbols  symbols of the block.
+ * @param[in]  count  number of symbols.
+ * @returns  length of the block [ticks].
+ */
+static uint32_t rmt_ppm_capture_ticks(const rmt_symbol_word_t *symbols, size_t count);
+
+
+static uint32_t IRAM_ATTR rmt_ppm_capture_ticks(const rmt_symbol_word_t *symbols, size_t count) {
+    uint32_t ticks = 0u;
+    for (size_t i = 0u; i < count; i++) {
+        ticks += symbols[i].duration0 + symbols[i].duration1;
+    }
+    return ticks;
+}
+
+static uint32_t IRAM_ATTR rmt_ppm_capture_push(rmt_ppm_capture_dir_t direction,
+                                               uint32_t time,
+                                               uint32_t offset,
+                                               const rmt_symbol_word_t *symbols,
+                                               size_t count) {
+    portENTER_CRITICAL_SAFE(&capture_lock);
+    for (size_t i = 0u; i < count; i++) {
+        rmt_ppm_capture_entry_t *entry = &capture_ring[ring_head];
+        entry->time = time;
+        entry->offset = offset;
+        entry->symbol = symbols[i];
+        entry->direction = (uint8_t)direction;
+        entry->reserved[0] = 0u;
+        entry->reserved[1] = 0u;
+        entry->reserved[2] = 0u;
+        offset += symbols[i].duration0 + symbols[i].duration1;
+
+        ring_head = (ring_head + 1u) % CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES;
+        if (ring_count < CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES) {
+            ring_count++;
+        } else {
+            ring_lost++;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&capture_lock);
+
+    return offset;
+}
+#endif
+
+esp_err_t rmt_ppm_capture_start(void) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    portENTER_CRITICAL(&capture_lock);
+    ring_head = 0u;
+    ring_count = 0u;
+    ring_lost = 0u;
+    tx_block_time = 0u;
+    tx_block_offset = 0u;
+    capture_enabled = true;
+    portEXIT_CRITICAL(&capture_lock);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t rmt_ppm_capture_stop(void) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    capture_enabled = false;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+size_t rmt_ppm_capture_read(rmt_ppm_capture_entry_t * entries, size_t max_entries) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    if (entries == NULL) {
+        return 0u;
+    }
+
+    portENTER_CRITICAL(&capture_lock);
+    size_t count = (ring_count < max_entries) ? ring_count : max_entries;
+    size_t tail = (ring_head + CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES - ring_count) % CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES;
+    for (size_t i = 0u; i < count; i++) {
+        entries[i] = capture_ring[tail];
+        tail = (tail + 1u) % CONFIG_PPM_BOOTLOADER_CAPTURE_ENTRIES;
+    }
+    ring_count -= count;
+    portEXIT_CRITICAL(&capture_lock);
+
+    return count;
+#else
+    (void)entries;
+    (void)max_entries;
+    return 0u;
+#endif
+}
+
+uint32_t rmt_ppm_capture_get_lost(void) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    return ring_lost;
+#else
+    return 0u;
+#endif
+}
+
+uint32_t rmt_ppm_capture_get_resolution(void) {
+    return capture_resolution_hz;
+}
+
+esp_err_t rmt_ppm_capture_dump(void) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    rmt_ppm_capture_entry_t chunk[DUMP_CHUNK_ENTRIES];
+    uint32_t total = 0u;
+
+    ESP_LOGI(TAG, "ppmcap,start,%u,%u", (unsigned)capture_resolution_hz, (unsigned)rmt_ppm_capture_get_lost());
+    size_t count;
+    while ((count = rmt_ppm_capture_read(chunk, DUMP_CHUNK_ENTRIES)) > 0u) {
+        for (size_t i = 0u; i < count; i++) {
+            ESP_LOGI(TAG, "ppmcap,%c,%u,%u,%u,%u,%u,%u",
+                     (chunk[i].direction == RMT_PPM_CAPTURE_TX) ? 'T' : 'R',
+                     (unsigned)chunk[i].time,
+                     (unsigned)chunk[i].offset,
+                     (unsigned)chunk[i].symbol.level0,
+                     (unsigned)chunk[i].symbol.duration0,
+                     (unsigned)chunk[i].symbol.level1,
+                     (unsigned)chunk[i].symbol.duration1);
+        }
+        total += count;
+    }
+    ESP_LOGI(TAG, "ppmcap,end,%u", (unsigned)total);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void rmt_ppm_capture_set_resolution(uint32_t resolution_hz) {
+    if (resolution_hz != 0u) {
+        capture_resolution_hz = resolution_hz;
+    }
+}
+
+void IRAM_ATTR rmt_ppm_capture_tx(const rmt_symbol_word_t * symbols, size_t count, bool frame_start) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    if (!capture_enabled) {
+        return;
+    }
+
+    if (frame_start) {
+        tx_block_time = (uint32_t)esp_timer_get_time();
+        tx_block_offset = 0u;
+    }
+    tx_block_offset = rmt_ppm_capture_push(RMT_PPM_CAPTURE_TX, tx_block_time, tx_block_offset, symbols, count);
+#else
+    (void)symbols;
+    (void)count;
+    (void)frame_start;
+#endif
+}
+
+void IRAM_ATTR rmt_ppm_capture_rx(const rmt_symbol_word_t * symbols, size_t count, uint32_t idle_ns) {
+#if CONFIG_PPM_BOOTLOADER_CAPTURE
+    if (!capture_enabled || (count == 0u)) {
+        return;
+    }
+
+    /* the receive done event follows the last symbol after the idle time, date the block back */
+    uint64_t length_us = ((uint64_t)rmt_ppm_capture_ticks(symbols, count) * 1000000u) / capture_resolution_hz;
+    uint32_t time = (uint32_t)(esp_timer_get_time() - (int64_t)length_us - (int64_t)(idle_ns / 1000u));
+    (void)rmt_ppm_capture_push(RMT_PPM_CAPTURE_RX, time, 0u, symbols, count);
+#else
+    (void)symbols;
+    (void)count;
+    (void)idle_ns;
+#endif
+}
@@ -23,6 +23,7 @@
  *
  * @details Implementations of the RMT PPM encoder module.
  */
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -33,7 +34,10 @@
 #include "esp_log.h"
 #include "rmt_private.h"
 
+#include "ppm_mem.h"
 #include "ppm_types.h"
+#include "rmt_ppm_capture.h"
+#include "rmt_ppm_trace.h"
 
 #include "rmt_ppm_encoder.h"
 
@@ -43,11 +47,23 @@ static const char *TAG = "rmt_ppm_encoder";
    #define MIN(x, y) ((x) < (y)?(x):(y))
 #endif
 
+/** channel ticks per symbol time unit (nominal 1/4us) [16.16 fixed point] */
+static uint32_t unit_ticks_q16 = 1u << 16;
+/** channel ticks per microsecond (enter ppm pattern) */
+static uint32_t ticks_per_us = 4u;
+
+/** Convert symbol time units into channel ticks
+ *
+ * @param[in]  units  time in symbol time units (nominal 1/4us).
+ * @return  time in channel ticks (rounded).
+ */
+static inline uint16_t ppm_unit_ticks(uint32_t units) {
+    return (uint16_t)(((units * unit_ticks_q16) + (1u << 15)) >> 16);
+}
+
 typedef struct rmt_ppm_encoder_t {
     rmt_encoder_t base;                 /**< encoder base class */
-    ppm_frame_type_t last_frame_type;   /**< current ongoing PPM frame type */
-    size_t last_byte_index;             /**< current byte index */
-    int last_bits_offset;               /**< current bit pair index (0, 2, 4, 6) */
+    rmt_ppm_encode_state_t state;       /**< progress of the ongoing encoding */
 } rmt_ppm_encoder_t;
 
 
@@ -56,44 +72,36 @@ typedef struct rmt_ppm_encoder_t {
 static esp_err_t rmt_ppm_encoder_reset(rmt_encoder_t *encoder) {
     rmt_ppm_encoder_t *ppm_encoder = __containerof(encoder, rmt_ppm_encoder_t, base);
     // reset index to zero
-    ppm_encoder->last_frame_type = ftUnknown;
-    ppm_encoder->last_byte_index = 0;
-    ppm_encoder->last_bits_offset = 0;
+    ppm_encoder->state.frame_type = ftUnknown;
+    ppm_encoder->state.byte_index = 0;
+    ppm_encoder->state.bits_offset = 0;
+    ppm_encoder->state.pulse_symbols = 0;
     return ESP_OK;
 }
 
-/** Encoder implementation
- */
-static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
-                                       rmt_channel_handle_t channel,
-                                       const void *primary_data,
-                                       size_t data_size,
-                                       rmt_encode_state_t *ret_state) {
-    rmt_ppm_encoder_t *ppm_encoder = __containerof(encoder, rmt_ppm_encoder_t, base);
-    rmt_tx_channel_t *tx_chan = __containerof(channel, rmt_tx_channel_t, base);
-    const uint8_t *raw_data = (const uint8_t *)primary_data;
-    rmt_encode_state_t state = RMT_ENCODING_RESET;
-    rmt_dma_descriptor_t *desc0 = NULL;
-    rmt_dma_descriptor_t *desc1 = NULL;
-
-    size_t byte_index = ppm_encoder->last_byte_index;
-    size_t bits_offset = ppm_encoder->last_bits_offset;
+size_t IRAM_ATTR rmt_ppm_encode_symbols(rmt_ppm_encode_state_t *state,
+                                        const uint8_t *raw_data,
+                                        size_t data_size,
+                                        rmt_symbol_word_t *symbols,
+                                        size_t max_symbols,
+                                        bool *complete) {
+    size_t byte_index = state->byte_index;
+    size_t bits_offset = state->bits_offset;
 
     if ((bits_offset == 0) && (byte_index == 0)) {
         /* first byte in the buffer is the frame type to be transmitted */
-        ppm_encoder->last_frame_type = raw_data[byte_index];
+        state->frame_type = raw_data[byte_index];
+        state->pulse_symbols = 0;
         byte_index++;
     }
 
     /* determine the number symbols generated by the encoder */
     size_t mem_want = 0;
-    switch (ppm_encoder->last_frame_type) {
+    switch (state->frame_type) {
         case ftSession:
         case ftPage:
             mem_want = ((data_size - byte_index) * 8 + (8 - bits_offset)) / 2;
-            if ((bits_offset == 0) && (byte_index == 1)) {
-                mem_want += 2; /* add frame type pulse */
-            }
+            mem_want += 2u - state->pulse_symbols; /* add frame type pulse */
             break;
         case ftCalibration:
             mem_want = 9 - bits_offset;
@@ -102,78 +110,54 @@ static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
             mem_want = data_size + 1 - byte_index;
             break;
         case ftUnknown:
+        default:
             /* this should not happen */
-            state |= RMT_ENCODING_COMPLETE;
-            *ret_state = state;
+            *complete = true;
             return 0;
     }
 
-    /* how many symbols we can save for this round */
-    size_t mem_have = tx_chan->mem_end - tx_chan->mem_off;
-
-    /* get location to put the encoded symbols */
-    rmt_symbol_word_t *mem_to_nc = NULL;
-    if (channel->dma_chan) {
-        mem_to_nc = tx_chan->dma_mem_base_nc;
-    } else {
-        mem_to_nc = channel->hw_mem_base;
-    }
-
     /* how many symbols will be encoded in this round */
-    size_t encode_len = MIN(mem_want, mem_have);
-    bool encoding_truncated = mem_have < mem_want;
-    bool encoding_space_free = mem_have > mem_want;
-
-    if (channel->dma_chan) {
-        /* mark the start descriptor */
-        if (tx_chan->mem_off < tx_chan->ping_pong_symbols) {
-            desc0 = &tx_chan->dma_nodes_nc[0];
-        } else {
-            desc0 = &tx_chan->dma_nodes_nc[1];
-        }
-    }
+    size_t encode_len = MIN(mem_want, max_symbols);
+    size_t off = 0;
 
     size_t len = encode_len;
-    if (ppm_encoder->last_frame_type == ftEnter_Ppm) {
+    if (state->frame_type == ftEnter_Ppm) {
         while (len > 0) {
-            uint32_t cur_pulse = ((uint32_t)raw_data[byte_index]) * (4000000 / 1000000);  // ppm_resolution_hz TODO
-            mem_to_nc[tx_chan->mem_off].level0 = 1;
-            mem_to_nc[tx_chan->mem_off].duration0 = cur_pulse / 4;
-            mem_to_nc[tx_chan->mem_off].level1 = 0;
-            mem_to_nc[tx_chan->mem_off].duration1 = 3 * cur_pulse / 4;
-            tx_chan->mem_off++;
+            uint32_t cur_pulse = ((uint32_t)raw_data[byte_index]) * ticks_per_us;
+            symbols[off].level0 = 1;
+            symbols[off].duration0 = cur_pulse / 4;
+            symbols[off].level1 = 0;
+            symbols[off].duration1 = 3 * cur_pulse / 4;
+            off++;
             len--;
             byte_index++;
         }
-    } else if (ppm_encoder->last_frame_type == ftCalibration) {
+    } else if (state->frame_type == ftCalibration) {
         while (len > 0) {
-            mem_to_nc[tx_chan->mem_off].level0 = 1;
-            mem_to_nc[tx_chan->mem_off].duration0 = PPM_PULSE_LOW_TIME;
-            mem_to_nc[tx_chan->mem_off].level1 = 0;
-            mem_to_nc[tx_chan->mem_off].duration1 = PPM_CALIB_PULSE_TIME - PPM_PULSE_LOW_TIME;
-            tx_chan->mem_off++;
+            symbols[off].level0 = 1;
+            symbols[off].duration0 = ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+            symbols[off].level1 = 0;
+            symbols[off].duration1 = ppm_unit_ticks((uint32_t)PPM_CALIB_PULSE_TIME) - ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+            off++;
             len--;
             bits_offset++;
         }
-    } else if ((ppm_encoder->last_frame_type == ftSession) || (ppm_encoder->last_frame_type == ftPage)) {
-        if ((bits_offset == 0) && (byte_index == 1)) {
+    } else {
+        while ((len > 0) && (state->pulse_symbols < 2)) {
             /* generate frame type pulse */
-            mem_to_nc[tx_chan->mem_off].level0 = 0;
-            mem_to_nc[tx_chan->mem_off].duration0 = PPM_PULSE_LOW_TIME;
-            mem_to_nc[tx_chan->mem_off].level1 = 1;
-            mem_to_nc[tx_chan->mem_off].duration1 = PPM_PULSE_LOW_TIME;
-            tx_chan->mem_off++;
-            len--;
-            mem_to_nc[tx_chan->mem_off].level0 = 0;
-            if (ppm_encoder->last_frame_type == ftSession) {
-                mem_to_nc[tx_chan->mem_off].duration0 = PPM_SESSION_PULSE_TIME - PPM_PULSE_LOW_TIME;
+            symbols[off].level0 = 0;
+            if (state->pulse_symbols == 0) {
+                symbols[off].duration0 = ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+            } else if (state->frame_type == ftSession) {
+                symbols[off].duration0 = ppm_unit_ticks((uint32_t)PPM_SESSION_PULSE_TIME) - ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
             } else {
-                mem_to_nc[tx_chan->mem_off].duration0 = PPM_PAGE_PULSE_TIME - PPM_PULSE_LOW_TIME;
+                symbols[off].duration0 = ppm_unit_ticks((uint32_t)PPM_PAGE_PULSE_TIME) - ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
             }
-            mem_to_nc[tx_chan->mem_off].level1 = 1;
-            mem_to_nc[tx_chan->mem_off].duration1 = PPM_PULSE_LOW_TIME;
-            tx_chan->mem_off++;
+            symbols[off].level1 = 1;
+            symbols[off].duration1 = ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+            off++;
             len--;
+            state->pulse_symbols++;
         }
 
         while (len > 0) {
@@ -182,12 +166,12 @@ static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
             while ((len > 0) && (bits_offset < 8)) {
                 /* transfer MSbits first */
                 uint8_t two_bits = (cur_byte >> (6 - bits_offset)) & 0x03;
-                uint32_t total_time = 18 + (two_bits * PPM_BIT_DISTANCE);   /* 4.5us + (0~3*1.5us) */
-                mem_to_nc[tx_chan->mem_off].level0 = 0;
-                mem_to_nc[tx_chan->mem_off].duration0 = total_time - PPM_PULSE_LOW_TIME;
-                mem_to_nc[tx_chan->mem_off].level1 = 1;
-                mem_to_nc[tx_chan->mem_off].duration1 = PPM_PULSE_LOW_TIME;
-                tx_chan->mem_off++;
+                uint32_t total_time = PPM_SYMBOL_BASE_TIME + (two_bits * PPM_BIT_DISTANCE);   /* 4.5us + (0~3*1.5us) */
+                symbols[off].level0 = 0;
+                symbols[off].duration0 = ppm_unit_ticks(total_time) - ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+                symbols[off].level1 = 1;
+                symbols[off].duration1 = ppm_unit_ticks((uint32_t)PPM_PULSE_LOW_TIME);
+                off++;
                 len--;
                 bits_offset += 2;
             }
@@ -197,10 +181,73 @@ static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
                 bits_offset = 0;
             }
         }
+    }
+
+    if (max_symbols < mem_want) {
+        /* this encoding has not finished yet, save the truncated position */
+        state->bits_offset = bits_offset;
+        state->byte_index = byte_index;
+        *complete = false;
+    } else {
+        /* reset internal index if encoding session has finished */
+        state->bits_offset = 0;
+        state->byte_index = 0;
+        state->pulse_symbols = 0;
+        *complete = true;
+    }
+
+    return encode_len;
+}
+
+/** Encoder implementation
+ */
+static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
+                                       rmt_channel_handle_t channel,
+                                       const void *primary_data,
+                                       size_t data_size,
+                                       rmt_encode_state_t *ret_state) {
+    rmt_ppm_encoder_t *ppm_encoder = __containerof(encoder, rmt_ppm_encoder_t, base);
+    rmt_tx_channel_t *tx_chan = __containerof(channel, rmt_tx_channel_t, base);
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    rmt_dma_descriptor_t *desc0 = NULL;
+    rmt_dma_descriptor_t *desc1 = NULL;
+
+    bool frame_start = (ppm_encoder->state.bits_offset == 0) && (ppm_encoder->state.byte_index == 0);
+
+    /* how many symbols we can save for this round */
+    size_t mem_have = tx_chan->mem_end - tx_chan->mem_off;
+
+    /* get location to put the encoded symbols */
+    rmt_symbol_word_t *mem_to_nc = NULL;
+    if (channel->dma_chan) {
+        mem_to_nc = tx_chan->dma_mem_base_nc;
     } else {
-        /* empty */
+        mem_to_nc = channel->hw_mem_base;
     }
 
+    if (channel->dma_chan) {
+        /* mark the start descriptor */
+        if (tx_chan->mem_off < tx_chan->ping_pong_symbols) {
+            desc0 = &tx_chan->dma_nodes_nc[0];
+        } else {
+            desc0 = &tx_chan->dma_nodes_nc[1];
+        }
+    }
+
+    size_t start_off = tx_chan->mem_off;
+    bool encoding_complete = false;
+    size_t encode_len = rmt_ppm_encode_symbols(&ppm_encoder->state,
+                                               (const uint8_t *)primary_data,
+                                               data_size,
+                                               &mem_to_nc[start_off],
+                                               mem_have,
+                                               &encoding_complete);
+    tx_chan->mem_off += encode_len;
+    bool encoding_space_free = encoding_complete && (encode_len < mem_have);
+
+    rmt_ppm_capture_tx(&mem_to_nc[start_off], encode_len, frame_start);
+    rmt_ppm_trace_tx(&mem_to_nc[start_off], encode_len, frame_start);
+
     if (channel->dma_chan) {
         /* mark the end descriptor */
         if (tx_chan->mem_off < tx_chan->ping_pong_symbols) {
@@ -216,14 +263,7 @@ static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
         }
     }
 
-    if (encoding_truncated) {
-        /* this encoding has not finished yet, save the truncated position */
-        ppm_encoder->last_bits_offset = bits_offset;
-        ppm_encoder->last_byte_index = byte_index;
-    } else {
-        /* reset internal index if encoding session has finished */
-        ppm_encoder->last_bits_offset = 0;
-        ppm_encoder->last_byte_index = 0;
+    if (encoding_complete) {
         state |= RMT_ENCODING_COMPLETE;
     }
 
@@ -249,7 +289,11 @@ static size_t IRAM_ATTR rmt_encode_ppm(rmt_encoder_t *encoder,
  */
 static esp_err_t rmt_del_ppm_encoder(rmt_encoder_t *encoder) {
     rmt_ppm_encoder_t *ppm_encoder = __containerof(encoder, rmt_ppm_encoder_t, base);
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    ppmmem_free(ppm_encoder);
+#else
     free(ppm_encoder);
+#endif
     return ESP_OK;
 }
 
@@ -258,7 +302,11 @@ static esp_err_t rmt_del_ppm_encoder(rmt_encoder_t *encoder) {
 esp_err_t rmt_ppm_encoder_new(const rmt_ppm_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder) {
     esp_err_t ret = ESP_OK;
     ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+#if CONFIG_PPM_BOOTLOADER_STATIC_ALLOC
+    rmt_ppm_encoder_t *ppm_encoder = ppmmem_calloc(1, sizeof(rmt_ppm_encoder_t));
+#else
     rmt_ppm_encoder_t *ppm_encoder = rmt_alloc_encoder_mem(sizeof(rmt_ppm_encoder_t));
+#endif
     ESP_GOTO_ON_FALSE(ppm_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for bytes encoder");
     ppm_encoder->base.encode = rmt_encode_ppm;
     ppm_encoder->base.del = rmt_del_ppm_encoder;
@@ -270,6 +318,18 @@ err:
     return ret;
 }
 
+void rmt_ppm_encoder_set_timebase(uint32_t channel_hz, uint32_t unit_hz) {
+    if ((channel_hz == 0u) || (unit_hz == 0u)) {
+        return;
+    }
+    unit_ticks_q16 = (uint32_t)(((uint64_t)channel_hz << 16) / unit_hz);
+    ticks_per_us = channel_hz / 1000000u;
+}
+
+size_t rmt_ppm_encoder_get_arena_size(void) {
+    return ppmmem_blockSize(sizeof(rmt_ppm_encoder_t));
+}
+
 esp_err_t rmt_ppm_encoder_delete(rmt_encoder_handle_t encoder) {
     rmt_ppm_encoder_t *ppm_encoder = __containerof(encoder, rmt_ppm_encoder_t, base);
     return rmt_del_ppm_encoder(&ppm_encoder->base);
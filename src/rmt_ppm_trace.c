@@ -0,0 +1,430 @@
+/**
+ * @file
+ * @brief RMT PPM golden trace module.
+ * @internal
+ *
+ * @copyright (C) 2025 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @endinternal
+ *
+ * @ingroup lib_ppm_bootloader
+ *
+ * @details Implementations of the RMT PPM golden trace module.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "rmt_ppm_capture.h"
+
+#include "rmt_ppm_trace.h"
+
+#if CONFIG_PPM_BOOTLOADER_TRACE
+static const char *TAG = "rmt_ppm_trace";
+
+/** FNV-1a hash parameters */
+#define TRACE_HASH_INIT 2166136261u
+#define TRACE_HASH_PRIME 16777619u
+
+/** round a payload length up to the record alignment */
+#define TRACE_ALIGN(x) (((x) + 3u) & ~(size_t)3u)
+
+/** trace mode enum */
+typedef enum {
+    TRACE_IDLE = 0,
+    TRACE_RECORDING,
+    TRACE_REPLAYING,
+} trace_mode_t;
+
+static volatile trace_mode_t trace_mode = TRACE_IDLE;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** trace blob being recorded or replayed */
+static uint8_t *record_buffer = NULL;
+static const uint8_t *trace_blob = NULL;
+static size_t trace_size = 0u;
+/** offset of the next record to write or replay */
+static size_t trace_offset = 0u;
+/** number of records written or replayed */
+static uint32_t record_index = 0u;
+
+/** transmission in progress */
+static rmt_ppm_trace_record_t *tx_record = NULL;
+static const rmt_ppm_trace_record_t *tx_expected = NULL;
+static uint32_t tx_expected_index = 0u;
+static volatile uint32_t tx_ticks = 0u;
+static volatile uint32_t tx_hash = TRACE_HASH_INIT;
+
+static rmt_ppm_trace_result_t trace_result;
+
+/** Append a record to the trace being recorded (to be called with the trace lock taken)
+ *
+ * @param[in]  record  record header.
+ * @param[in]  payload  record payload.
+ * @param[in]  payload_length  length of the payload (in bytes).
+ * @returns  appended record, NULL when the buffer is full.
+ */
+static rmt_ppm_trace_record_t *rmt_ppm_trace_append(const rmt_ppm_trace_record_t *record,
+                                                    const void *payload,
+                                                    size_t payload_length);
+
+/** Get the record at the replay position
+ *
+ * @returns  record, NULL at the end of the trace.
+ */
+static const rmt_ppm_trace_record_t *rmt_ppm_trace_peek(void);
+
+/** Get the payload length of a record
+ *
+ * @param[in]  record  trace record.
+ * @returns  length of the payload (in bytes, without padding).
+ */
+static size_t rmt_ppm_trace_payload_length(const rmt_ppm_trace_record_t *record);
+
+/** Register a replay mismatch
+ *
+ * @param[in]  index  record index of the mismatch.
+ * @param[in]  what  description of the mismatch.
+ */
+static void rmt_ppm_trace_mismatch(uint32_t index, const char *what);
+
+
+static size_t rmt_ppm_trace_payload_length(const rmt_ppm_trace_record_t *record) {
+    if (record->kind == RMT_PPM_TRACE_RX) {
+        return (size_t)record->length * sizeof(rmt_symbol_word_t);
+    }
+    return record->length;
+}
+
+static rmt_ppm_trace_record_t *IRAM_ATTR rmt_ppm_trace_append(const rmt_ppm_trace_record_t *record,
+                                                              const void *payload,
+                                                              size_t payload_length) {
+    size_t record_length = sizeof(rmt_ppm_trace_record_t) + TRACE_ALIGN(payload_length);
+    if ((trace_size - trace_offset) < record_length) {
+        trace_result.truncated = true;
+        return NULL;
+    }
+
+    rmt_ppm_trace_record_t *dest = (rmt_ppm_trace_record_t *)&record_buffer[trace_offset];
+    *dest = *record;
+    memcpy(&dest[1], payload, payload_length);
+    trace_offset += record_length;
+    record_index++;
+
+    return dest;
+}
+
+static const rmt_ppm_trace_record_t *rmt_ppm_trace_peek(void) {
+    if ((trace_size - trace_offset) < sizeof(rmt_ppm_trace_record_t)) {
+        return NULL;
+    }
+
+    const rmt_ppm_trace_record_t *record = (const rmt_ppm_trace_record_t *)&trace_blob[trace_offset];
+    size_t record_length = sizeof(rmt_ppm_trace_record_t) + TRACE_ALIGN(rmt_ppm_trace_payload_length(record));
+    if ((trace_size - trace_offset) < record_length) {
+        return NULL;
+    }
+
+    return record;
+}
+
+static void rmt_ppm_trace_mismatch(uint32_t index, const char *what) {
+    if (trace_result.tx_mismatches == 0u) {
+        trace_result.first_mismatch = index;
+        ESP_LOGE(TAG, "replay differs at record %u: %s", (unsigned)index, what);
+    }
+    trace_result.tx_mismatches++;
+}
+#endif
+
+esp_err_t rmt_ppm_trace_record(uint8_t * buffer, size_t size) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if ((buffer == NULL) || (((uintptr_t)buffer & 3u) != 0u) || (size < sizeof(rmt_ppm_trace_header_t))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (trace_mode != TRACE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&trace_result, 0, sizeof(trace_result));
+    trace_result.first_mismatch = UINT32_MAX;
+    record_buffer = buffer;
+    trace_blob = buffer;
+    trace_size = size;
+    trace_offset = sizeof(rmt_ppm_trace_header_t);
+    record_index = 0u;
+    tx_record = NULL;
+    trace_mode = TRACE_RECORDING;
+
+    return ESP_OK;
+#else
+    (void)buffer;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t rmt_ppm_trace_replay(const uint8_t * trace, size_t length) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if ((trace == NULL) || (((uintptr_t)trace & 3u) != 0u) || (length < sizeof(rmt_ppm_trace_header_t))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (trace_mode != TRACE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const rmt_ppm_trace_header_t *header = (const rmt_ppm_trace_header_t *)trace;
+    if ((header->magic != RMT_PPM_TRACE_MAGIC) ||
+        (header->version != RMT_PPM_TRACE_VERSION) ||
+        (header->length > length)) {
+        ESP_LOGE(TAG, "invalid trace blob");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (header->resolution_hz != rmt_ppm_capture_get_resolution()) {
+        ESP_LOGW(TAG, "trace recorded at %u Hz, replaying at %u Hz",
+                 (unsigned)header->resolution_hz, (unsigned)rmt_ppm_capture_get_resolution());
+    }
+
+    memset(&trace_result, 0, sizeof(trace_result));
+    trace_result.first_mismatch = UINT32_MAX;
+    record_buffer = NULL;
+    trace_blob = trace;
+    trace_size = header->length;
+    trace_offset = sizeof(rmt_ppm_trace_header_t);
+    record_index = 0u;
+    tx_expected = NULL;
+    trace_mode = TRACE_REPLAYING;
+
+    return ESP_OK;
+#else
+    (void)trace;
+    (void)length;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t rmt_ppm_trace_stop(size_t * length, rmt_ppm_trace_result_t * result) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if (trace_mode == TRACE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&trace_lock);
+    trace_mode_t mode = trace_mode;
+    trace_mode = TRACE_IDLE;
+    portEXIT_CRITICAL(&trace_lock);
+
+    esp_err_t err = ESP_OK;
+    if (mode == TRACE_RECORDING) {
+        rmt_ppm_trace_header_t *header = (rmt_ppm_trace_header_t *)record_buffer;
+        header->magic = RMT_PPM_TRACE_MAGIC;
+        header->version = RMT_PPM_TRACE_VERSION;
+        header->reserved = 0u;
+        header->resolution_hz = rmt_ppm_capture_get_resolution();
+        header->record_count = record_index;
+        header->length = (uint32_t)trace_offset;
+        if (trace_result.truncated) {
+            err = ESP_ERR_INVALID_SIZE;
+        }
+    } else {
+        const rmt_ppm_trace_header_t *header = (const rmt_ppm_trace_header_t *)trace_blob;
+        trace_result.records_left = header->record_count - record_index;
+        if ((trace_result.tx_mismatches != 0u) || (trace_result.records_left != 0u)) {
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+        ESP_LOGI(TAG, "replayed %u frames, %u mismatches, %u records left, wire time %llu/%llu ticks",
+                 (unsigned)trace_result.tx_frames,
+                 (unsigned)trace_result.tx_mismatches,
+                 (unsigned)trace_result.records_left,
+                 (unsigned long long)trace_result.replayed_ticks,
+                 (unsigned long long)trace_result.recorded_ticks);
+    }
+
+    if (length != NULL) {
+        *length = (mode == TRACE_RECORDING) ? trace_offset : 0u;
+    }
+    if (result != NULL) {
+        *result = trace_result;
+    }
+
+    record_buffer = NULL;
+    trace_blob = NULL;
+
+    return err;
+#else
+    (void)length;
+    (void)result;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+bool rmt_ppm_trace_is_active(void) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    return trace_mode != TRACE_IDLE;
+#else
+    return false;
+#endif
+}
+
+void rmt_ppm_trace_begin_tx(const uint8_t * raw, size_t length) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    rmt_ppm_trace_record_t record = {
+        .kind = RMT_PPM_TRACE_TX,
+        .frame_type = raw[0],
+        .length = (uint16_t)(length + 1u),
+    };
+
+    if (trace_mode == TRACE_RECORDING) {
+        portENTER_CRITICAL(&trace_lock);
+        tx_record = rmt_ppm_trace_append(&record, raw, length + 1u);
+        portEXIT_CRITICAL(&trace_lock);
+        trace_result.tx_frames++;
+    } else if (trace_mode == TRACE_REPLAYING) {
+        /* receptions recorded before the first transmission have nothing to follow */
+        const rmt_ppm_trace_record_t *expected;
+        while (((expected = rmt_ppm_trace_peek()) != NULL) && (expected->kind == RMT_PPM_TRACE_RX)) {
+            trace_offset += sizeof(rmt_ppm_trace_record_t) + TRACE_ALIGN(rmt_ppm_trace_payload_length(expected));
+            record_index++;
+            trace_result.rx_skipped++;
+        }
+
+        trace_result.tx_frames++;
+        tx_expected = expected;
+        tx_expected_index = record_index;
+        if (expected == NULL) {
+            rmt_ppm_trace_mismatch(record_index, "transmission beyond the end of the trace");
+            return;
+        }
+
+        trace_offset += sizeof(rmt_ppm_trace_record_t) + TRACE_ALIGN(expected->length);
+        record_index++;
+        trace_result.recorded_ticks += expected->ticks;
+        if ((expected->frame_type != record.frame_type) || (expected->length != record.length)) {
+            rmt_ppm_trace_mismatch(tx_expected_index, "frame type or length");
+        } else if (memcmp(&expected[1], raw, record.length) != 0) {
+            rmt_ppm_trace_mismatch(tx_expected_index, "frame content");
+        } else {
+            /* symbols are compared once encoded */
+        }
+    } else {
+        /* not tracing */
+    }
+#else
+    (void)raw;
+    (void)length;
+#endif
+}
+
+void rmt_ppm_trace_end_tx(void) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if (trace_mode == TRACE_RECORDING) {
+        if (tx_record != NULL) {
+            tx_record->ticks = tx_ticks;
+            tx_record->hash = tx_hash;
+            trace_result.recorded_ticks += tx_ticks;
+            tx_record = NULL;
+        }
+    } else if (trace_mode == TRACE_REPLAYING) {
+        trace_result.replayed_ticks += tx_ticks;
+        if (tx_expected != NULL) {
+            if (tx_expected->ticks != tx_ticks) {
+                rmt_ppm_trace_mismatch(tx_expected_index, "wire time");
+            } else if (tx_expected->hash != tx_hash) {
+                rmt_ppm_trace_mismatch(tx_expected_index, "encoded symbols");
+            } else {
+                /* transmission matches the recording */
+            }
+            tx_expected = NULL;
+        }
+    } else {
+        /* not tracing */
+    }
+#endif
+}
+
+void IRAM_ATTR rmt_ppm_trace_tx(const rmt_symbol_word_t * symbols, size_t count, bool frame_start) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if (trace_mode == TRACE_IDLE) {
+        return;
+    }
+
+    uint32_t ticks = frame_start ? 0u : tx_ticks;
+    uint32_t hash = frame_start ? TRACE_HASH_INIT : tx_hash;
+    for (size_t i = 0u; i < count; i++) {
+        ticks += symbols[i].duration0 + symbols[i].duration1;
+        hash = (hash ^ symbols[i].val) * TRACE_HASH_PRIME;
+    }
+    tx_ticks = ticks;
+    tx_hash = hash;
+#else
+    (void)symbols;
+    (void)count;
+    (void)frame_start;
+#endif
+}
+
+bool IRAM_ATTR rmt_ppm_trace_rx(const rmt_symbol_word_t * symbols, size_t count) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if (trace_mode == TRACE_REPLAYING) {
+        return true;
+    }
+
+    if ((trace_mode == TRACE_RECORDING) && (count > 0u)) {
+        rmt_ppm_trace_record_t record = {
+            .kind = RMT_PPM_TRACE_RX,
+            .length = (uint16_t)count,
+        };
+        portENTER_CRITICAL_SAFE(&trace_lock);
+        if (rmt_ppm_trace_append(&record, symbols, count * sizeof(rmt_symbol_word_t)) != NULL) {
+            trace_result.rx_blocks++;
+        }
+        portEXIT_CRITICAL_SAFE(&trace_lock);
+    }
+#else
+    (void)symbols;
+    (void)count;
+#endif
+    return false;
+}
+
+const rmt_symbol_word_t * rmt_ppm_trace_next_rx(size_t * count) {
+#if CONFIG_PPM_BOOTLOADER_TRACE
+    if (trace_mode != TRACE_REPLAYING) {
+        return NULL;
+    }
+
+    const rmt_ppm_trace_record_t *record = rmt_ppm_trace_peek();
+    if ((record == NULL) || (record->kind != RMT_PPM_TRACE_RX)) {
+        return NULL;
+    }
+
+    trace_offset += sizeof(rmt_ppm_trace_record_t) + TRACE_ALIGN(rmt_ppm_trace_payload_length(record));
+    record_index++;
+    trace_result.rx_blocks++;
+    *count = record->length;
+
+    return (const rmt_symbol_word_t *)&record[1];
+#else
+    (void)count;
+    return NULL;
+#endif
+}
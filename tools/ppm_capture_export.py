@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# Copyright (C) 2025 Melexis N.V.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Convert an RMT PPM symbol capture into a VCD or CSV file.
+
+The capture is taken from a console log containing the output of rmt_ppm_capture_dump(), log
+prefixes and unrelated lines are ignored. The TX signal shows the symbols as generated by the
+encoder (before the output inversion), the RX signal the symbols as received (after the input
+inversion). Both signals are idle low.
+
+usage: ppm_capture_export.py [-f vcd|csv] [-o OUTPUT] LOG
+"""
+import argparse
+import re
+import sys
+
+CAPTURE_LINE = re.compile(r"ppmcap,([^\s]+)")
+DEFAULT_RESOLUTION = 4000000
+SIGNALS = {"T": "tx", "R": "rx"}
+
+
+def parse_capture(lines):
+    """Parse the capture lines of a console log.
+
+    Returns the tick resolution and a list of (signal, time_ns, level, duration_ns) segments.
+    """
+    resolution = DEFAULT_RESOLUTION
+    lost = 0
+    segments = []
+    last_time = None
+    wraps = 0
+
+    for line in lines:
+        match = CAPTURE_LINE.search(line)
+        if not match:
+            continue
+        fields = match.group(1).split(",")
+        if fields[0] == "start":
+            resolution = int(fields[1])
+            lost += int(fields[2])
+            continue
+        if fields[0] not in SIGNALS or len(fields) != 7:
+            continue
+
+        direction, time_us, offset, level0, duration0, level1, duration1 = \
+            fields[0], *(int(field) for field in fields[1:])
+
+        # block times are 32-bit microsecond timestamps
+        if (last_time is not None) and (time_us + (1 << 31) < last_time):
+            wraps += 1
+        last_time = time_us
+        time_ns = (time_us + (wraps << 32)) * 1000 + offset * 1000000000 // resolution
+
+        for level, duration in ((level0, duration0), (level1, duration1)):
+            if duration == 0:
+                continue
+            duration_ns = duration * 1000000000 // resolution
+            segments.append((SIGNALS[direction], time_ns, level, duration_ns))
+            time_ns += duration_ns
+
+    if lost:
+        print("warning: %d symbols were overwritten in the capture ring" % lost, file=sys.stderr)
+
+    return resolution, segments
+
+
+def write_csv(segments, out):
+    out.write("time_ns,signal,level,duration_ns\n")
+    for signal, time_ns, level, duration_ns in sorted(segments, key=lambda seg: seg[1]):
+        out.write("%d,%s,%d,%d\n" % (time_ns, signal, level, duration_ns))
+
+
+def write_vcd(segments, out):
+    ids = {"tx": "!", "rx": "\""}
+    changes = []
+    for signal, time_ns, level, duration_ns in segments:
+        changes.append((time_ns, signal, level))
+        changes.append((time_ns + duration_ns, signal, 0))
+    # a level starting at the same time as the idle of the previous segment ends wins
+    changes.sort(key=lambda change: (change[0], change[2]))
+
+    out.write("$comment RMT PPM symbol capture $end\n")
+    out.write("$timescale 1ns $end\n")
+    out.write("$scope module ppm $end\n")
+    for signal, ident in ids.items():
+        out.write("$var wire 1 %s %s $end\n" % (ident, signal))
+    out.write("$upscope $end\n$enddefinitions $end\n")
+
+    start = changes[0][0] if changes else 0
+    state = {signal: 0 for signal in ids}
+    out.write("#0\n$dumpvars\n")
+    for signal, ident in ids.items():
+        out.write("0%s\n" % ident)
+    out.write("$end\n")
+
+    current = None
+    for time_ns, signal, level in changes:
+        if state[signal] == level:
+            continue
+        state[signal] = level
+        if time_ns != current:
+            current = time_ns
+            out.write("#%d\n" % (time_ns - start))
+        out.write("%d%s\n" % (level, ids[signal]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an RMT PPM symbol capture into VCD or CSV.")
+    parser.add_argument("log", help="console log holding the rmt_ppm_capture_dump() output ('-' for stdin)")
+    parser.add_argument("-f", "--format", choices=("vcd", "csv"), default="vcd", help="output format")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    args = parser.parse_args()
+
+    if args.log == "-":
+        _, segments = parse_capture(sys.stdin)
+    else:
+        with open(args.log, "r", errors="replace") as log:
+            _, segments = parse_capture(log)
+
+    if not segments:
+        print("error: no capture found in %s" % args.log, file=sys.stderr)
+        return 1
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    try:
+        if args.format == "vcd":
+            write_vcd(segments, out)
+        else:
+            write_csv(segments, out)
+    finally:
+        if args.output:
+            out.close()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# Copyright (C) 2025 Melexis N.V.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Decode a PPM binary event trace into readable events.
+
+The trace is taken either from a console log containing the output of ppmevent_dump() (log
+prefixes and unrelated lines are ignored) or, with --binary, from a file holding the
+ppm_event_entry_t entries as returned by ppmevent_read(). Gaps in the event sequence numbers,
+i.e. events overwritten in the ring, are reported in the output.
+
+usage: ppm_event_decode.py [--binary] [-o OUTPUT] TRACE
+"""
+import argparse
+import re
+import struct
+import sys
+
+EVENT_LINE = re.compile(r"ppmevt,([^\s]+)")
+ENTRY = struct.Struct("<IHHII")
+
+FRAME_TYPES = {0: "session", 1: "page", 2: "calibration", 3: "enter_ppm", 0xFF: "unknown"}
+
+
+def frame_type(value):
+    return FRAME_TYPES.get(value & 0xFF, "0x%02x" % (value & 0xFF))
+
+
+def esp_err(value):
+    return "ESP_OK" if value == 0 else "err 0x%x" % value
+
+
+# event id: (name, formatter of the two arguments), see ppm_event_id_t in ppm_event.h
+EVENTS = {
+    0x01: ("SESSION_START", lambda a, b: "session 0x%02x, %d pages" % (a, b)),
+    0x02: ("SESSION_END", lambda a, b: "session 0x%02x, %s" % (a, esp_err(b))),
+    0x03: ("PAGE_TX", lambda a, b: "page %d, checksum 0x%02x" % (a, b)),
+    0x04: ("EEPROM_CRC", lambda a, b: "crc calc 0x%04x, chip 0x%04x" % (a, b)),
+    0x10: ("TX_START", lambda a, b: "%s, %d" % (frame_type(a), b)),
+    0x11: ("TX_DONE", lambda a, b: "%s, %s" % (frame_type(a), esp_err(b))),
+    0x20: ("RX_FRAME", lambda a, b: "%s, %d repairs, %d bytes" % (frame_type(a), a >> 8, b)),
+    0x21: ("RX_PULSE_ERROR", lambda a, b: "pulse %d ticks" % a),
+    0x22: ("RX_TIMING_ERROR", lambda a, b: "symbol %d ticks after %d bytes" % (a, b)),
+    0x23: ("RX_OVERFLOW", lambda a, b: "%s, %d bytes" % (frame_type(a), b)),
+    0x24: ("RX_ECHO", lambda a, b: frame_type(a)),
+    0x30: ("ACK", lambda a, b: "%s, 0x%04x" % (frame_type(a), b)),
+    0x31: ("ACK_STALE", lambda a, b: "%s, 0x%04x" % (frame_type(a), b)),
+    0x32: ("ACK_TIMEOUT", lambda a, b: "%s, expected 0x%04x" % (frame_type(a), b)),
+}
+
+
+def unpack_entries(data):
+    """Split raw entry bytes into (time_us, event, sequence, arg0, arg1) tuples."""
+    count = len(data) // ENTRY.size
+    return [ENTRY.unpack_from(data, i * ENTRY.size) for i in range(count)]
+
+
+def parse_log(lines):
+    """Parse the event lines of a console log.
+
+    Returns the list of entries and the number of events lost in the ring.
+    """
+    entries = []
+    lost = 0
+    for line in lines:
+        match = EVENT_LINE.search(line)
+        if not match:
+            continue
+        fields = match.group(1).split(",")
+        if fields[0] == "start":
+            lost += int(fields[1])
+            continue
+        if fields[0] == "end":
+            continue
+        try:
+            entries.extend(unpack_entries(bytes.fromhex(fields[0])))
+        except ValueError:
+            print("warning: skipping malformed line: %s" % line.strip(), file=sys.stderr)
+    return entries, lost
+
+
+def write_events(entries, out):
+    start = entries[0][0] if entries else 0
+    previous = start
+    wraps = 0
+    last_sequence = None
+
+    out.write("%12s %10s  %-16s %s\n" % ("time_us", "delta_us", "event", "arguments"))
+    for time_us, event, sequence, arg0, arg1 in entries:
+        if (last_sequence is not None) and (sequence != ((last_sequence + 1) & 0xFFFF)):
+            out.write("%12s %10s  %-16s %d events\n" % ("", "", "-- GAP --", (sequence - last_sequence - 1) & 0xFFFF))
+        last_sequence = sequence
+
+        # event times are 32-bit microsecond timestamps
+        if time_us + (1 << 31) < (previous & 0xFFFFFFFF):
+            wraps += 1
+        absolute = time_us + (wraps << 32)
+        name, describe = EVENTS.get(event, ("0x%04x" % event, lambda a, b: "0x%x, 0x%x" % (a, b)))
+        out.write("%12d %10d  %-16s %s\n" % (absolute - start, absolute - previous, name, describe(arg0, arg1)))
+        previous = absolute
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a PPM binary event trace.")
+    parser.add_argument("trace", help="console log holding the ppmevent_dump() output ('-' for stdin)")
+    parser.add_argument("--binary", action="store_true", help="the trace holds raw ppm_event_entry_t entries")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    args = parser.parse_args()
+
+    lost = 0
+    if args.binary:
+        if args.trace == "-":
+            entries = unpack_entries(sys.stdin.buffer.read())
+        else:
+            with open(args.trace, "rb") as trace:
+                entries = unpack_entries(trace.read())
+    elif args.trace == "-":
+        entries, lost = parse_log(sys.stdin)
+    else:
+        with open(args.trace, "r", errors="replace") as log:
+            entries, lost = parse_log(log)
+
+    if not entries:
+        print("error: no events found in %s" % args.trace, file=sys.stderr)
+        return 1
+    if lost:
+        print("warning: %d events were overwritten in the event ring" % lost, file=sys.stderr)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    try:
+        write_events(entries, out)
+    finally:
+        if args.output:
+            out.close()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())